@@ -0,0 +1,132 @@
+#include "BarnesHutGradientDescent.h"
+#include "FftGradientDescent.h"
+#include "KnnGraph.h"
+#include "ParallelUtils.h"
+#include "PerplexityCalibration.h"
+
+#include <QCoreApplication>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Iterations per second of the CPU gradient descent loop for 5k, 50k and 500k points
+ *
+ * Compares the loop of TsneWorker::computeGradientDescent before and after progress was batched:
+ *  - per iteration: QCoreApplication::processEvents() after every iteration, as the loop used to
+ *  - batched: progress at most every 100 ms, as the loop does now
+ * ManiVault's per-iteration subtask bookkeeping needs a running core and is not part of the "per iteration" loop,
+ * so the difference is a lower bound of the gain in the application.
+ *
+ * The probabilities are synthetic: 90 neighbors per point within clusters of 1000 points, calibrated to perplexity 30.
+ *
+ * Usage: GradientDescentBenchmark [iterations = 100] [bh | fft = bh] [max points = 500000]
+ */
+
+namespace
+{
+    SparseMatrix syntheticProbabilities(std::uint32_t numPoints, std::uint32_t numNeighbors, std::uint32_t clusterSize)
+    {
+        KnnGraph knnGraph(numPoints, numNeighbors);
+
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(numPoints); i++)
+        {
+            std::mt19937 generator(static_cast<std::uint32_t>(i));
+
+            const std::uint32_t clusterBegin = static_cast<std::uint32_t>(i) / clusterSize * clusterSize;
+            const std::uint32_t clusterEnd = std::min(numPoints, clusterBegin + clusterSize);
+
+            std::uniform_int_distribution<std::uint32_t> member(clusterBegin, clusterEnd - 1);
+
+            auto* neighbors = knnGraph.neighbors(static_cast<std::uint32_t>(i));
+            auto* distances = knnGraph.distances(static_cast<std::uint32_t>(i));
+
+            for (std::uint32_t k = 0; k < numNeighbors; k++)
+            {
+                neighbors[k] = member(generator);
+                distances[k] = 1.f + 0.1f * k;
+            }
+        }
+
+        return computeConditionalProbabilities(knnGraph, numNeighbors / 3.f);
+    }
+
+    std::unique_ptr<CpuGradientDescent> createGradientDescent(const std::string& engine)
+    {
+        if (engine == "fft")
+            return std::make_unique<FftGradientDescent>();
+
+        return std::make_unique<BarnesHutGradientDescent>();
+    }
+
+    /** @return Iterations per second */
+    double run(const SparseMatrix& probabilities, const std::string& engine, int numIterations, bool processEventsPerIteration)
+    {
+        hdi::dr::TsneParameters params;
+        params._seed = 1;
+        params._embedding_dimensionality = 2;
+
+        CpuGradientDescent::Embedding embedding;
+
+        auto gradientDescent = createGradientDescent(engine);
+        gradientDescent->initialize(probabilities, &embedding, params);
+
+        const auto progressInterval = std::chrono::milliseconds(100);
+        const auto begin = std::chrono::steady_clock::now();
+        auto lastProgressUpdate = begin;
+
+        for (int iteration = 0; iteration < numIterations; iteration++)
+        {
+            gradientDescent->doAnIteration();
+
+            if (processEventsPerIteration)
+            {
+                QCoreApplication::processEvents();
+                continue;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+
+            if (now - lastProgressUpdate >= progressInterval)
+                lastProgressUpdate = now;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        return seconds > 0. ? numIterations / seconds : 0.;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    const int numIterations = argc > 1 ? std::atoi(argv[1]) : 100;
+    const std::string engine = argc > 2 ? argv[2] : "bh";
+    const std::uint32_t maxPoints = argc > 3 ? static_cast<std::uint32_t>(std::atoi(argv[3])) : 500000;
+
+    std::cout << "Gradient descent (" << (engine == "fft" ? "FFT" : "Barnes-Hut") << "), " << numIterations << " iterations, " << numParallelThreads() << " threads" << std::endl;
+    std::cout << "points\tper iteration [it/s]\tbatched [it/s]" << std::endl;
+
+    for (const std::uint32_t numPoints : { 5000u, 50000u, 500000u })
+    {
+        if (numPoints > maxPoints)
+            break;
+
+        const auto probabilities = syntheticProbabilities(numPoints, 90, 1000);
+
+        const double perIteration = run(probabilities, engine, numIterations, true);
+        const double batched = run(probabilities, engine, numIterations, false);
+
+        std::cout << numPoints << "\t" << perIteration << "\t" << batched << std::endl;
+    }
+
+    return 0;
+}
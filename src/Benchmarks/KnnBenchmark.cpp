@@ -0,0 +1,144 @@
+#include "BruteForceKnn.h"
+#include "DataProvider.h"
+#include "KnnGraph.h"
+#include "KnnIndex.h"
+#include "KnnParameters.h"
+#include "LibraryKnn.h"
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Wall time and recall of the exact brute-force search and of HNSW for 10k, 50k and 100k points
+ *
+ * Compares the backends of the kNN settings on the same data:
+ *  - brute force: Float32 (the exact reference), Float16 and Int8 with re-ranking, see computeBruteForceKnn
+ *  - HNSW: index construction and search of all points with the default parameters of the kNN settings, see KnnIndex
+ * Recall is the fraction of the exact neighbors that a backend found, over all points.
+ *
+ * The data is synthetic: Gaussian clusters of 1000 points with unit variance around centers drawn with variance 100.
+ *
+ * Usage: KnnBenchmark [neighbors = 90] [dimensions = 50] [max points = 100000]
+ */
+
+namespace
+{
+    std::vector<float> syntheticData(std::uint32_t numPoints, std::uint32_t numDimensions, std::uint32_t clusterSize)
+    {
+        std::vector<float> data(static_cast<std::size_t>(numPoints) * numDimensions);
+
+#pragma omp parallel for
+        for (std::int64_t cluster = 0; cluster < (static_cast<std::int64_t>(numPoints) + clusterSize - 1) / clusterSize; cluster++)
+        {
+            std::mt19937 generator(static_cast<std::uint32_t>(cluster));
+            std::normal_distribution<float> normal;
+
+            std::vector<float> center(numDimensions);
+
+            for (auto& value : center)
+                value = 10.f * normal(generator);
+
+            const std::uint32_t clusterBegin = static_cast<std::uint32_t>(cluster) * clusterSize;
+            const std::uint32_t clusterEnd = std::min(numPoints, clusterBegin + clusterSize);
+
+            for (std::uint32_t i = clusterBegin; i < clusterEnd; i++)
+                for (std::uint32_t d = 0; d < numDimensions; d++)
+                    data[static_cast<std::size_t>(i) * numDimensions + d] = center[d] + normal(generator);
+        }
+
+        return data;
+    }
+
+    /** Fraction of the neighbors of the exact graph that the other graph contains */
+    double recall(const KnnGraph& exact, const KnnGraph& knnGraph)
+    {
+        const std::uint32_t numNeighbors = exact.getNumNeighbors();
+        std::uint64_t numFound = 0;
+
+#pragma omp parallel for reduction(+:numFound)
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(exact.getNumPoints()); i++)
+        {
+            const auto point = static_cast<std::uint32_t>(i);
+
+            std::vector<std::uint32_t> expected(exact.neighbors(point), exact.neighbors(point) + numNeighbors);
+            std::vector<std::uint32_t> found(knnGraph.neighbors(point), knnGraph.neighbors(point) + numNeighbors);
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(found.begin(), found.end());
+
+            std::vector<std::uint32_t> common;
+            std::set_intersection(expected.begin(), expected.end(), found.begin(), found.end(), std::back_inserter(common));
+
+            numFound += common.size();
+        }
+
+        return static_cast<double>(numFound) / (static_cast<double>(exact.getNumPoints()) * numNeighbors);
+    }
+
+    template <typename Function>
+    double secondsOf(Function function)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::uint32_t numNeighbors = argc > 1 ? static_cast<std::uint32_t>(std::atoi(argv[1])) : 90;
+    const std::uint32_t numDimensions = argc > 2 ? static_cast<std::uint32_t>(std::atoi(argv[2])) : 50;
+    const std::uint32_t maxPoints = argc > 3 ? static_cast<std::uint32_t>(std::atoi(argv[3])) : 100000;
+
+    constexpr auto metric = hdi::dr::knn_distance_metric::KNN_METRIC_EUCLIDEAN;
+
+    std::cout << "kNN search, " << numNeighbors << " neighbors, " << numDimensions << " dimensions, " << numParallelThreads() << " threads" << std::endl;
+    std::cout << "points\tbackend\tbuild [s]\tsearch [s]\ttotal [s]\trecall" << std::endl;
+
+    for (const std::uint32_t numPoints : { 10000u, 50000u, 100000u })
+    {
+        if (numPoints > maxPoints)
+            break;
+
+        const VectorDataProvider data(syntheticData(numPoints, numDimensions, 1000), numDimensions);
+
+        const auto report = [numPoints](const std::string& backend, double build, double search, double recall) {
+            std::cout << numPoints << "\t" << backend << "\t" << build << "\t" << search << "\t" << build + search << "\t" << recall << std::endl;
+            };
+
+        KnnGraph exact;
+        report("brute force (float32)", 0., secondsOf([&]() { exact = computeBruteForceKnn(data, numNeighbors, metric); }), 1.);
+
+        for (const auto precision : { KnnPrecision::Float16, KnnPrecision::Int8 })
+        {
+            KnnGraph knnGraph;
+            const double search = secondsOf([&]() { knnGraph = computeBruteForceKnn(data, numNeighbors, metric, precision); });
+
+            report(std::string("brute force (") + knnPrecisionName(precision) + ")", 0., search, recall(exact, knnGraph));
+        }
+
+        KnnParameters knnParameters;
+        knnParameters.setKnnBackend(KnnBackend::Library);
+        knnParameters.setKnnAlgorithm(hdi::dr::knn_library::KNN_HNSW);
+        knnParameters.setKnnDistanceMetric(metric);
+
+        std::unique_ptr<KnnIndex> index;
+        KnnGraph knnGraph;
+
+        const double build = secondsOf([&]() { index = KnnIndex::build(data.getContiguousData(), numPoints, numDimensions, knnParameters); });
+        const double search = secondsOf([&]() { knnGraph = computeLibraryKnn(data, numNeighbors, *index); });
+
+        report("HNSW (M " + std::to_string(knnParameters.getHNSWm()) + ", ef " + std::to_string(knnParameters.getHNSWef()) + ")", build, search, recall(exact, knnGraph));
+    }
+
+    return 0;
+}
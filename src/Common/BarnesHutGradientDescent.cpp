@@ -0,0 +1,6 @@
+#include "BarnesHutGradientDescent.h"
+
+double BarnesHutGradientDescent::computeRepulsiveForces(const float* positions, float* forces)
+{
+    return _tree.computeRepulsiveForces(positions, getNumPoints(), static_cast<float>(_theta), forces);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CpuGradientDescent.h"
+#include "QuadTree.h"
+
+/**
+ * BarnesHutGradientDescent
+ *
+ * CPU gradient descent with Barnes-Hut approximated repulsive forces.
+ * The quadtree is rebuilt in parallel every iteration and traversed for all points in
+ * parallel, in Morton order so that neighboring threads walk similar parts of the tree.
+ */
+class BarnesHutGradientDescent : public CpuGradientDescent
+{
+public:
+    BarnesHutGradientDescent() = default;
+
+    /** Barnes-Hut accuracy, 0 computes the exact repulsive forces */
+    void setTheta(double theta) { _theta = theta; }
+    double getTheta() const { return _theta; }
+
+protected:
+    double computeRepulsiveForces(const float* positions, float* forces) override;
+
+private:
+    double      _theta = 0.5;   /** Barnes-Hut accuracy */
+    QuadTree    _tree;          /** Space partitioning of the current embedding */
+};
@@ -0,0 +1,522 @@
+#include "BruteForceKnn.h"
+
+#include "MetricDistance.h"
+#include "ParallelUtils.h"
+#include "QuantizedData.h"
+#include "WorkerControl.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+#include <QDebug>
+
+namespace
+{
+    constexpr std::uint32_t queryTileSize = 64;                 /** Queries that share one pass over a reference tile */
+    constexpr std::size_t referenceTileBytes = 256 * 1024;      /** Size of a reference tile, about the L2 cache */
+
+    struct Neighbor
+    {
+        float           distance;
+        std::uint32_t   index;
+
+        // Ties are broken by index so that the result does not depend on the tiling
+        bool operator<(const Neighbor& other) const
+        {
+            return distance < other.distance || (distance == other.distance && index < other.index);
+        }
+    };
+
+    /** Add a candidate to a max-heap that keeps the capacity nearest candidates */
+    inline void insertCandidate(Neighbor* heap, std::uint32_t& size, std::uint32_t capacity, const Neighbor& candidate)
+    {
+        if (size < capacity)
+        {
+            heap[size++] = candidate;
+            std::push_heap(heap, heap + size);
+        }
+        else if (candidate < heap[0])
+        {
+            std::pop_heap(heap, heap + size);
+            heap[size - 1] = candidate;
+            std::push_heap(heap, heap + size);
+        }
+    }
+
+    /**
+     * Neighbors of the queries [queryBegin, queryEnd) among the references [0, numReferences), a point is not its own neighbor
+     * Row q of the graph belongs to query queryBegin + q
+     * distance(query, referenceBegin, referenceEnd, out) computes the distances of a query to a range of references, e.g. a MetricDistance
+     * Tiles that start after a stop request of the control are skipped
+     */
+    template <typename Distance>
+    KnnGraph searchTiled(std::uint32_t queryBegin, std::uint32_t queryEnd, std::uint32_t numReferences, std::size_t bytesPerPoint, std::uint32_t numNeighbors, Distance distance, const WorkerControl* control = nullptr)
+    {
+        KnnGraph knnGraph(queryEnd - queryBegin, numNeighbors);
+
+        const std::uint32_t referenceTileSize = static_cast<std::uint32_t>(std::clamp<std::size_t>(referenceTileBytes / std::max<std::size_t>(1, bytesPerPoint), 64, 4096));
+        const std::int64_t numQueryTiles = (static_cast<std::int64_t>(queryEnd - queryBegin) + queryTileSize - 1) / queryTileSize;
+
+#pragma omp parallel
+        {
+            std::vector<Neighbor> heaps(static_cast<std::size_t>(queryTileSize) * numNeighbors);
+            std::vector<std::uint32_t> heapSizes(queryTileSize);
+            std::vector<float> tileDistances(referenceTileSize);
+
+#pragma omp for schedule(dynamic, 1)
+            for (std::int64_t tile = 0; tile < numQueryTiles; tile++)
+            {
+                if (control != nullptr && control->isStopRequested())
+                    continue;
+
+                const std::uint32_t tileBegin = queryBegin + static_cast<std::uint32_t>(tile * queryTileSize);
+                const std::uint32_t tileEnd = std::min(tileBegin + queryTileSize, queryEnd);
+
+                std::fill(heapSizes.begin(), heapSizes.end(), 0u);
+
+                // All queries of the tile are compared to one reference tile while it is in the cache
+                for (std::uint32_t referenceBegin = 0; referenceBegin < numReferences; referenceBegin += referenceTileSize)
+                {
+                    const std::uint32_t referenceEnd = std::min(referenceBegin + referenceTileSize, numReferences);
+
+                    for (std::uint32_t query = tileBegin; query < tileEnd; query++)
+                    {
+                        Neighbor* heap = heaps.data() + static_cast<std::size_t>(query - tileBegin) * numNeighbors;
+                        std::uint32_t& heapSize = heapSizes[query - tileBegin];
+
+                        // Distances first and selection afterwards, so the kernel calls do not wait for the heap
+                        distance(query, referenceBegin, referenceEnd, tileDistances.data());
+
+                        for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+                        {
+                            const float candidateDistance = tileDistances[reference - referenceBegin];
+
+                            // Most candidates are rejected by the comparison with the farthest neighbor so far
+                            if (heapSize == numNeighbors && candidateDistance > heap[0].distance)
+                                continue;
+
+                            if (reference != query)
+                                insertCandidate(heap, heapSize, numNeighbors, { candidateDistance, reference });
+                        }
+                    }
+                }
+
+                for (std::uint32_t query = tileBegin; query < tileEnd; query++)
+                {
+                    Neighbor* heap = heaps.data() + static_cast<std::size_t>(query - tileBegin) * numNeighbors;
+
+                    // Sorting the max-heap yields increasing distances
+                    std::sort_heap(heap, heap + numNeighbors);
+
+                    std::uint32_t* neighbors = knnGraph.neighbors(query - queryBegin);
+                    float* distances = knnGraph.distances(query - queryBegin);
+
+                    for (std::uint32_t k = 0; k < numNeighbors; k++)
+                    {
+                        neighbors[k] = heap[k].index;
+                        distances[k] = heap[k].distance;
+                    }
+                }
+            }
+        }
+
+        return knnGraph;
+    }
+
+    /**
+     * Same search as searchTiled for a provider that is not contiguous, without a dense copy of it
+     * The queries and references are read in blocks: every block of queries keeps the heaps of its queries
+     * while all blocks of references are compared to it, so the references are read once per block of queries
+     */
+    KnnGraph searchBlockwise(const DataProvider& data, std::uint32_t queryBegin, std::uint32_t queryEnd, std::uint32_t numReferences, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, const WorkerControl* control = nullptr)
+    {
+        const std::size_t numDimensions = std::max<std::size_t>(1, data.getNumDimensions());
+        const auto kernel = distance::getKernel(MetricDistance::kernelFor(metric));
+        const bool isCosine = metric == hdi::dr::knn_distance_metric::KNN_METRIC_COSINE;
+
+        // Blocks of points take up to 64 MB, as do the heaps of a block of queries
+        const std::uint32_t referenceBlockSize = static_cast<std::uint32_t>(std::clamp<std::size_t>((std::size_t(1) << 24) / numDimensions, 1024, std::size_t(1) << 20));
+        const std::uint32_t queryBlockSize = std::min(referenceBlockSize, static_cast<std::uint32_t>(std::clamp<std::size_t>((std::size_t(1) << 23) / std::max(1u, numNeighbors), 1024, std::size_t(1) << 20)));
+        const std::uint32_t referenceTileSize = static_cast<std::uint32_t>(std::clamp<std::size_t>(referenceTileBytes / (sizeof(float) * numDimensions), 64, 4096));
+
+        KnnGraph knnGraph(queryEnd - queryBegin, numNeighbors);
+
+        std::vector<float> queries, references, queryInverseNorms, referenceInverseNorms;
+        std::vector<Neighbor> heaps;
+        std::vector<std::uint32_t> heapSizes;
+
+        const auto readPointBlock = [&data, numDimensions, isCosine, kernel](std::uint32_t begin, std::uint32_t count, std::vector<float>& points, std::vector<float>& inverseNorms) {
+            points.resize(count * numDimensions);
+            data.readBlock(begin, count, points.data());
+
+            // Only cosine distances need the norms, see MetricDistance
+            inverseNorms.assign(isCosine ? count : 0, 1.f);
+
+#pragma omp parallel for
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(inverseNorms.size()); i++)
+            {
+                const float* point = points.data() + i * numDimensions;
+                const float norm = std::sqrt(kernel(point, point, numDimensions));
+                inverseNorms[i] = norm > 0.f ? 1.f / norm : 0.f;
+            }
+            };
+
+        for (std::uint32_t blockBegin = queryBegin; blockBegin < queryEnd; blockBegin += queryBlockSize)
+        {
+            const std::uint32_t blockSize = std::min(queryBlockSize, queryEnd - blockBegin);
+
+            readPointBlock(blockBegin, blockSize, queries, queryInverseNorms);
+
+            heaps.resize(static_cast<std::size_t>(blockSize) * numNeighbors);
+            heapSizes.assign(blockSize, 0u);
+
+            for (std::uint32_t referencesBegin = 0; referencesBegin < numReferences; referencesBegin += referenceBlockSize)
+            {
+                if (control != nullptr && control->isStopRequested())
+                    return knnGraph;
+
+                const std::uint32_t numBlockReferences = std::min(referenceBlockSize, numReferences - referencesBegin);
+
+                readPointBlock(referencesBegin, numBlockReferences, references, referenceInverseNorms);
+
+                const std::int64_t numQueryTiles = (static_cast<std::int64_t>(blockSize) + queryTileSize - 1) / queryTileSize;
+
+#pragma omp parallel
+                {
+                    std::vector<float> tileDistances(referenceTileSize);
+
+#pragma omp for schedule(dynamic, 1)
+                    for (std::int64_t tile = 0; tile < numQueryTiles; tile++)
+                    {
+                        const std::uint32_t tileBegin = static_cast<std::uint32_t>(tile * queryTileSize);
+                        const std::uint32_t tileEnd = std::min(tileBegin + queryTileSize, blockSize);
+
+                        // All queries of the tile are compared to one tile of the reference block while it is in the cache
+                        for (std::uint32_t referenceBegin = 0; referenceBegin < numBlockReferences; referenceBegin += referenceTileSize)
+                        {
+                            const std::uint32_t referenceEnd = std::min(referenceBegin + referenceTileSize, numBlockReferences);
+
+                            for (std::uint32_t query = tileBegin; query < tileEnd; query++)
+                            {
+                                Neighbor* heap = heaps.data() + static_cast<std::size_t>(query) * numNeighbors;
+                                std::uint32_t& heapSize = heapSizes[query];
+
+                                const float* queryPoint = queries.data() + query * numDimensions;
+                                const float queryInverseNorm = isCosine ? queryInverseNorms[query] : 1.f;
+
+                                for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+                                {
+                                    const float value = kernel(queryPoint, references.data() + reference * numDimensions, numDimensions);
+                                    tileDistances[reference - referenceBegin] = MetricDistance::fromKernelValue(metric, value, isCosine ? queryInverseNorm * referenceInverseNorms[reference] : 1.f);
+                                }
+
+                                for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+                                {
+                                    const float candidateDistance = tileDistances[reference - referenceBegin];
+
+                                    if (heapSize == numNeighbors && candidateDistance > heap[0].distance)
+                                        continue;
+
+                                    if (referencesBegin + reference != blockBegin + query)
+                                        insertCandidate(heap, heapSize, numNeighbors, { candidateDistance, referencesBegin + reference });
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+#pragma omp parallel for
+            for (std::int64_t query = 0; query < static_cast<std::int64_t>(blockSize); query++)
+            {
+                Neighbor* heap = heaps.data() + query * numNeighbors;
+
+                // Sorting the max-heap yields increasing distances
+                std::sort_heap(heap, heap + numNeighbors);
+
+                const std::uint32_t row = blockBegin - queryBegin + static_cast<std::uint32_t>(query);
+
+                for (std::uint32_t k = 0; k < numNeighbors; k++)
+                {
+                    knnGraph.neighbors(row)[k] = heap[k].index;
+                    knnGraph.distances(row)[k] = heap[k].distance;
+                }
+            }
+        }
+
+        return knnGraph;
+    }
+
+    /** Distance between two full precision points anywhere in memory, with the conventions of MetricDistance */
+    class PointDistance
+    {
+    public:
+        PointDistance(hdi::dr::knn_distance_metric metric, std::uint32_t numDimensions) :
+            _metric(metric),
+            _numDimensions(numDimensions),
+            _kernel(distance::getKernel(MetricDistance::kernelFor(metric))),
+            _dotProduct(distance::getKernel(distance::Kernel::DotProduct))
+        {
+        }
+
+        float operator()(const float* a, const float* b) const
+        {
+            const float value = _kernel(a, b, _numDimensions);
+
+            if (_metric != hdi::dr::knn_distance_metric::KNN_METRIC_COSINE)
+                return MetricDistance::fromKernelValue(_metric, value, 1.f);
+
+            return MetricDistance::fromKernelValue(_metric, value, inverseNorm(a) * inverseNorm(b));
+        }
+
+    private:
+        float inverseNorm(const float* point) const
+        {
+            const float norm = std::sqrt(_dotProduct(point, point, _numDimensions));
+            return norm > 0.f ? 1.f / norm : 0.f;
+        }
+
+    private:
+        hdi::dr::knn_distance_metric    _metric;
+        std::uint32_t                   _numDimensions;
+        distance::KernelFunction        _kernel;
+        distance::KernelFunction        _dotProduct;
+    };
+
+    /** Candidates per neighbor that the search in reduced precision keeps for the re-ranking */
+    std::uint32_t numCandidatesFor(KnnPrecision precision, std::uint32_t numNeighbors)
+    {
+        return precision == KnnPrecision::Int8 ? 2 * numNeighbors : numNeighbors + numNeighbors / 4;
+    }
+
+    /**
+     * The numNeighbors nearest of the candidates of every point by their full precision distances
+     * The points are read in blocks and the candidates of a block are gathered at once, unless the data is contiguous
+     */
+    KnnGraph rerank(const DataProvider& data, const KnnGraph& candidates, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric)
+    {
+        const std::size_t numDimensions = data.getNumDimensions();
+        const std::uint32_t numCandidates = candidates.getNumNeighbors();
+        const float* contiguousData = data.getContiguousData();
+        const PointDistance distance(metric, data.getNumDimensions());
+
+        assert(numNeighbors <= numCandidates);
+
+        KnnGraph knnGraph(candidates.getNumPoints(), numNeighbors);
+
+        // The gathered candidates of a block take up to 64 MB
+        const std::uint32_t blockSize = static_cast<std::uint32_t>(std::clamp<std::size_t>((std::size_t(1) << 24) / (std::max(1u, numCandidates) * std::max<std::size_t>(1, numDimensions)), 16, 4096));
+
+        std::vector<std::uint32_t> blockCandidates;
+        std::vector<float> candidatePoints;
+
+        data.forEachBlock(blockSize, [&](std::uint32_t begin, std::uint32_t count, const float* queries) {
+            if (contiguousData == nullptr)
+            {
+                const std::uint32_t* first = candidates.getIndices().data() + static_cast<std::size_t>(begin) * numCandidates;
+
+                blockCandidates.assign(first, first + static_cast<std::size_t>(count) * numCandidates);
+                std::sort(blockCandidates.begin(), blockCandidates.end());
+                blockCandidates.erase(std::unique(blockCandidates.begin(), blockCandidates.end()), blockCandidates.end());
+
+                candidatePoints.resize(blockCandidates.size() * numDimensions);
+                data.readPoints(blockCandidates.data(), static_cast<std::uint32_t>(blockCandidates.size()), candidatePoints.data());
+            }
+
+#pragma omp parallel
+            {
+                std::vector<Neighbor> neighbors(numCandidates);
+
+#pragma omp for
+                for (std::int64_t q = 0; q < static_cast<std::int64_t>(count); q++)
+                {
+                    const std::uint32_t point = begin + static_cast<std::uint32_t>(q);
+                    const std::uint32_t* pointCandidates = candidates.neighbors(point);
+
+                    for (std::uint32_t c = 0; c < numCandidates; c++)
+                    {
+                        const std::uint32_t candidate = pointCandidates[c];
+                        const std::size_t row = contiguousData != nullptr ? candidate : std::lower_bound(blockCandidates.begin(), blockCandidates.end(), candidate) - blockCandidates.begin();
+                        const float* candidatePoint = (contiguousData != nullptr ? contiguousData : candidatePoints.data()) + row * numDimensions;
+
+                        neighbors[c] = { distance(queries + q * numDimensions, candidatePoint), candidate };
+                    }
+
+                    std::partial_sort(neighbors.begin(), neighbors.begin() + numNeighbors, neighbors.end());
+
+                    for (std::uint32_t k = 0; k < numNeighbors; k++)
+                    {
+                        knnGraph.neighbors(point)[k] = neighbors[k].index;
+                        knnGraph.distances(point)[k] = neighbors[k].distance;
+                    }
+                }
+            }
+            });
+
+        return knnGraph;
+    }
+}
+
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, const WorkerControl* control)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::uint32_t numDimensions = data.getNumDimensions();
+
+    numNeighbors = std::min(numNeighbors, numPoints > 0 ? numPoints - 1 : 0u);
+
+    if (numNeighbors == 0)
+        return KnnGraph(numPoints, 0);
+
+    if (data.getContiguousData() == nullptr)
+        return searchBlockwise(data, 0, numPoints, numPoints, numNeighbors, metric, control);
+
+    return searchTiled(0, numPoints, numPoints, sizeof(float) * numDimensions, numNeighbors, MetricDistance(data.getContiguousData(), numPoints, numDimensions, metric), control);
+}
+
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, KnnPrecision precision, const WorkerControl* control)
+{
+    // Metrics that are not computed from dot products fall back to the dense data
+    if (precision == KnnPrecision::Sparse && SparseDistance::supports(metric))
+        return computeBruteForceKnn(SparseData(data), numNeighbors, metric, control);
+
+    if (isFullKnnPrecision(precision))
+        return computeBruteForceKnn(data, numNeighbors, metric, control);
+
+    const std::uint32_t numPoints = data.getNumPoints();
+
+    numNeighbors = std::min(numNeighbors, numPoints > 0 ? numPoints - 1 : 0u);
+
+    if (numNeighbors == 0)
+        return KnnGraph(numPoints, 0);
+
+    const std::uint32_t numCandidates = std::min(numCandidatesFor(precision, numNeighbors), numPoints - 1);
+
+    KnnGraph candidates;
+    {
+        // Released before the re-ranking reads the full precision candidates
+        const QuantizedData quantizedData(data, precision);
+        const std::size_t bytesPerPoint = quantizedData.getMemoryUsage() / std::max(1u, numPoints);
+
+        // Data that is held in memory anyway is kept for the re-ranking, so the lower precision only saves memory bandwidth
+        if (data.getContiguousData() != nullptr)
+            qDebug() << "Brute-force kNN:" << knnPrecisionName(precision) << "copy of the data uses" << quantizedData.getMemoryUsage() / (1 << 20) << "MB in addition to the 32-bit float data";
+
+        candidates = searchTiled(0, numPoints, numPoints, bytesPerPoint, numCandidates, QuantizedDistance(quantizedData, metric), control);
+    }
+
+    if (control != nullptr && control->isStopRequested())
+        return candidates;
+
+    return rerank(data, candidates, numNeighbors, metric);
+}
+
+KnnGraph computeBruteForceKnn(const SparseData& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, const WorkerControl* control)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+
+    assert(SparseDistance::supports(metric));
+
+    numNeighbors = std::min(numNeighbors, numPoints > 0 ? numPoints - 1 : 0u);
+
+    if (numNeighbors == 0)
+        return KnnGraph(numPoints, 0);
+
+    const std::size_t bytesPerPoint = std::max<std::size_t>(data.getMemoryUsage() / numPoints, 1);
+
+    return searchTiled(0, numPoints, numPoints, bytesPerPoint, numNeighbors, SparseDistance(data, metric), control);
+}
+
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t firstQuery, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::uint32_t numDimensions = data.getNumDimensions();
+
+    assert(firstQuery <= numPoints);
+
+    numNeighbors = std::min(numNeighbors, firstQuery);
+
+    if (numNeighbors == 0)
+        return KnnGraph(numPoints - firstQuery, 0);
+
+    if (data.getContiguousData() == nullptr)
+        return searchBlockwise(data, firstQuery, numPoints, firstQuery, numNeighbors, metric);
+
+    return searchTiled(firstQuery, numPoints, firstQuery, sizeof(float) * numDimensions, numNeighbors, MetricDistance(data.getContiguousData(), numPoints, numDimensions, metric));
+}
+
+float estimateKnnRecall(const DataProvider& data, const KnnGraph& knnGraph, hdi::dr::knn_distance_metric metric, std::uint32_t numSamples)
+{
+    assert(knnGraph.getNumPoints() == data.getNumPoints());
+
+    return estimateKnnRecall(data, knnGraph.getNumNeighbors(), [&knnGraph](std::uint32_t point, const float*, std::vector<std::uint32_t>& neighbors) {
+        neighbors.assign(knnGraph.neighbors(point), knnGraph.neighbors(point) + knnGraph.getNumNeighbors());
+        }, metric, numSamples);
+}
+
+float estimateKnnRecall(const DataProvider& data, std::uint32_t numNeighbors, const KnnSearch& search, hdi::dr::knn_distance_metric metric, std::uint32_t numSamples)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::size_t numDimensions = data.getNumDimensions();
+
+    numNeighbors = std::min(numNeighbors, numPoints > 0 ? numPoints - 1 : 0u);
+
+    numSamples = std::min(numSamples, numPoints);
+
+    if (numSamples == 0 || numNeighbors == 0)
+        return 1.f;
+
+    // Evenly spread samples, their exact neighbors are found in one pass over the data
+    std::vector<std::uint32_t> samples(numSamples);
+
+    for (std::uint32_t s = 0; s < numSamples; s++)
+        samples[s] = static_cast<std::uint32_t>(static_cast<std::uint64_t>(s) * numPoints / numSamples);
+
+    std::vector<float> samplePoints(numSamples * numDimensions);
+    data.readPoints(samples.data(), numSamples, samplePoints.data());
+
+    std::vector<Neighbor> heaps(static_cast<std::size_t>(numSamples) * numNeighbors);
+    std::vector<std::uint32_t> heapSizes(numSamples, 0);
+
+    const PointDistance distance(metric, data.getNumDimensions());
+
+    data.forEachBlock(4096, [&](std::uint32_t begin, std::uint32_t count, const float* block) {
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t s = 0; s < static_cast<std::int64_t>(numSamples); s++)
+        {
+            Neighbor* heap = heaps.data() + s * numNeighbors;
+
+            for (std::uint32_t i = 0; i < count; i++)
+                if (begin + i != samples[s])
+                    insertCandidate(heap, heapSizes[s], numNeighbors, { distance(samplePoints.data() + s * numDimensions, block + i * numDimensions), begin + i });
+        }
+        });
+
+    std::uint64_t numFound = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:numFound)
+    for (std::int64_t s = 0; s < static_cast<std::int64_t>(numSamples); s++)
+    {
+        std::vector<std::uint32_t> exact(numNeighbors), found;
+
+        search(samples[s], samplePoints.data() + s * numDimensions, found);
+        found.resize(std::min<std::size_t>(found.size(), numNeighbors));
+
+        for (std::uint32_t k = 0; k < heapSizes[s]; k++)
+            exact[k] = heaps[static_cast<std::size_t>(s) * numNeighbors + k].index;
+
+        exact.resize(heapSizes[s]);
+
+        std::sort(exact.begin(), exact.end());
+        std::sort(found.begin(), found.end());
+
+        std::vector<std::uint32_t> common;
+        std::set_intersection(exact.begin(), exact.end(), found.begin(), found.end(), std::back_inserter(common));
+
+        numFound += common.size();
+    }
+
+    return static_cast<float>(numFound) / (static_cast<float>(numSamples) * numNeighbors);
+}
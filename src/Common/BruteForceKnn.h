@@ -0,0 +1,82 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "KnnGraph.h"
+#include "KnnParameters.h"
+#include "SparseData.h"
+
+#include "hdi/dimensionality_reduction/knn_utils.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class WorkerControl;
+
+/**
+ * Exact k nearest neighbors by comparing all pairs of points
+ *
+ * Queries and references are processed in tiles that fit into the cache, tiles of queries
+ * are distributed over the OpenMP threads and the distance kernels use the widest SIMD
+ * instruction set of the CPU. Faster than building an approximate index for small and
+ * medium datasets of moderate dimensionality, and exact.
+ *
+ * Distances follow the conventions of HDILib's kNN libraries, see MetricDistance.
+ *
+ * @param data Input points, read block-wise if the provider is not contiguous, without a dense copy
+ * @param numNeighbors Number of neighbors per point, clamped to the number of points - 1
+ * @param metric Distance metric
+ * @param control Polled between tiles of queries, the remaining tiles are skipped and the result is incomplete if a stop was requested
+ */
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, const WorkerControl* control = nullptr);
+
+/**
+ * Exact k nearest neighbors of the points [firstQuery, numPoints) among the points [0, firstQuery),
+ * e.g. of points that were appended to a dataset among the ones that were there before
+ *
+ * @param data Input points, read block-wise if the provider is not contiguous
+ * @param firstQuery First point whose neighbors are searched, row q of the result belongs to point firstQuery + q
+ * @param numNeighbors Number of neighbors per point, clamped to firstQuery
+ * @param metric Distance metric
+ */
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t firstQuery, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric);
+
+/**
+ * Exact k nearest neighbors, searched among the points stored with reduced precision
+ *
+ * The search over the quantized points (see QuantizedData) keeps more candidates than neighbors,
+ * which are re-ranked by their full precision distances. The full data is only read block-wise,
+ * so the search needs a half (16 bit) or a quarter (8 bit) of the memory of a dense copy and less
+ * memory bandwidth. Neighbors that the candidates miss make the result approximate, see estimateKnnRecall.
+ * Sparse searches the non-zero values exactly, see below, or the dense data if the metric is not supported.
+ *
+ * @param precision Storage of the points, Float32 is the search above
+ * @param control Polled between tiles of queries, see above
+ */
+KnnGraph computeBruteForceKnn(const DataProvider& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, KnnPrecision precision, const WorkerControl* control = nullptr);
+
+/**
+ * Exact k nearest neighbors of sparse data, without a dense copy
+ *
+ * Same tiled search as above with the sparse distances of SparseDistance, whose cost depends
+ * on the number of non-zero values instead of the number of dimensions.
+ *
+ * @param metric Distance metric, one that SparseDistance supports
+ * @param control Polled between tiles of queries, see above
+ */
+KnnGraph computeBruteForceKnn(const SparseData& data, std::uint32_t numNeighbors, hdi::dr::knn_distance_metric metric, const WorkerControl* control = nullptr);
+
+/**
+ * Fraction of the exact nearest neighbors that a kNN graph contains, estimated on evenly spread samples
+ * Costs numSamples distance computations per point
+ */
+float estimateKnnRecall(const DataProvider& data, const KnnGraph& knnGraph, hdi::dr::knn_distance_metric metric, std::uint32_t numSamples = 100);
+
+/** Search of the neighbors of a point of the data: its index, its values and the found neighbors without the point itself as output */
+using KnnSearch = std::function<void(std::uint32_t point, const float* query, std::vector<std::uint32_t>& neighbors)>;
+
+/**
+ * Fraction of the exact nearest neighbors among all points that a search finds, estimated on evenly spread samples,
+ * e.g. of an index that is queried without computing the whole kNN graph. The search is called in parallel.
+ */
+float estimateKnnRecall(const DataProvider& data, std::uint32_t numNeighbors, const KnnSearch& search, hdi::dr::knn_distance_metric metric, std::uint32_t numSamples = 100);
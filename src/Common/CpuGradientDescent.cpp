@@ -0,0 +1,158 @@
+#include "CpuGradientDescent.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+
+void CpuGradientDescent::initialize(const SparseMatrix& probabilities, Embedding* embedding, hdi::dr::TsneParameters params)
+{
+    initializeImpl(std::make_shared<const SparseMatrix>(probabilities.symmetrized()), embedding, params);
+}
+
+void CpuGradientDescent::initializeWithJointProbabilityDistribution(std::shared_ptr<const SparseMatrix> jointProbabilities, Embedding* embedding, hdi::dr::TsneParameters params)
+{
+    assert(jointProbabilities != nullptr);
+    initializeImpl(std::move(jointProbabilities), embedding, params);
+}
+
+void CpuGradientDescent::initializeImpl(std::shared_ptr<const SparseMatrix> jointProbabilities, Embedding* embedding, const hdi::dr::TsneParameters& params)
+{
+    assert(embedding != nullptr);
+    assert(params._embedding_dimensionality == 2);
+
+    _P          = std::move(jointProbabilities);
+    _embedding  = embedding;
+    _params     = params;
+    _numPoints  = _P->getNumRows();
+    _iteration  = 0;
+
+    const double sum = _P->sum();
+    _normalization = sum > 0. ? 1. / sum : 1.;
+
+    if (!_params._presetEmbedding)
+        initializeEmbeddingPositions();
+
+    assert(_embedding->getContainer().size() == 2ull * _numPoints);
+
+    _repulsiveForces.assign(2ull * _numPoints, 0.f);
+    _gradient.assign(2ull * _numPoints, 0.f);
+    _gains.assign(2ull * _numPoints, 1.f);
+    _velocity.assign(2ull * _numPoints, 0.f);
+
+    onInitialized();
+
+    _initialized = true;
+}
+
+void CpuGradientDescent::initializeEmbeddingPositions()
+{
+    auto& positions = _embedding->getContainer();
+    positions.resize(2ull * _numPoints);
+
+    std::mt19937 generator(_params._seed < 0 ? std::random_device()() : static_cast<std::uint32_t>(_params._seed));
+    std::normal_distribution<float> distribution(0.f, 1e-4f);
+
+    for (auto& position : positions)
+        position = distribution(generator);
+}
+
+double CpuGradientDescent::exaggerationFactor() const
+{
+    // Same schedule as HDILib's gradient descent
+    if (_iteration < _params._remove_exaggeration_iter)
+        return _params._exaggeration_factor;
+
+    if (_iteration < _params._remove_exaggeration_iter + _params._exponential_decay_iter)
+    {
+        const double decay = 1. - double(_iteration - _params._remove_exaggeration_iter) / _params._exponential_decay_iter;
+        return 1. + (_params._exaggeration_factor - 1.) * decay;
+    }
+
+    return 1.;
+}
+
+void CpuGradientDescent::doAnIteration()
+{
+    assert(_initialized);
+
+    float* positions = _embedding->getContainer().data();
+
+    const double sumQ = computeRepulsiveForces(positions, _repulsiveForces.data());
+
+    const float attractiveScale = static_cast<float>(exaggerationFactor() * _normalization);
+    const float repulsiveScale  = static_cast<float>(1. / std::max(sumQ, 1e-12));
+    const float momentum        = static_cast<float>(_iteration < _params._mom_switching_iter ? _params._momentum : _params._final_momentum);
+    const float eta             = static_cast<float>(_params._eta);
+    const float minimumGain     = static_cast<float>(_params._minimum_gain);
+
+    const auto& rowOffsets  = _P->getRowOffsets();
+    const auto& columns     = _P->getColumns();
+    const auto& values      = _P->getValues();
+
+    const std::int64_t numPoints = _numPoints;
+
+    // The positions are only read while computing the gradients, all updates are applied afterwards
+    float* gradient = _gradient.data();
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t i = 0; i < numPoints; i++)
+    {
+        const float x = positions[2 * i];
+        const float y = positions[2 * i + 1];
+
+        float attractiveX = 0.f, attractiveY = 0.f;
+
+        SNE_OMP_SIMD_REDUCTION(+:attractiveX, attractiveY)
+        for (std::uint64_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)
+        {
+            const std::uint32_t j = columns[k];
+            const float dx = x - positions[2ull * j];
+            const float dy = y - positions[2ull * j + 1];
+            const float pq = values[k] / (1.f + dx * dx + dy * dy);
+
+            attractiveX += pq * dx;
+            attractiveY += pq * dy;
+        }
+
+        gradient[2 * i]     = attractiveScale * attractiveX - repulsiveScale * _repulsiveForces[2 * i];
+        gradient[2 * i + 1] = attractiveScale * attractiveY - repulsiveScale * _repulsiveForces[2 * i + 1];
+    }
+
+    const std::int64_t numCoordinates = 2 * numPoints;
+    double sumX = 0., sumY = 0.;
+
+#pragma omp parallel for reduction(+:sumX, sumY)
+    for (std::int64_t i = 0; i < numCoordinates; i++)
+    {
+        const float g = gradient[i];
+
+        // Increase the gain if the gradient changed direction w.r.t. the last step
+        float gain = (g > 0.f) != (_velocity[i] > 0.f) ? _gains[i] + 0.2f : _gains[i] * 0.8f;
+        gain = std::max(gain, minimumGain);
+        _gains[i] = gain;
+
+        _velocity[i] = momentum * _velocity[i] - eta * gain * g;
+        positions[i] += _velocity[i];
+
+        if (i % 2 == 0)
+            sumX += positions[i];
+        else
+            sumY += positions[i];
+    }
+
+    // Keep the embedding centered at the origin
+    const float meanX = static_cast<float>(sumX / numPoints);
+    const float meanY = static_cast<float>(sumY / numPoints);
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < numPoints; i++)
+    {
+        positions[2 * i] -= meanX;
+        positions[2 * i + 1] -= meanY;
+    }
+
+    ++_iteration;
+}
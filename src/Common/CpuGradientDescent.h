@@ -0,0 +1,73 @@
+#pragma once
+
+#include "SparseMatrix.h"
+
+#include "hdi/data/embedding.h"
+#include "hdi/dimensionality_reduction/tsne_parameters.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * CpuGradientDescent
+ *
+ * Multi-threaded t-SNE gradient descent on the CPU for 2D embeddings.
+ * Mirrors the interface and optimization schedule (gains, momentum, exaggeration) of
+ * hdi::dr::SparseTSNEUserDefProbabilities, the attractive forces are computed on a CSR
+ * copy of the joint probabilities in parallel over the points.
+ * Derived classes provide the approximation of the repulsive forces.
+ */
+class CpuGradientDescent
+{
+public:
+    using Embedding = hdi::data::Embedding<float>;
+
+public:
+    CpuGradientDescent() = default;
+    virtual ~CpuGradientDescent() = default;
+
+    /** Initialize with a non-symmetric probability distribution, e.g. an HSNE transition matrix, which is symmetrized here */
+    void initialize(const SparseMatrix& probabilities, Embedding* embedding, hdi::dr::TsneParameters params);
+
+    /** Initialize with a symmetric joint probability distribution that is shared with, not copied from, the caller */
+    void initializeWithJointProbabilityDistribution(std::shared_ptr<const SparseMatrix> jointProbabilities, Embedding* embedding, hdi::dr::TsneParameters params);
+
+    /** Perform one gradient descent step */
+    void doAnIteration();
+
+    bool isInitialized() const { return _initialized; }
+    int iteration() const { return _iteration; }
+
+protected:
+    /**
+     * Compute the repulsive forces sum_j q_ij^2 (y_i - y_j) for all points
+     * @param positions Interleaved xy positions
+     * @param forces Output, interleaved xy forces
+     * @return Normalization sum_{i != j} q_ij
+     */
+    virtual double computeRepulsiveForces(const float* positions, float* forces) = 0;
+
+    /** Called once after the probabilities and embedding are set up */
+    virtual void onInitialized() {}
+
+    std::uint32_t getNumPoints() const { return _numPoints; }
+
+private:
+    void initializeImpl(std::shared_ptr<const SparseMatrix> jointProbabilities, Embedding* embedding, const hdi::dr::TsneParameters& params);
+    void initializeEmbeddingPositions();
+    double exaggerationFactor() const;
+
+private:
+    std::shared_ptr<const SparseMatrix>     _P;                     /** Symmetric joint probabilities */
+    double                                  _normalization = 1.;    /** Scales _P such that its entries sum to one */
+    Embedding*                              _embedding = nullptr;   /** Embedding that is optimized, not owned */
+    hdi::dr::TsneParameters                 _params;                /** Optimization parameters */
+    std::uint32_t                           _numPoints = 0;         /** Number of embedded points */
+    int                                     _iteration = 0;         /** Current iteration */
+    bool                                    _initialized = false;   /** Whether initialize was called */
+    std::vector<float>                      _repulsiveForces;       /** Per-iteration repulsive forces, interleaved xy */
+    std::vector<float>                      _gradient;              /** Per-iteration gradient, interleaved xy */
+    std::vector<float>                      _gains;                 /** Per-coordinate adaptive gains */
+    std::vector<float>                      _velocity;              /** Per-coordinate momentum term */
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * DataProvider
+ *
+ * Read access to the high-dimensional input of the similarity computation, row-major
+ * with getNumDimensions() floats per point. Consumers read the data in blocks of points,
+ * so it does not have to be copied into one dense array. Sources that already store
+ * the data contiguously expose it directly.
+ */
+class DataProvider
+{
+public:
+    /** Dense view on all data, owns a copy only if the provider is not contiguous */
+    class DenseData
+    {
+    public:
+        DenseData(const float* data, std::vector<float>&& storage) :
+            _data(data),
+            _storage(std::move(storage))
+        {
+        }
+
+        const float* data() const { return _data; }
+        bool isCopy() const { return !_storage.empty(); }
+
+    private:
+        const float*        _data;      /** Contiguous data, points into _storage for a copy */
+        std::vector<float>  _storage;   /** Dense copy, empty for a view */
+    };
+
+public:
+    virtual ~DataProvider() = default;
+
+    virtual std::uint32_t getNumPoints() const = 0;
+    virtual std::uint32_t getNumDimensions() const = 0;
+
+    /** Contiguous data of all points, nullptr if the data is only available in blocks */
+    virtual const float* getContiguousData() const { return nullptr; }
+
+    /**
+     * Copy the points [begin, begin + count) into a buffer
+     * @param out Row-major output with room for count * getNumDimensions() floats
+     */
+    virtual void readBlock(std::uint32_t begin, std::uint32_t count, float* out) const = 0;
+
+    /**
+     * Copy the points with the given indices into a buffer, e.g. scattered candidates of a search
+     * @param out Row-major output with room for count * getNumDimensions() floats
+     */
+    virtual void readPoints(const std::uint32_t* indices, std::uint32_t count, float* out) const
+    {
+        const std::size_t numDimensions = getNumDimensions();
+        const float* contiguousData = getContiguousData();
+
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            if (contiguousData != nullptr)
+                std::copy_n(contiguousData + indices[i] * numDimensions, numDimensions, out + i * numDimensions);
+            else
+                readBlock(indices[i], 1, out + i * numDimensions);
+        }
+    }
+
+    /**
+     * Call function(begin, count, data) for consecutive blocks of at most blockSize points
+     * Contiguous providers pass views on their data, others read every block into one reused buffer
+     */
+    template <typename Function>
+    void forEachBlock(std::uint32_t blockSize, Function function) const
+    {
+        assert(blockSize > 0);
+
+        const std::uint32_t numPoints = getNumPoints();
+        const std::uint64_t numDimensions = getNumDimensions();
+        const float* contiguousData = getContiguousData();
+
+        std::vector<float> buffer;
+
+        if (contiguousData == nullptr)
+            buffer.resize(std::min(blockSize, numPoints) * numDimensions);
+
+        for (std::uint32_t begin = 0; begin < numPoints; begin += blockSize)
+        {
+            const std::uint32_t count = std::min(blockSize, numPoints - begin);
+
+            if (contiguousData != nullptr)
+            {
+                function(begin, count, contiguousData + begin * numDimensions);
+            }
+            else
+            {
+                readBlock(begin, count, buffer.data());
+                function(begin, count, static_cast<const float*>(buffer.data()));
+            }
+        }
+    }
+
+    /** All data in one array, for consumers that cannot work in blocks. Only copies if the provider is not contiguous */
+    DenseData getDenseData(std::uint32_t blockSize = 65536) const
+    {
+        if (const float* contiguousData = getContiguousData())
+            return DenseData(contiguousData, {});
+
+        std::vector<float> storage(static_cast<std::size_t>(getNumPoints()) * getNumDimensions());
+
+        forEachBlock(blockSize, [this, &storage](std::uint32_t begin, std::uint32_t count, const float* data) {
+            std::copy(data, data + static_cast<std::size_t>(count) * getNumDimensions(), storage.begin() + static_cast<std::size_t>(begin) * getNumDimensions());
+            });
+
+        const float* data = storage.data();
+
+        return DenseData(data, std::move(storage));
+    }
+};
+
+/**
+ * VectorDataProvider
+ *
+ * Provides data that is held in a dense vector
+ */
+class VectorDataProvider : public DataProvider
+{
+public:
+    VectorDataProvider(std::vector<float>&& data, std::uint32_t numDimensions) :
+        _data(std::move(data)),
+        _numDimensions(numDimensions)
+    {
+        assert(numDimensions > 0 && _data.size() % numDimensions == 0);
+    }
+
+    std::uint32_t getNumPoints() const override { return static_cast<std::uint32_t>(_data.size() / _numDimensions); }
+    std::uint32_t getNumDimensions() const override { return _numDimensions; }
+
+    const float* getContiguousData() const override { return _data.data(); }
+
+    void readBlock(std::uint32_t begin, std::uint32_t count, float* out) const override
+    {
+        assert(static_cast<std::size_t>(begin + count) * _numDimensions <= _data.size());
+        std::copy_n(_data.data() + static_cast<std::size_t>(begin) * _numDimensions, static_cast<std::size_t>(count) * _numDimensions, out);
+    }
+
+private:
+    std::vector<float>  _data;              /** Row-major data */
+    std::uint32_t       _numDimensions;     /** Number of dimensions per point */
+};
@@ -0,0 +1,646 @@
+#include "DistanceKernels.h"
+
+#include "ParallelUtils.h"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SNE_X86
+    #include <immintrin.h>
+
+    // GCC and Clang only emit AVX instructions in functions that opt in, MSVC always allows the intrinsics
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define SNE_TARGET_AVX2
+        #define SNE_TARGET_AVX512
+    #else
+        #define SNE_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+        #define SNE_TARGET_AVX512 __attribute__((target("avx512f")))
+    #endif
+#endif
+
+namespace distance
+{
+    namespace
+    {
+        // Scalar kernels, vectorized by the compiler for the baseline instruction set
+
+        float squaredEuclideanScalar(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const std::int64_t n = numDimensions;
+            float sum = 0;
+
+            SNE_OMP_SIMD_REDUCTION(+:sum)
+            for (std::int64_t i = 0; i < n; i++)
+            {
+                const float d = a[i] - b[i];
+                sum += d * d;
+            }
+
+            return sum;
+        }
+
+        float manhattanScalar(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const std::int64_t n = numDimensions;
+            float sum = 0;
+
+            SNE_OMP_SIMD_REDUCTION(+:sum)
+            for (std::int64_t i = 0; i < n; i++)
+                sum += std::fabs(a[i] - b[i]);
+
+            return sum;
+        }
+
+        float dotProductScalar(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const std::int64_t n = numDimensions;
+            float sum = 0;
+
+            SNE_OMP_SIMD_REDUCTION(+:sum)
+            for (std::int64_t i = 0; i < n; i++)
+                sum += a[i] * b[i];
+
+            return sum;
+        }
+
+        float hammingScalar(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const std::int64_t n = numDimensions;
+            float sum = 0;
+
+            SNE_OMP_SIMD_REDUCTION(+:sum)
+            for (std::int64_t i = 0; i < n; i++)
+                sum += a[i] != b[i] ? 1.f : 0.f;
+
+            return sum;
+        }
+
+        // Reduced precision kernels: b is decoded to floats and the terms of the kernel are summed as above
+
+        template <Kernel kernel>
+        inline float term(float a, float b)
+        {
+            if constexpr (kernel == Kernel::SquaredEuclidean)
+                return (a - b) * (a - b);
+            else if constexpr (kernel == Kernel::Manhattan)
+                return std::fabs(a - b);
+            else if constexpr (kernel == Kernel::DotProduct)
+                return a * b;
+            else
+                return a != b ? 1.f : 0.f;
+        }
+
+        template <Kernel kernel>
+        float halfScalar(const float* a, const std::uint16_t* b, std::uint32_t numDimensions)
+        {
+            float sum = 0;
+
+            for (std::uint32_t i = 0; i < numDimensions; i++)
+                sum += term<kernel>(a[i], halfToFloat(b[i]));
+
+            return sum;
+        }
+
+        template <Kernel kernel>
+        float byteScalar(const float* a, const std::uint8_t* b, const float* scales, const float* offsets, std::uint32_t numDimensions)
+        {
+            const std::int64_t n = numDimensions;
+            float sum = 0;
+
+            SNE_OMP_SIMD_REDUCTION(+:sum)
+            for (std::int64_t i = 0; i < n; i++)
+                sum += term<kernel>(a[i], offsets[i] + scales[i] * b[i]);
+
+            return sum;
+        }
+
+#ifdef SNE_X86
+        // AVX2 kernels, 8 floats per step and a scalar tail
+
+        SNE_TARGET_AVX2 float horizontalSum(__m256 v)
+        {
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+            return _mm_cvtss_f32(sum);
+        }
+
+        SNE_TARGET_AVX2 float squaredEuclideanAVX2(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+            {
+                const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+                acc = _mm256_fmadd_ps(d, d, acc);
+            }
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += (a[i] - b[i]) * (a[i] - b[i]);
+
+            return sum;
+        }
+
+        SNE_TARGET_AVX2 float manhattanAVX2(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const __m256 signMask = _mm256_set1_ps(-0.f);
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+            {
+                const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+                acc = _mm256_add_ps(acc, _mm256_andnot_ps(signMask, d));
+            }
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += std::fabs(a[i] - b[i]);
+
+            return sum;
+        }
+
+        SNE_TARGET_AVX2 float dotProductAVX2(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+                acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += a[i] * b[i];
+
+            return sum;
+        }
+
+        SNE_TARGET_AVX2 float hammingAVX2(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const __m256 ones = _mm256_set1_ps(1.f);
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+            {
+                const __m256 notEqual = _mm256_cmp_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _CMP_NEQ_UQ);
+                acc = _mm256_add_ps(acc, _mm256_and_ps(notEqual, ones));
+            }
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += a[i] != b[i] ? 1.f : 0.f;
+
+            return sum;
+        }
+
+        // Reduced precision AVX2 kernels, 8 values are decoded per step (F16C for half floats)
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX2 inline __m256 accumulate(__m256 acc, __m256 a, __m256 b)
+        {
+            if constexpr (kernel == Kernel::SquaredEuclidean)
+            {
+                const __m256 d = _mm256_sub_ps(a, b);
+                return _mm256_fmadd_ps(d, d, acc);
+            }
+            else if constexpr (kernel == Kernel::Manhattan)
+                return _mm256_add_ps(acc, _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_sub_ps(a, b)));
+            else if constexpr (kernel == Kernel::DotProduct)
+                return _mm256_fmadd_ps(a, b, acc);
+            else
+                return _mm256_add_ps(acc, _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_NEQ_UQ), _mm256_set1_ps(1.f)));
+        }
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX2 float halfAVX2(const float* a, const std::uint16_t* b, std::uint32_t numDimensions)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+                acc = accumulate<kernel>(acc, _mm256_loadu_ps(a + i), _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += term<kernel>(a[i], halfToFloat(b[i]));
+
+            return sum;
+        }
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX2 float byteAVX2(const float* a, const std::uint8_t* b, const float* scales, const float* offsets, std::uint32_t numDimensions)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 8 <= numDimensions; i += 8)
+            {
+                const __m256 codes = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i))));
+                const __m256 values = _mm256_fmadd_ps(_mm256_loadu_ps(scales + i), codes, _mm256_loadu_ps(offsets + i));
+
+                acc = accumulate<kernel>(acc, _mm256_loadu_ps(a + i), values);
+            }
+
+            float sum = horizontalSum(acc);
+
+            for (; i < numDimensions; i++)
+                sum += term<kernel>(a[i], offsets[i] + scales[i] * b[i]);
+
+            return sum;
+        }
+
+        // AVX-512 kernels, 16 floats per step and a masked tail
+
+        SNE_TARGET_AVX512 __mmask16 tailMask(std::uint32_t remaining)
+        {
+            return static_cast<__mmask16>((1u << remaining) - 1u);
+        }
+
+        SNE_TARGET_AVX512 float squaredEuclideanAVX512(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            __m512 acc = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 16 <= numDimensions; i += 16)
+            {
+                const __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+                acc = _mm512_fmadd_ps(d, d, acc);
+            }
+
+            if (i < numDimensions)
+            {
+                const __mmask16 mask = tailMask(numDimensions - i);
+                const __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+                acc = _mm512_fmadd_ps(d, d, acc);
+            }
+
+            return _mm512_reduce_add_ps(acc);
+        }
+
+        SNE_TARGET_AVX512 float manhattanAVX512(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            __m512 acc = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 16 <= numDimensions; i += 16)
+                acc = _mm512_add_ps(acc, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i))));
+
+            if (i < numDimensions)
+            {
+                const __mmask16 mask = tailMask(numDimensions - i);
+                acc = _mm512_add_ps(acc, _mm512_abs_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i))));
+            }
+
+            return _mm512_reduce_add_ps(acc);
+        }
+
+        SNE_TARGET_AVX512 float dotProductAVX512(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            __m512 acc = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 16 <= numDimensions; i += 16)
+                acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+
+            if (i < numDimensions)
+            {
+                const __mmask16 mask = tailMask(numDimensions - i);
+                acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc);
+            }
+
+            return _mm512_reduce_add_ps(acc);
+        }
+
+        SNE_TARGET_AVX512 float hammingAVX512(const float* a, const float* b, std::uint32_t numDimensions)
+        {
+            const __m512 ones = _mm512_set1_ps(1.f);
+            __m512 acc = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 16 <= numDimensions; i += 16)
+            {
+                const __mmask16 notEqual = _mm512_cmp_ps_mask(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _CMP_NEQ_UQ);
+                acc = _mm512_mask_add_ps(acc, notEqual, acc, ones);
+            }
+
+            if (i < numDimensions)
+            {
+                const __mmask16 mask = tailMask(numDimensions - i);
+                const __mmask16 notEqual = _mm512_mask_cmp_ps_mask(mask, _mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), _CMP_NEQ_UQ);
+                acc = _mm512_mask_add_ps(acc, notEqual, acc, ones);
+            }
+
+            return _mm512_reduce_add_ps(acc);
+        }
+
+        // Reduced precision AVX-512 kernels, 16 values are decoded per step and the tail is scalar
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX512 inline __m512 accumulate(__m512 acc, __m512 a, __m512 b)
+        {
+            if constexpr (kernel == Kernel::SquaredEuclidean)
+            {
+                const __m512 d = _mm512_sub_ps(a, b);
+                return _mm512_fmadd_ps(d, d, acc);
+            }
+            else if constexpr (kernel == Kernel::Manhattan)
+                return _mm512_add_ps(acc, _mm512_abs_ps(_mm512_sub_ps(a, b)));
+            else if constexpr (kernel == Kernel::DotProduct)
+                return _mm512_fmadd_ps(a, b, acc);
+            else
+                return _mm512_mask_add_ps(acc, _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ), acc, _mm512_set1_ps(1.f));
+        }
+
+        SNE_TARGET_AVX512 inline __m512 loadHalf16(const std::uint16_t* b)
+        {
+            return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+        }
+
+        SNE_TARGET_AVX512 inline __m512 loadByte16(const std::uint8_t* b, const float* scales, const float* offsets)
+        {
+            const __m512 codes = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b))));
+            return _mm512_fmadd_ps(_mm512_loadu_ps(scales), codes, _mm512_loadu_ps(offsets));
+        }
+
+        // Two accumulators, so that the decoding of the next values overlaps with the latency of the last accumulation
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX512 float halfAVX512(const float* a, const std::uint16_t* b, std::uint32_t numDimensions)
+        {
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 32 <= numDimensions; i += 32)
+            {
+                acc0 = accumulate<kernel>(acc0, _mm512_loadu_ps(a + i), loadHalf16(b + i));
+                acc1 = accumulate<kernel>(acc1, _mm512_loadu_ps(a + i + 16), loadHalf16(b + i + 16));
+            }
+
+            if (i + 16 <= numDimensions)
+            {
+                acc0 = accumulate<kernel>(acc0, _mm512_loadu_ps(a + i), loadHalf16(b + i));
+                i += 16;
+            }
+
+            float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+            for (; i < numDimensions; i++)
+                sum += term<kernel>(a[i], halfToFloat(b[i]));
+
+            return sum;
+        }
+
+        template <Kernel kernel>
+        SNE_TARGET_AVX512 float byteAVX512(const float* a, const std::uint8_t* b, const float* scales, const float* offsets, std::uint32_t numDimensions)
+        {
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+            std::uint32_t i = 0;
+
+            for (; i + 32 <= numDimensions; i += 32)
+            {
+                acc0 = accumulate<kernel>(acc0, _mm512_loadu_ps(a + i), loadByte16(b + i, scales + i, offsets + i));
+                acc1 = accumulate<kernel>(acc1, _mm512_loadu_ps(a + i + 16), loadByte16(b + i + 16, scales + i + 16, offsets + i + 16));
+            }
+
+            if (i + 16 <= numDimensions)
+            {
+                acc0 = accumulate<kernel>(acc0, _mm512_loadu_ps(a + i), loadByte16(b + i, scales + i, offsets + i));
+                i += 16;
+            }
+
+            float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+            for (; i < numDimensions; i++)
+                sum += term<kernel>(a[i], offsets[i] + scales[i] * b[i]);
+
+            return sum;
+        }
+
+        SimdLevel querySimdLevel()
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return SimdLevel::Scalar;
+
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool fma = (info[2] & (1 << 12)) != 0;
+            const bool f16c = (info[2] & (1 << 29)) != 0;
+
+            if (!osxsave)
+                return SimdLevel::Scalar;
+
+            // The OS has to save the YMM (and ZMM) registers on context switches
+            const unsigned long long xcr0 = _xgetbv(0);
+
+            __cpuidex(info, 7, 0);
+            const bool avx2 = (info[1] & (1 << 5)) != 0;
+            const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+            if (avx512f && (xcr0 & 0xE6) == 0xE6)
+                return SimdLevel::AVX512;
+
+            if (avx2 && fma && f16c && (xcr0 & 0x6) == 0x6)
+                return SimdLevel::AVX2;
+
+            return SimdLevel::Scalar;
+#else
+            __builtin_cpu_init();
+
+            if (__builtin_cpu_supports("avx512f"))
+                return SimdLevel::AVX512;
+
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c"))
+                return SimdLevel::AVX2;
+
+            return SimdLevel::Scalar;
+#endif
+        }
+#else
+        SimdLevel querySimdLevel()
+        {
+            return SimdLevel::Scalar;
+        }
+#endif
+    }
+
+    SimdLevel detectSimdLevel()
+    {
+        static const SimdLevel simdLevel = querySimdLevel();
+        return simdLevel;
+    }
+
+    const char* simdLevelName(SimdLevel simdLevel)
+    {
+        switch (simdLevel)
+        {
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default:                return "scalar";
+        }
+    }
+
+    KernelFunction getKernel(Kernel kernel, SimdLevel simdLevel)
+    {
+#ifdef SNE_X86
+        if (simdLevel == SimdLevel::AVX512)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return squaredEuclideanAVX512;
+            case Kernel::Manhattan:         return manhattanAVX512;
+            case Kernel::DotProduct:        return dotProductAVX512;
+            case Kernel::Hamming:           return hammingAVX512;
+            }
+        }
+
+        if (simdLevel == SimdLevel::AVX2)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return squaredEuclideanAVX2;
+            case Kernel::Manhattan:         return manhattanAVX2;
+            case Kernel::DotProduct:        return dotProductAVX2;
+            case Kernel::Hamming:           return hammingAVX2;
+            }
+        }
+#endif
+
+        switch (kernel)
+        {
+        case Kernel::Manhattan:     return manhattanScalar;
+        case Kernel::DotProduct:    return dotProductScalar;
+        case Kernel::Hamming:       return hammingScalar;
+        default:                    return squaredEuclideanScalar;
+        }
+    }
+
+    HalfKernelFunction getHalfKernel(Kernel kernel, SimdLevel simdLevel)
+    {
+#ifdef SNE_X86
+        if (simdLevel == SimdLevel::AVX512)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return halfAVX512<Kernel::SquaredEuclidean>;
+            case Kernel::Manhattan:         return halfAVX512<Kernel::Manhattan>;
+            case Kernel::DotProduct:        return halfAVX512<Kernel::DotProduct>;
+            case Kernel::Hamming:           return halfAVX512<Kernel::Hamming>;
+            }
+        }
+
+        if (simdLevel == SimdLevel::AVX2)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return halfAVX2<Kernel::SquaredEuclidean>;
+            case Kernel::Manhattan:         return halfAVX2<Kernel::Manhattan>;
+            case Kernel::DotProduct:        return halfAVX2<Kernel::DotProduct>;
+            case Kernel::Hamming:           return halfAVX2<Kernel::Hamming>;
+            }
+        }
+#endif
+
+        switch (kernel)
+        {
+        case Kernel::Manhattan:     return halfScalar<Kernel::Manhattan>;
+        case Kernel::DotProduct:    return halfScalar<Kernel::DotProduct>;
+        case Kernel::Hamming:       return halfScalar<Kernel::Hamming>;
+        default:                    return halfScalar<Kernel::SquaredEuclidean>;
+        }
+    }
+
+    ByteKernelFunction getByteKernel(Kernel kernel, SimdLevel simdLevel)
+    {
+#ifdef SNE_X86
+        if (simdLevel == SimdLevel::AVX512)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return byteAVX512<Kernel::SquaredEuclidean>;
+            case Kernel::Manhattan:         return byteAVX512<Kernel::Manhattan>;
+            case Kernel::DotProduct:        return byteAVX512<Kernel::DotProduct>;
+            case Kernel::Hamming:           return byteAVX512<Kernel::Hamming>;
+            }
+        }
+
+        if (simdLevel == SimdLevel::AVX2)
+        {
+            switch (kernel)
+            {
+            case Kernel::SquaredEuclidean:  return byteAVX2<Kernel::SquaredEuclidean>;
+            case Kernel::Manhattan:         return byteAVX2<Kernel::Manhattan>;
+            case Kernel::DotProduct:        return byteAVX2<Kernel::DotProduct>;
+            case Kernel::Hamming:           return byteAVX2<Kernel::Hamming>;
+            }
+        }
+#endif
+
+        switch (kernel)
+        {
+        case Kernel::Manhattan:     return byteScalar<Kernel::Manhattan>;
+        case Kernel::DotProduct:    return byteScalar<Kernel::DotProduct>;
+        case Kernel::Hamming:       return byteScalar<Kernel::Hamming>;
+        default:                    return byteScalar<Kernel::SquaredEuclidean>;
+        }
+    }
+
+    std::uint16_t floatToHalf(float value)
+    {
+        const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+        const std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+        const std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+        // Infinity and NaN, which stays a (quiet) NaN
+        if (magnitude >= 0x7F800000u)
+            return static_cast<std::uint16_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x0200u : 0u));
+
+        // At least 65520 rounds to infinity
+        if (magnitude >= 0x477FF000u)
+            return static_cast<std::uint16_t>(sign | 0x7C00u);
+
+        // Below 2^-14 the result is subnormal, multiples of 2^-24
+        if (magnitude < 0x38800000u)
+            return static_cast<std::uint16_t>(sign | static_cast<std::uint16_t>(std::nearbyint(std::bit_cast<float>(magnitude) * 16777216.f)));
+
+        // Rebias the exponent, drop 13 mantissa bits and round to the nearest even, a carry correctly increments the exponent
+        std::uint32_t half = (magnitude >> 13) - ((127u - 15u) << 10);
+        const std::uint32_t remainder = magnitude & 0x1FFFu;
+
+        if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+            half++;
+
+        return static_cast<std::uint16_t>(sign | half);
+    }
+
+    float halfToFloat(std::uint16_t value)
+    {
+        const std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+        const std::uint32_t exponent = (value >> 10) & 0x1Fu;
+        const std::uint32_t mantissa = value & 0x3FFu;
+
+        if (exponent == 0)
+        {
+            const float subnormal = static_cast<float>(mantissa) * (1.f / 16777216.f);
+            return sign != 0 ? -subnormal : subnormal;
+        }
+
+        if (exponent == 0x1F)
+            return std::bit_cast<float>(sign | 0x7F800000u | (mantissa << 13));
+
+        return std::bit_cast<float>(sign | ((exponent + 127u - 15u) << 23) | (mantissa << 13));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Distance kernels between two points of the same dimensionality.
+ * Every kernel is compiled for several instruction sets, the best one the CPU supports is chosen at runtime.
+ */
+namespace distance
+{
+    enum class SimdLevel
+    {
+        Scalar,
+        AVX2,       /** AVX2, FMA and F16C */
+        AVX512      /** AVX-512 foundation */
+    };
+
+    enum class Kernel
+    {
+        SquaredEuclidean,   /** sum (a_i - b_i)^2 */
+        Manhattan,          /** sum |a_i - b_i| */
+        DotProduct,         /** sum a_i * b_i */
+        Hamming             /** Number of dimensions with a_i != b_i */
+    };
+
+    using KernelFunction = float (*)(const float* a, const float* b, std::uint32_t numDimensions);
+
+    /** Kernel between a float point a and a point b stored as half precision floats */
+    using HalfKernelFunction = float (*)(const float* a, const std::uint16_t* b, std::uint32_t numDimensions);
+
+    /** Kernel between a float point a and a point b stored as bytes, which stand for offsets[i] + scales[i] * b[i] */
+    using ByteKernelFunction = float (*)(const float* a, const std::uint8_t* b, const float* scales, const float* offsets, std::uint32_t numDimensions);
+
+    /** Widest instruction set supported by the CPU and the compiler, detected once */
+    SimdLevel detectSimdLevel();
+
+    const char* simdLevelName(SimdLevel simdLevel);
+
+    /** Implementation of the kernel for the instruction set, which must be supported by the CPU */
+    KernelFunction getKernel(Kernel kernel, SimdLevel simdLevel);
+
+    /** Implementation of the kernel for the detected instruction set */
+    inline KernelFunction getKernel(Kernel kernel) { return getKernel(kernel, detectSimdLevel()); }
+
+    /** Implementations of the kernel for points stored with reduced precision, see QuantizedData */
+    HalfKernelFunction getHalfKernel(Kernel kernel, SimdLevel simdLevel);
+    ByteKernelFunction getByteKernel(Kernel kernel, SimdLevel simdLevel);
+
+    inline HalfKernelFunction getHalfKernel(Kernel kernel) { return getHalfKernel(kernel, detectSimdLevel()); }
+    inline ByteKernelFunction getByteKernel(Kernel kernel) { return getByteKernel(kernel, detectSimdLevel()); }
+
+    /** IEEE 754 half precision conversions, rounding to the nearest value */
+    std::uint16_t floatToHalf(float value);
+    float halfToFloat(std::uint16_t value);
+}
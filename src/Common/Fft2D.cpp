@@ -0,0 +1,109 @@
+#include "Fft2D.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numbers>
+#include <utility>
+
+void Fft2D::resize(std::uint32_t size)
+{
+    assert(size > 0 && (size & (size - 1)) == 0);
+
+    if (size == _size)
+        return;
+
+    _size = size;
+
+    std::uint32_t numBits = 0;
+    while ((1u << numBits) < size)
+        numBits++;
+
+    _bitReversed.resize(size);
+    for (std::uint32_t i = 0; i < size; i++)
+    {
+        std::uint32_t reversed = 0;
+        for (std::uint32_t bit = 0; bit < numBits; bit++)
+            reversed |= ((i >> bit) & 1u) << (numBits - 1 - bit);
+
+        _bitReversed[i] = reversed;
+    }
+
+    _twiddles.resize(size / 2);
+    for (std::uint32_t k = 0; k < size / 2; k++)
+        _twiddles[k] = std::polar(1.0, -2.0 * std::numbers::pi * k / size);
+}
+
+void Fft2D::transform(Complex* data, bool inverse) const
+{
+    for (std::uint32_t i = 0; i < _size; i++)
+        if (i < _bitReversed[i])
+            std::swap(data[i], data[_bitReversed[i]]);
+
+    for (std::uint32_t length = 2; length <= _size; length <<= 1)
+    {
+        const std::uint32_t half = length / 2;
+        const std::uint32_t twiddleStride = _size / length;
+
+        for (std::uint32_t start = 0; start < _size; start += length)
+        {
+            for (std::uint32_t k = 0; k < half; k++)
+            {
+                const Complex twiddle = inverse ? std::conj(_twiddles[k * twiddleStride]) : _twiddles[k * twiddleStride];
+                const Complex odd = twiddle * data[start + k + half];
+
+                data[start + k + half] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
+
+void Fft2D::transformRows(Complex* grid, std::uint32_t numRows, bool inverse) const
+{
+#pragma omp parallel for
+    for (std::int64_t row = 0; row < static_cast<std::int64_t>(numRows); row++)
+        transform(grid + row * _size, inverse);
+}
+
+void Fft2D::transformColumns(Complex* grid, bool inverse) const
+{
+    // Columns are gathered in blocks so that every row access touches a full cache line
+    const std::uint32_t blockWidth = std::min<std::uint32_t>(8, _size);
+    const std::int64_t numBlocks = _size / blockWidth;
+
+#pragma omp parallel
+    {
+        std::vector<Complex> columns(static_cast<std::size_t>(blockWidth) * _size);
+
+#pragma omp for
+        for (std::int64_t block = 0; block < numBlocks; block++)
+        {
+            const std::size_t firstColumn = static_cast<std::size_t>(block) * blockWidth;
+
+            for (std::uint32_t row = 0; row < _size; row++)
+                for (std::uint32_t c = 0; c < blockWidth; c++)
+                    columns[static_cast<std::size_t>(c) * _size + row] = grid[static_cast<std::size_t>(row) * _size + firstColumn + c];
+
+            for (std::uint32_t c = 0; c < blockWidth; c++)
+                transform(columns.data() + static_cast<std::size_t>(c) * _size, inverse);
+
+            for (std::uint32_t row = 0; row < _size; row++)
+                for (std::uint32_t c = 0; c < blockWidth; c++)
+                    grid[static_cast<std::size_t>(row) * _size + firstColumn + c] = columns[static_cast<std::size_t>(c) * _size + row];
+        }
+    }
+}
+
+void Fft2D::forward(Complex* grid, std::uint32_t numNonZeroRows) const
+{
+    transformRows(grid, std::min(numNonZeroRows, _size), false);
+    transformColumns(grid, false);
+}
+
+void Fft2D::inverse(Complex* grid, std::uint32_t numRequiredRows) const
+{
+    transformColumns(grid, true);
+    transformRows(grid, std::min(numRequiredRows, _size), true);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Fft2D
+ *
+ * In-place radix-2 fast Fourier transform of square, row-major complex grids.
+ * Rows and columns are transformed in parallel. Since the interpolation grids of the
+ * FFT gradient descent are zero padded, the row passes can be restricted to the rows
+ * that are non-zero (forward) or actually needed (inverse).
+ */
+class Fft2D
+{
+public:
+    using Complex = std::complex<double>;
+
+public:
+    Fft2D() = default;
+
+    /** Prepare twiddle factors and the bit reversal permutation, size must be a power of two */
+    void resize(std::uint32_t size);
+
+    /** Forward transform, rows from numNonZeroRows on are assumed to be zero */
+    void forward(Complex* grid, std::uint32_t numNonZeroRows) const;
+
+    /** Unnormalized inverse transform, only the first numRequiredRows rows are valid afterwards */
+    void inverse(Complex* grid, std::uint32_t numRequiredRows) const;
+
+    std::uint32_t getSize() const { return _size; }
+
+private:
+    /** 1D transform of contiguous data of length _size */
+    void transform(Complex* data, bool inverse) const;
+
+    void transformRows(Complex* grid, std::uint32_t numRows, bool inverse) const;
+    void transformColumns(Complex* grid, bool inverse) const;
+
+private:
+    std::uint32_t               _size = 0;          /** Side length of the grid */
+    std::vector<std::uint32_t>  _bitReversed;       /** Bit reversal permutation */
+    std::vector<Complex>        _twiddles;          /** exp(-2 pi i k / _size) for k < _size / 2 */
+};
@@ -0,0 +1,363 @@
+#include "FftGradientDescent.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include <QDebug>
+
+namespace
+{
+    constexpr std::uint32_t kNumNodes       = 3;        // Interpolation nodes per box and dimension
+    constexpr std::uint32_t kMinBoxesPerDim = 50;       // Lower bound on the boxes per dimension
+    constexpr float         kBoxesPerUnit   = 1.f;      // Minimum number of boxes per embedding unit
+    constexpr float         kGridHeadroom   = 1.2f;     // Grid width relative to the embedding when the grid is (re)computed
+    constexpr std::uint32_t kMaxFftSize     = 4096;     // Upper bound on the side length of the padded node grid, 640 MB of grids and kernel
+    constexpr float         kFallbackTheta  = 0.5f;     // Barnes-Hut accuracy for embeddings that are too wide for the grid
+
+    using Weights = std::array<float, kNumNodes>;
+
+    /** Lagrange basis polynomials for equispaced nodes (k + 0.5) / kNumNodes evaluated at u in [0, 1] */
+    inline Weights lagrangeWeights(float u)
+    {
+        Weights weights;
+
+        for (std::uint32_t k = 0; k < kNumNodes; k++)
+        {
+            const float nodeK = (k + 0.5f) / kNumNodes;
+            float weight = 1.f;
+
+            for (std::uint32_t m = 0; m < kNumNodes; m++)
+            {
+                if (m == k)
+                    continue;
+
+                const float nodeM = (m + 0.5f) / kNumNodes;
+                weight *= (u - nodeM) / (nodeK - nodeM);
+            }
+
+            weights[k] = weight;
+        }
+
+        return weights;
+    }
+
+    std::uint32_t nextPowerOfTwo(std::uint32_t value)
+    {
+        std::uint32_t power = 1;
+        while (power < value)
+            power <<= 1;
+        return power;
+    }
+}
+
+bool FftGradientDescent::updateGrid(float range)
+{
+    const float gridWidth = _numBoxesPerDim * _boxWidth;
+
+    // Keep the grid, and the kernel transform, while the embedding fits and uses at least half of it
+    if (_numBoxesPerDim > 0 && range <= gridWidth && 2.f * kGridHeadroom * range >= gridWidth)
+        return true;
+
+    // At least kBoxesPerUnit boxes per unit, the padded grid must hold twice the nodes for a linear (non-circular) convolution
+    // All boxes that fit into the power of two grid are used
+    const auto requiredBoxes = std::max(kMinBoxesPerDim, static_cast<std::uint32_t>(std::ceil(kGridHeadroom * range * kBoxesPerUnit)));
+    const auto fftSize = nextPowerOfTwo(2 * kNumNodes * requiredBoxes);
+
+    if (fftSize > kMaxFftSize)
+    {
+        _numBoxesPerDim = 0;
+        return false;
+    }
+
+    _fft.resize(fftSize);
+    _numBoxesPerDim = fftSize / (2 * kNumNodes);
+    _boxWidth = kGridHeadroom * range / _numBoxesPerDim;
+
+    computeKernelTransform(_boxWidth / kNumNodes);
+
+    return true;
+}
+
+void FftGradientDescent::computeKernelTransform(double nodeSpacing)
+{
+    const std::uint32_t fftSize = _fft.getSize();
+    const std::int64_t numNodes = static_cast<std::int64_t>(_numBoxesPerDim) * kNumNodes;
+    const std::size_t gridSize = static_cast<std::size_t>(fftSize) * fftSize;
+
+    // The kernel is transformed in the (not yet filled) charge grid, only its real part is kept
+    auto& kernel = _chargesLow;
+    kernel.assign(gridSize, Fft2D::Complex(0., 0.));
+
+    // Circulant embedding: offsets 0 .. numNodes - 1 at the start, negative offsets wrap around to the end
+    const auto nodeOffset = [fftSize, numNodes](std::int64_t index, std::int64_t& offset) -> bool {
+        if (index < numNodes)
+            offset = index;
+        else if (index > static_cast<std::int64_t>(fftSize) - numNodes)
+            offset = index - fftSize;
+        else
+            return false;
+
+        return true;
+    };
+
+#pragma omp parallel for
+    for (std::int64_t row = 0; row < static_cast<std::int64_t>(fftSize); row++)
+    {
+        std::int64_t dy = 0;
+        if (!nodeOffset(row, dy))
+            continue;
+
+        for (std::int64_t col = 0; col < static_cast<std::int64_t>(fftSize); col++)
+        {
+            std::int64_t dx = 0;
+            if (!nodeOffset(col, dx))
+                continue;
+
+            const double d2 = static_cast<double>(dx * dx + dy * dy) * nodeSpacing * nodeSpacing;
+            const double q = 1. / (1. + d2);
+
+            kernel[row * fftSize + col] = Fft2D::Complex(q * q, 0.);
+        }
+    }
+
+    // Real and even, so its transform is real as well
+    _fft.forward(kernel.data(), fftSize);
+
+    _kernel.resize(gridSize);
+
+#pragma omp parallel for
+    for (std::int64_t k = 0; k < static_cast<std::int64_t>(gridSize); k++)
+        _kernel[k] = kernel[k].real();
+}
+
+double FftGradientDescent::computeRepulsiveForces(const float* positions, float* forces)
+{
+    const std::int64_t numPoints = getNumPoints();
+
+    // Bounding box, per block since OpenMP 2.0 has no min/max reductions
+    const std::int64_t numBlocks = std::max<std::int64_t>(1, std::min<std::int64_t>(numParallelThreads(), numPoints / 4096));
+    const std::int64_t blockSize = (numPoints + numBlocks - 1) / numBlocks;
+
+    std::vector<std::array<float, 4>> blockBounds(numBlocks, { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() });
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        auto& bounds = blockBounds[block];
+
+        for (std::int64_t i = block * blockSize; i < std::min(numPoints, (block + 1) * blockSize); i++)
+        {
+            bounds[0] = std::min(bounds[0], positions[2 * i]);
+            bounds[1] = std::min(bounds[1], positions[2 * i + 1]);
+            bounds[2] = std::max(bounds[2], positions[2 * i]);
+            bounds[3] = std::max(bounds[3], positions[2 * i + 1]);
+        }
+    }
+
+    std::array<float, 4> bounds = blockBounds[0];
+    for (const auto& block : blockBounds)
+    {
+        bounds[0] = std::min(bounds[0], block[0]);
+        bounds[1] = std::min(bounds[1], block[1]);
+        bounds[2] = std::max(bounds[2], block[2]);
+        bounds[3] = std::max(bounds[3], block[3]);
+    }
+
+    // Square grid centered on the embedding, slightly enlarged so that all points fall strictly inside
+    const float range   = std::max({ bounds[2] - bounds[0], bounds[3] - bounds[1], 1e-3f }) * 1.001f;
+    const float centerX = 0.5f * (bounds[0] + bounds[2]);
+    const float centerY = 0.5f * (bounds[1] + bounds[3]);
+
+    if (!updateGrid(range))
+    {
+        if (!_useBarnesHut)
+            qWarning() << "t-SNE (CPU, FFT): The embedding is" << range << "units wide, more than the largest interpolation grid covers at one box per unit, using Barnes-Hut until it shrinks";
+
+        _useBarnesHut = true;
+
+        return _tree.computeRepulsiveForces(positions, static_cast<std::uint32_t>(numPoints), kFallbackTheta, forces);
+    }
+
+    _useBarnesHut = false;
+
+    const std::uint32_t fftSize         = _fft.getSize();
+    const std::uint32_t numBoxesPerDim  = _numBoxesPerDim;
+    const std::uint32_t numBoxes        = numBoxesPerDim * numBoxesPerDim;
+    const std::uint32_t numNodes        = numBoxesPerDim * kNumNodes;
+    const float boxWidth                = _boxWidth;
+    const float originX                 = centerX - 0.5f * numBoxesPerDim * boxWidth;
+    const float originY                 = centerY - 0.5f * numBoxesPerDim * boxWidth;
+
+    // Sort the points by box so that every box can spread its charges without synchronization
+    _boxOfPoint.resize(numPoints);
+
+    const auto boxCoordinates = [originX, originY, boxWidth, numBoxesPerDim](float x, float y, std::uint32_t& boxX, std::uint32_t& boxY, float& u, float& v) -> void {
+        const float gridX = (x - originX) / boxWidth;
+        const float gridY = (y - originY) / boxWidth;
+
+        boxX = std::min(numBoxesPerDim - 1, static_cast<std::uint32_t>(std::max(0.f, gridX)));
+        boxY = std::min(numBoxesPerDim - 1, static_cast<std::uint32_t>(std::max(0.f, gridY)));
+        u = gridX - boxX;
+        v = gridY - boxY;
+    };
+
+    std::vector<std::uint64_t> histograms(static_cast<std::size_t>(numBlocks) * numBoxes, 0);
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        std::uint64_t* histogram = histograms.data() + block * numBoxes;
+
+        for (std::int64_t i = block * blockSize; i < std::min(numPoints, (block + 1) * blockSize); i++)
+        {
+            std::uint32_t boxX, boxY;
+            float u, v;
+            boxCoordinates(positions[2 * i], positions[2 * i + 1], boxX, boxY, u, v);
+
+            _boxOfPoint[i] = boxY * numBoxesPerDim + boxX;
+            histogram[_boxOfPoint[i]]++;
+        }
+    }
+
+    _boxOffsets.assign(numBoxes + 1, 0);
+
+    std::uint64_t running = 0;
+    for (std::uint32_t box = 0; box < numBoxes; box++)
+    {
+        _boxOffsets[box] = running;
+
+        for (std::int64_t block = 0; block < numBlocks; block++)
+        {
+            const auto count = histograms[block * numBoxes + box];
+            histograms[block * numBoxes + box] = running;
+            running += count;
+        }
+    }
+    _boxOffsets[numBoxes] = running;
+
+    _pointsByBox.resize(numPoints);
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        std::uint64_t* histogram = histograms.data() + block * numBoxes;
+
+        for (std::int64_t i = block * blockSize; i < std::min(numPoints, (block + 1) * blockSize); i++)
+            _pointsByBox[histogram[_boxOfPoint[i]]++] = static_cast<std::uint32_t>(i);
+    }
+
+    // Spread the charges 1, x, y and x^2 + y^2 (relative to the grid center) to the interpolation nodes
+    // Two real charges are packed into one complex grid, the kernel is real and even so they do not mix
+    const std::size_t gridSize = static_cast<std::size_t>(fftSize) * fftSize;
+
+    _chargesLow.resize(gridSize);
+    _chargesHigh.resize(gridSize);
+
+#pragma omp parallel for
+    for (std::int64_t row = 0; row < static_cast<std::int64_t>(fftSize); row++)
+    {
+        std::fill_n(_chargesLow.begin() + row * fftSize, fftSize, Fft2D::Complex(0., 0.));
+        std::fill_n(_chargesHigh.begin() + row * fftSize, fftSize, Fft2D::Complex(0., 0.));
+    }
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (std::int64_t box = 0; box < static_cast<std::int64_t>(numBoxes); box++)
+    {
+        for (std::uint64_t k = _boxOffsets[box]; k < _boxOffsets[box + 1]; k++)
+        {
+            const std::uint32_t i = _pointsByBox[k];
+
+            std::uint32_t boxX, boxY;
+            float u, v;
+            boxCoordinates(positions[2ull * i], positions[2ull * i + 1], boxX, boxY, u, v);
+
+            const Weights weightsX = lagrangeWeights(u);
+            const Weights weightsY = lagrangeWeights(v);
+
+            const double x = positions[2ull * i] - centerX;
+            const double y = positions[2ull * i + 1] - centerY;
+            const Fft2D::Complex low(1., x);
+            const Fft2D::Complex high(y, x * x + y * y);
+
+            for (std::uint32_t nodeY = 0; nodeY < kNumNodes; nodeY++)
+            {
+                const std::size_t rowOffset = static_cast<std::size_t>(boxY * kNumNodes + nodeY) * fftSize + boxX * kNumNodes;
+
+                for (std::uint32_t nodeX = 0; nodeX < kNumNodes; nodeX++)
+                {
+                    const double weight = weightsX[nodeX] * weightsY[nodeY];
+
+                    _chargesLow[rowOffset + nodeX] += weight * low;
+                    _chargesHigh[rowOffset + nodeX] += weight * high;
+                }
+            }
+        }
+    }
+
+    // Convolve with the kernel in the frequency domain
+    _fft.forward(_chargesLow.data(), numNodes);
+    _fft.forward(_chargesHigh.data(), numNodes);
+
+#pragma omp parallel for
+    for (std::int64_t k = 0; k < static_cast<std::int64_t>(gridSize); k++)
+    {
+        _chargesLow[k] *= _kernel[k];
+        _chargesHigh[k] *= _kernel[k];
+    }
+
+    _fft.inverse(_chargesLow.data(), numNodes);
+    _fft.inverse(_chargesHigh.data(), numNodes);
+
+    // Interpolate the potentials back to the points
+    const double scale = 1. / static_cast<double>(gridSize);
+
+    double sumQ = 0.;
+
+#pragma omp parallel for reduction(+:sumQ)
+    for (std::int64_t i = 0; i < numPoints; i++)
+    {
+        std::uint32_t boxX, boxY;
+        float u, v;
+        boxCoordinates(positions[2 * i], positions[2 * i + 1], boxX, boxY, u, v);
+
+        const Weights weightsX = lagrangeWeights(u);
+        const Weights weightsY = lagrangeWeights(v);
+
+        Fft2D::Complex low(0., 0.), high(0., 0.);
+
+        for (std::uint32_t nodeY = 0; nodeY < kNumNodes; nodeY++)
+        {
+            const std::size_t rowOffset = static_cast<std::size_t>(boxY * kNumNodes + nodeY) * fftSize + boxX * kNumNodes;
+
+            for (std::uint32_t nodeX = 0; nodeX < kNumNodes; nodeX++)
+            {
+                const double weight = weightsX[nodeX] * weightsY[nodeY];
+
+                low += weight * _chargesLow[rowOffset + nodeX];
+                high += weight * _chargesHigh[rowOffset + nodeX];
+            }
+        }
+
+        // phi0 = sum_j q_ij^2, phi1 = sum_j q_ij^2 x_j, phi2 = sum_j q_ij^2 y_j, phi3 = sum_j q_ij^2 |y_j|^2
+        const double phi0 = low.real() * scale;
+        const double phi1 = low.imag() * scale;
+        const double phi2 = high.real() * scale;
+        const double phi3 = high.imag() * scale;
+
+        const double x = positions[2 * i] - centerX;
+        const double y = positions[2 * i + 1] - centerY;
+
+        forces[2 * i]     = static_cast<float>(x * phi0 - phi1);
+        forces[2 * i + 1] = static_cast<float>(y * phi0 - phi2);
+
+        // sum_j q_ij = sum_j (1 + |y_i - y_j|^2) q_ij^2
+        sumQ += (1. + x * x + y * y) * phi0 - 2. * (x * phi1 + y * phi2) + phi3;
+    }
+
+    // Every point interacts with itself with q = 1
+    return sumQ - static_cast<double>(numPoints);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CpuGradientDescent.h"
+#include "Fft2D.h"
+#include "QuadTree.h"
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ * FftGradientDescent
+ *
+ * CPU gradient descent with repulsive forces computed by FFT-accelerated interpolation
+ * (Linderman et al., FIt-SNE). The embedding is divided into square boxes with a few
+ * interpolation nodes each, the point charges are spread to the nodes with Lagrange
+ * polynomials, convolved with the t-SNE kernel on the node grid by FFT and interpolated
+ * back to the points. Cost per iteration is linear in the number of points.
+ *
+ * Boxes are at most one embedding unit wide. The grid geometry, and with it the transformed
+ * kernel, is kept while the embedding fits and is only recomputed when it outgrows the grid
+ * or the grid is much wider than needed. Embeddings too wide for the largest grid fall back
+ * to Barnes-Hut until they shrink.
+ */
+class FftGradientDescent : public CpuGradientDescent
+{
+public:
+    FftGradientDescent() = default;
+
+protected:
+    double computeRepulsiveForces(const float* positions, float* forces) override;
+
+private:
+    /**
+     * Choose the grid for an embedding of the given width and transform the kernel for it
+     * @return False if the embedding needs a larger grid than the maximum
+     */
+    bool updateGrid(float range);
+
+    /** Fourier transform of the kernel 1 / (1 + d^2)^2 sampled on the (circulant) node grid, uses _chargesLow as scratch */
+    void computeKernelTransform(double nodeSpacing);
+
+private:
+    Fft2D                       _fft;                   /** Transform of the zero-padded node grid */
+    std::uint32_t               _numBoxesPerDim = 0;    /** Boxes per dimension of the current grid */
+    float                       _boxWidth = 0.f;        /** Box width of the current grid, in embedding units */
+    bool                        _useBarnesHut = false;  /** Whether the embedding is too wide for the largest grid */
+    QuadTree                    _tree;                  /** Barnes-Hut fallback for too wide embeddings */
+    std::vector<double>         _kernel;                /** Transformed kernel of the current grid */
+    std::vector<Fft2D::Complex> _chargesLow;            /** Node grid with charges 1 (real) and x (imaginary) */
+    std::vector<Fft2D::Complex> _chargesHigh;           /** Node grid with charges y (real) and x^2 + y^2 (imaginary) */
+    std::vector<std::uint32_t>  _boxOfPoint;            /** Box index of every point */
+    std::vector<std::uint64_t>  _boxOffsets;            /** Start of every box in _pointsByBox */
+    std::vector<std::uint32_t>  _pointsByBox;           /** Point indices sorted by box */
+};
@@ -25,11 +25,11 @@ GradientDescentSettingsAction::GradientDescentSettingsAction(QObject* parent, Ts
     _exaggerationIterAction.initialize(0, 10000, 250);
     _exponentialDecayAction.initialize(0, 10000, 70);
 
-    _gradientDescentTypeAction.initialize({ "GPU", "CPU" });
+    _gradientDescentTypeAction.initialize({ "GPU", "CPU", "CPU (multi-threaded)", "CPU (FFT)" });
 
     _exaggerationFactorAction.setToolTip("Defaults to 4 + number of points / 60'000");
     _exponentialDecayAction.setToolTip("Iterations after 'Exaggeration iterations' during \nwhich the exaggeration factor exponentionally decays towards 1");
-    _gradientDescentTypeAction.setToolTip("Gradient Descent Implementation: GPU (A-tSNE), CPU (Barnes-Hut)");
+    _gradientDescentTypeAction.setToolTip("Gradient Descent Implementation: GPU (A-tSNE), CPU (Barnes-Hut), CPU (multi-threaded Barnes-Hut), CPU (FFT-accelerated interpolation, for large data)");
 
     const auto updateExaggerationFactor = [this]() -> void {
         _tsneParameters.setExaggerationFactor(_exaggerationFactorAction.getValue());
@@ -48,6 +48,8 @@ GradientDescentSettingsAction::GradientDescentSettingsAction(QObject* parent, Ts
         {
         case 0: _tsneParameters.setGradientDescentType(GradientDescentType::GPU); break;
         case 1: _tsneParameters.setGradientDescentType(GradientDescentType::CPU); break;
+        case 2: _tsneParameters.setGradientDescentType(GradientDescentType::CPU_PARALLEL); break;
+        case 3: _tsneParameters.setGradientDescentType(GradientDescentType::CPU_FFT); break;
         }
         
     };
@@ -0,0 +1,218 @@
+#include "KnnAutoSelection.h"
+
+#include "BruteForceKnn.h"
+#include "DistanceKernels.h"
+#include "KnnIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    constexpr std::uint32_t maxSampleSize = 4096;       /** Points in the sample the backends are measured on */
+    constexpr std::uint32_t sampleSeed = 0;             /** Fixed, so the same data always yields the same sample */
+    constexpr std::uint32_t numRecallSamples = 200;     /** Points whose neighbors among all points the recall of a configuration is measured on */
+    constexpr double targetRecall = 0.95;               /** Minimum recall of an approximate configuration */
+    constexpr double maxExactSeconds = 600;             /** Longest estimated exact search that is preferred over an index below the target recall */
+
+    /** HDILib configurations that are tried, parameters as in KnnParameters */
+    struct Candidate
+    {
+        hdi::dr::knn_library    library;
+        int                     parameter1;     /** HNSW: M, Annoy: number of trees */
+        int                     parameter2;     /** HNSW: ef construction, Annoy: number of checks */
+    };
+
+    constexpr Candidate candidates[] = {
+        { hdi::dr::knn_library::KNN_HNSW, 8, 100 },
+        { hdi::dr::knn_library::KNN_HNSW, 16, 200 },
+        { hdi::dr::knn_library::KNN_HNSW, 32, 400 },
+        { hdi::dr::knn_library::KNN_ANNOY, 4, 512 },
+        { hdi::dr::knn_library::KNN_ANNOY, 16, 2048 },
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string describe(const KnnParameters& knnParameters)
+    {
+        std::ostringstream description;
+
+        if (knnParameters.getKnnBackend() == KnnBackend::BruteForce)
+            description << "exact brute force (" << distance::simdLevelName(distance::detectSimdLevel()) << ")";
+        else if (knnParameters.getKnnAlgorithm() == hdi::dr::knn_library::KNN_HNSW)
+            description << "HNSW (M " << knnParameters.getHNSWm() << ", ef " << knnParameters.getHNSWef() << ")";
+        else if (knnParameters.getKnnAlgorithm() == hdi::dr::knn_library::KNN_ANNOY)
+            description << "Annoy (" << knnParameters.getAnnoyNumTrees() << " trees, " << knnParameters.getAnnoyNumChecks() << " checks)";
+        else
+            description << "FLANN";
+
+        return description.str();
+    }
+
+    KnnParameters withCandidate(KnnParameters knnParameters, const Candidate& candidate)
+    {
+        knnParameters.setKnnBackend(KnnBackend::Library);
+        knnParameters.setKnnAlgorithm(candidate.library);
+
+        if (candidate.library == hdi::dr::knn_library::KNN_HNSW)
+        {
+            knnParameters.setHNSWm(candidate.parameter1);
+            knnParameters.setHNSWef(candidate.parameter2);
+        }
+        else
+        {
+            knnParameters.setAnnoyNumTrees(candidate.parameter1);
+            knnParameters.setAnnoyNumChecks(candidate.parameter2);
+        }
+
+        return knnParameters;
+    }
+
+    /** Stratified sample: one random point out of every stretch of numPoints / sampleSize points */
+    std::vector<float> drawSample(const DataProvider& data, std::uint32_t sampleSize)
+    {
+        const std::uint32_t numDimensions = data.getNumDimensions();
+        const double stride = static_cast<double>(data.getNumPoints()) / sampleSize;
+
+        std::mt19937 generator(sampleSeed);
+        std::uniform_real_distribution<double> jitter(0.0, 1.0);
+
+        std::vector<float> sample(static_cast<std::size_t>(sampleSize) * numDimensions);
+
+        for (std::uint32_t i = 0; i < sampleSize; i++)
+        {
+            const auto index = std::min(static_cast<std::uint32_t>((i + jitter(generator)) * stride), data.getNumPoints() - 1);
+            data.readBlock(index, 1, sample.data() + static_cast<std::size_t>(i) * numDimensions);
+        }
+
+        return sample;
+    }
+}
+
+KnnSelection selectKnnParameters(const DataProvider& data, const KnnParameters& knnParameters, std::uint32_t numNeighbors)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::uint32_t numDimensions = data.getNumDimensions();
+    const std::uint32_t sampleSize = std::min(numPoints, maxSampleSize);
+    const std::uint32_t sampleNeighbors = std::min(numNeighbors, sampleSize > 0 ? sampleSize - 1 : 0u);
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3);
+    summary << "kNN auto selection for " << numPoints << " points, " << numDimensions << " dimensions, " << numNeighbors << " neighbors, sample of " << sampleSize << " points (seed " << sampleSeed << "): ";
+
+    KnnSelection selection;
+    selection.knnParameters = knnParameters;
+    selection.knnParameters.setKnnBackend(KnnBackend::BruteForce);
+
+    if (sampleNeighbors == 0)
+    {
+        selection.summary = summary.str() + "too few points, using " + describe(selection.knnParameters);
+        return selection;
+    }
+
+    const VectorDataProvider sample(drawSample(data, sampleSize), numDimensions);
+
+    // Exact reference, its time is quadratic in the number of points
+    const auto bruteForceStart = std::chrono::steady_clock::now();
+    computeBruteForceKnn(sample, sampleNeighbors, knnParameters.getKnnDistanceMetric());
+    const double bruteForceSeconds = secondsSince(bruteForceStart);
+
+    const double scale = static_cast<double>(numPoints) / sampleSize;
+
+    selection.estimatedSeconds = bruteForceSeconds * scale * scale;
+    summary << describe(selection.knnParameters) << " " << selection.estimatedSeconds << " s";
+
+    // The sample is the whole dataset, the exact search is done
+    if (sampleSize == numPoints)
+    {
+        selection.summary = summary.str() + " -> selected " + describe(selection.knnParameters);
+        return selection;
+    }
+
+    // The candidates index all points, the query time is extrapolated from the sample and the recall is the one of sampled queries among all points
+    const auto denseData = data.getDenseData();
+    const double queryScale = static_cast<double>(numPoints) / sampleSize;
+
+    KnnSelection bestApproximate;
+    bestApproximate.recall = -1;
+
+    std::vector<hdi::dr::knn_library> librariesReachingTarget;
+
+    for (const auto& candidate : candidates)
+    {
+        const auto candidateParameters = withCandidate(knnParameters, candidate);
+
+        if (!KnnIndex::supports(candidateParameters))
+            continue;
+
+        // More accurate configurations of a library that already reaches the target recall are slower
+        if (std::find(librariesReachingTarget.begin(), librariesReachingTarget.end(), candidate.library) != librariesReachingTarget.end())
+            continue;
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        std::shared_ptr<const KnnIndex> index = KnnIndex::build(denseData.data(), numPoints, numDimensions, candidateParameters);
+        const double buildSeconds = secondsSince(buildStart);
+
+        // Same search as computeLibraryKnn with an index: one more result than neighbors, in case the point itself is found
+        const auto queryStart = std::chrono::steady_clock::now();
+
+#pragma omp parallel
+        {
+            std::vector<KnnIndex::Neighbor> result;
+
+#pragma omp for schedule(dynamic, 64)
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(sampleSize); i++)
+                index->search(sample.getContiguousData() + i * numDimensions, sampleNeighbors + 1, result);
+        }
+
+        const double querySeconds = secondsSince(queryStart);
+
+        const double recall = estimateKnnRecall(data, sampleNeighbors, [&index, sampleNeighbors](std::uint32_t point, const float* query, std::vector<std::uint32_t>& neighbors) {
+            std::vector<KnnIndex::Neighbor> result;
+            index->search(query, sampleNeighbors + 1, result);
+
+            for (const auto& neighbor : result)
+                if (neighbor.second != point && neighbors.size() < sampleNeighbors)
+                    neighbors.push_back(neighbor.second);
+            }, knnParameters.getKnnDistanceMetric(), numRecallSamples);
+
+        const double estimatedSeconds = buildSeconds + querySeconds * queryScale;
+
+        summary << ", " << describe(candidateParameters) << " " << estimatedSeconds << " s recall " << recall;
+
+        // Fastest configuration above the target recall, otherwise the most accurate one
+        const bool reachesTarget = recall >= targetRecall;
+        const bool bestReachesTarget = bestApproximate.recall >= targetRecall;
+
+        if ((reachesTarget && (!bestReachesTarget || estimatedSeconds < bestApproximate.estimatedSeconds)) || (!reachesTarget && !bestReachesTarget && recall > bestApproximate.recall))
+        {
+            bestApproximate.knnParameters = candidateParameters;
+            bestApproximate.knnIndex = std::move(index);
+            bestApproximate.recall = recall;
+            bestApproximate.estimatedSeconds = estimatedSeconds;
+        }
+
+        if (reachesTarget)
+            librariesReachingTarget.push_back(candidate.library);
+    }
+
+    // Exact results are preferred unless an index that is accurate enough is faster, or the exact search would take too long
+    const bool approximateIsFaster = bestApproximate.recall >= targetRecall && bestApproximate.estimatedSeconds < selection.estimatedSeconds;
+    const bool exactIsTooSlow = bestApproximate.recall >= 0 && selection.estimatedSeconds > maxExactSeconds;
+
+    if (approximateIsFaster || exactIsTooSlow)
+        selection = bestApproximate;
+
+    selection.summary = summary.str() + " -> selected " + describe(selection.knnParameters);
+
+    return selection;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "KnnIndex.h"
+#include "KnnParameters.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/** Outcome of selectKnnParameters */
+struct KnnSelection
+{
+    KnnParameters                       knnParameters;          /** Selected backend and library parameters, never KnnBackend::Auto */
+    std::shared_ptr<const KnnIndex>     knnIndex;               /** Index of all points that was measured for the selected library, nullptr for the exact search */
+    double                              recall = 1.0;           /** Estimated recall of the selection, 1 for the exact search */
+    double                              estimatedSeconds = 0;   /** Extrapolated time of the kNN computation on all points */
+    std::string                         summary;                /** Human-readable description of the measurements and the selection, for the log */
+};
+
+/**
+ * Choose the kNN backend and its parameters for a dataset
+ *
+ * Times the exact brute-force search on a fixed random sample of the points and extrapolates it quadratically.
+ * A few HNSW and Annoy configurations are built as KnnIndex of all points, as the computation after the selection
+ * does, their query time is measured on the sample and extrapolated linearly, and their recall is estimated with
+ * sampled queries among all points, see estimateKnnRecall. Configurations of a library that are more accurate than
+ * one that reaches the target recall are not tried. The fastest configuration that reaches the target recall is chosen,
+ * the exact search wins if it is estimated to be as fast, and always for datasets no larger than the sample.
+ * If no configuration reaches the target recall, the exact search is used unless it would take too long.
+ *
+ * @param data Input points
+ * @param knnParameters Requested parameters, only the distance metric is kept
+ * @param numNeighbors Number of neighbors per point the similarity computation needs
+ */
+KnnSelection selectKnnParameters(const DataProvider& data, const KnnParameters& knnParameters, std::uint32_t numNeighbors);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/**
+ * KnnGraph
+ *
+ * The k nearest neighbors of every point, excluding the point itself, sorted by increasing distance.
+ * Indices and distances are stored row-major with getNumNeighbors() entries per point.
+ */
+class KnnGraph
+{
+public:
+    KnnGraph() = default;
+
+    KnnGraph(std::uint32_t numPoints, std::uint32_t numNeighbors) :
+        _numPoints(numPoints),
+        _numNeighbors(numNeighbors),
+        _indices(static_cast<std::size_t>(numPoints) * numNeighbors),
+        _distances(static_cast<std::size_t>(numPoints) * numNeighbors)
+    {
+    }
+
+    std::uint32_t getNumPoints() const { return _numPoints; }
+    std::uint32_t getNumNeighbors() const { return _numNeighbors; }
+
+    const std::uint32_t* neighbors(std::uint32_t point) const { assert(point < _numPoints); return _indices.data() + static_cast<std::size_t>(point) * _numNeighbors; }
+    const float* distances(std::uint32_t point) const { assert(point < _numPoints); return _distances.data() + static_cast<std::size_t>(point) * _numNeighbors; }
+
+    std::uint32_t* neighbors(std::uint32_t point) { assert(point < _numPoints); return _indices.data() + static_cast<std::size_t>(point) * _numNeighbors; }
+    float* distances(std::uint32_t point) { assert(point < _numPoints); return _distances.data() + static_cast<std::size_t>(point) * _numNeighbors; }
+
+    const std::vector<std::uint32_t>& getIndices() const { return _indices; }
+    const std::vector<float>& getDistances() const { return _distances; }
+
+    std::vector<std::uint32_t>& getIndices() { return _indices; }
+    std::vector<float>& getDistances() { return _distances; }
+
+    /** The graph of the nearest numNeighbors neighbors, which has to be at most getNumNeighbors() */
+    KnnGraph truncated(std::uint32_t numNeighbors) const
+    {
+        assert(numNeighbors <= _numNeighbors);
+
+        KnnGraph result(_numPoints, numNeighbors);
+
+        for (std::uint32_t point = 0; point < _numPoints; point++)
+        {
+            std::copy_n(neighbors(point), numNeighbors, result.neighbors(point));
+            std::copy_n(distances(point), numNeighbors, result.distances(point));
+        }
+
+        return result;
+    }
+
+private:
+    std::uint32_t               _numPoints = 0;     /** Number of points */
+    std::uint32_t               _numNeighbors = 0;  /** Number of neighbors per point */
+    std::vector<std::uint32_t>  _indices;           /** Neighbor indices, row-major */
+    std::vector<float>          _distances;         /** Neighbor distances, row-major */
+};
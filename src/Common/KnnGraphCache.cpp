@@ -0,0 +1,294 @@
+#include "KnnGraphCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#include <QDebug>
+#include <QStandardPaths>
+#include <QString>
+
+namespace
+{
+    constexpr std::uint32_t fileMagic = 0x474E4E4B;     /** "KNNG" */
+    constexpr std::uint32_t fileVersion = 1;
+    constexpr auto fileExtension = ".knn";
+
+    /** Finalizer of splitmix64 */
+    std::uint64_t mix(std::uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9ull;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EBull;
+        value ^= value >> 31;
+        return value;
+    }
+
+    void hashCombine(std::uint64_t& seed, std::uint64_t value)
+    {
+        seed = mix(seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2)));
+    }
+
+    std::uint64_t hashPoint(const float* point, std::uint32_t numDimensions)
+    {
+        std::uint64_t hash = numDimensions;
+
+        for (std::uint32_t d = 0; d < numDimensions; d++)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, point + d, sizeof(bits));
+            hash = mix(hash ^ bits) + d;
+        }
+
+        return hash;
+    }
+
+    /** Calls function with the directory entry of each cache file, does not throw */
+    template <typename Function>
+    void forEachCacheFile(const std::filesystem::path& directory, Function function)
+    {
+        std::error_code error;
+
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+            if (it->path().extension() == fileExtension)
+                function(*it);
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::ifstream& file, T& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+}
+
+KnnGraphCache::KnnGraphCache(std::filesystem::path directory, std::uintmax_t maxSize) :
+    _directory(std::move(directory)),
+    _maxSize(maxSize)
+{
+}
+
+std::filesystem::path KnnGraphCache::defaultDirectory()
+{
+    return std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdU16String()) / "knn-cache";
+}
+
+std::uint64_t KnnGraphCache::computeKey(const DataProvider& data, const KnnParameters& knnParameters)
+{
+    const std::uint32_t numDimensions = data.getNumDimensions();
+
+    std::uint64_t key = 0;
+
+    hashCombine(key, data.getNumPoints());
+    hashCombine(key, numDimensions);
+
+    // Points are hashed in parallel, the hashes are combined in order
+    std::vector<std::uint64_t> pointHashes;
+
+    data.forEachBlock(65536, [&key, &pointHashes, numDimensions](std::uint32_t, std::uint32_t count, const float* block) {
+        pointHashes.resize(count);
+
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+            pointHashes[i] = hashPoint(block + i * numDimensions, numDimensions);
+
+        for (const auto pointHash : pointHashes)
+            hashCombine(key, pointHash);
+        });
+
+    // Parameters that change the neighbors, the library parameters only matter for the libraries
+    hashCombine(key, static_cast<std::uint64_t>(knnParameters.getKnnBackend()));
+    hashCombine(key, static_cast<std::uint64_t>(knnParameters.getKnnDistanceMetric()));
+
+    // Keys of graphs of the input itself are unchanged
+    if (knnParameters.getNumPcaComponents() > 0)
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getNumPcaComponents()));
+
+    // Shifted, so that it does not collide with a number of components
+    if (knnParameters.getKnnBackend() != KnnBackend::Library && knnParameters.getKnnPrecision() != KnnPrecision::Float32)
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getKnnPrecision()) << 32);
+
+    if (knnParameters.getKnnBackend() != KnnBackend::BruteForce)
+    {
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getKnnAlgorithm()));
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getAnnoyNumTrees()));
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getAnnoyNumChecks()));
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getHNSWm()));
+        hashCombine(key, static_cast<std::uint64_t>(knnParameters.getHNSWef()));
+    }
+
+    return key;
+}
+
+std::optional<KnnGraph> KnnGraphCache::load(std::uint64_t key, std::uint32_t numPoints, std::uint32_t numNeighbors) const
+{
+    std::ifstream file(filePath(key), std::ios::binary);
+
+    if (!file.is_open())
+        return std::nullopt;
+
+    std::uint32_t magic = 0, version = 0, storedNumPoints = 0, storedNumNeighbors = 0;
+    std::uint64_t storedKey = 0;
+
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, storedKey) || !readValue(file, storedNumPoints) || !readValue(file, storedNumNeighbors))
+        return std::nullopt;
+
+    if (magic != fileMagic || version != fileVersion || storedKey != key || storedNumPoints != numPoints)
+        return std::nullopt;
+
+    if (storedNumNeighbors < numNeighbors)
+    {
+        qDebug() << "kNN graph cache: stored graph has" << storedNumNeighbors << "neighbors," << numNeighbors << "are needed";
+        return std::nullopt;
+    }
+
+    KnnGraph knnGraph(storedNumPoints, storedNumNeighbors);
+
+    file.read(reinterpret_cast<char*>(knnGraph.getIndices().data()), knnGraph.getIndices().size() * sizeof(std::uint32_t));
+    file.read(reinterpret_cast<char*>(knnGraph.getDistances().data()), knnGraph.getDistances().size() * sizeof(float));
+
+    if (!file)
+    {
+        qWarning() << "kNN graph cache: cannot read" << QString::fromStdU16String(filePath(key).u16string());
+        return std::nullopt;
+    }
+
+    file.close();
+
+    // The modification time marks the use, for the eviction of the least recently used graphs
+    std::error_code error;
+    std::filesystem::last_write_time(filePath(key), std::filesystem::file_time_type::clock::now(), error);
+
+    if (storedNumNeighbors == numNeighbors)
+        return knnGraph;
+
+    return knnGraph.truncated(numNeighbors);
+}
+
+bool KnnGraphCache::save(std::uint64_t key, const KnnGraph& knnGraph) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+
+    // Written to a temporary file first, so readers never see a partial graph
+    const auto path = filePath(key);
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            qWarning() << "kNN graph cache: cannot write to" << QString::fromStdU16String(_directory.u16string());
+            return false;
+        }
+
+        writeValue(file, fileMagic);
+        writeValue(file, fileVersion);
+        writeValue(file, key);
+        writeValue(file, knnGraph.getNumPoints());
+        writeValue(file, knnGraph.getNumNeighbors());
+
+        file.write(reinterpret_cast<const char*>(knnGraph.getIndices().data()), knnGraph.getIndices().size() * sizeof(std::uint32_t));
+        file.write(reinterpret_cast<const char*>(knnGraph.getDistances().data()), knnGraph.getDistances().size() * sizeof(float));
+
+        if (!file)
+        {
+            qWarning() << "kNN graph cache: writing" << QString::fromStdU16String(temporaryPath.u16string()) << "failed";
+            file.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    evict(path);
+
+    return true;
+}
+
+void KnnGraphCache::clear() const
+{
+    std::uintmax_t numRemoved = 0;
+
+    forEachCacheFile(_directory, [&numRemoved](const std::filesystem::directory_entry& entry) {
+        std::error_code error;
+
+        if (std::filesystem::remove(entry.path(), error))
+            numRemoved++;
+        });
+
+    qDebug() << "kNN graph cache: removed" << numRemoved << "graphs";
+}
+
+void KnnGraphCache::evict(const std::filesystem::path& keptPath) const
+{
+    struct CacheFile
+    {
+        std::filesystem::path               path;
+        std::uintmax_t                      size;
+        std::filesystem::file_time_type     lastUsed;
+    };
+
+    std::vector<CacheFile> cacheFiles;
+    std::uintmax_t totalSize = 0;
+
+    forEachCacheFile(_directory, [&cacheFiles, &totalSize, &keptPath](const std::filesystem::directory_entry& entry) {
+        std::error_code sizeError, timeError;
+
+        const auto size = entry.file_size(sizeError);
+        const auto lastUsed = entry.last_write_time(timeError);
+
+        if (sizeError || timeError)
+            return;
+
+        totalSize += size;
+
+        if (entry.path() != keptPath)
+            cacheFiles.push_back({ entry.path(), size, lastUsed });
+        });
+
+    std::sort(cacheFiles.begin(), cacheFiles.end(), [](const CacheFile& lhs, const CacheFile& rhs) {
+        return lhs.lastUsed < rhs.lastUsed;
+        });
+
+    std::error_code error;
+
+    for (const auto& cacheFile : cacheFiles)
+    {
+        if (totalSize <= _maxSize)
+            break;
+
+        if (std::filesystem::remove(cacheFile.path, error))
+        {
+            totalSize -= cacheFile.size;
+            qDebug() << "kNN graph cache: evicted" << QString::fromStdU16String(cacheFile.path.filename().u16string());
+        }
+    }
+}
+
+std::filesystem::path KnnGraphCache::filePath(std::uint64_t key) const
+{
+    std::ostringstream fileName;
+    fileName << std::hex << std::setw(16) << std::setfill('0') << key << fileExtension;
+
+    return _directory / fileName.str();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "KnnGraph.h"
+#include "KnnParameters.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+/**
+ * KnnGraphCache
+ *
+ * Stores kNN graphs (before the perplexity calibration) in a directory on disk, one file per key.
+ * The key is a hash of the data contents (of the enabled dimensions, as the data provider reads them)
+ * and of the kNN parameters that determine the neighbors, but not of the number of neighbors:
+ * a stored graph serves every request for at most as many neighbors.
+ * The directory is kept below a maximum size: after a graph is stored, the least recently used graphs are removed.
+ */
+class KnnGraphCache
+{
+public:
+    /** Default maximum size of the cache directory: 4 GB */
+    static constexpr std::uintmax_t defaultMaxSize = std::uintmax_t(4) << 30;
+
+    explicit KnnGraphCache(std::filesystem::path directory, std::uintmax_t maxSize = defaultMaxSize);
+
+    /** knn-cache in the application's cache location */
+    static std::filesystem::path defaultDirectory();
+
+    /** Key of the graph of the data for the kNN parameters */
+    static std::uint64_t computeKey(const DataProvider& data, const KnnParameters& knnParameters);
+
+    /** Stored graph for the key, truncated to numNeighbors neighbors, if it has at least that many */
+    std::optional<KnnGraph> load(std::uint64_t key, std::uint32_t numPoints, std::uint32_t numNeighbors) const;
+
+    /** Store the graph for the key, replacing a stored one, and evict the least recently used graphs. Returns false if it could not be written */
+    bool save(std::uint64_t key, const KnnGraph& knnGraph) const;
+
+    /** Remove all stored graphs */
+    void clear() const;
+
+private:
+    std::filesystem::path filePath(std::uint64_t key) const;
+
+    /** Remove the least recently used graphs, except the one at keptPath, until the directory is at most _maxSize */
+    void evict(const std::filesystem::path& keptPath) const;
+
+private:
+    std::filesystem::path   _directory;     /** Directory of the cache files */
+    std::uintmax_t          _maxSize;       /** Maximum size of the cache files in bytes */
+};
@@ -0,0 +1,296 @@
+#include "KnnIndex.h"
+
+#include "hnswlib/hnswlib.h"
+
+#include "annoylib.h"
+#include "kissrandom.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <QDebug>
+#include <QString>
+
+namespace
+{
+    /** New file in the temporary directory that backs a memory-mapped index */
+    std::filesystem::path createBackingFilePath()
+    {
+        static std::atomic<std::uint64_t> counter = 0;
+
+        std::error_code error;
+        const auto directory = std::filesystem::temp_directory_path(error) / "knn-index";
+        std::filesystem::create_directories(directory, error);
+
+        const auto name = std::to_string(std::random_device()()) + "-" + std::to_string(counter++) + ".annoy";
+
+        return directory / name;
+    }
+
+    QString toQString(const std::filesystem::path& path)
+    {
+        return QString::fromStdU16String(path.u16string());
+    }
+
+    /** HNSW index, held in memory */
+    class HnswKnnIndex : public KnnIndex
+    {
+    public:
+        HnswKnnIndex(std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters) :
+            KnnIndex(numPoints, numDimensions, knnParameters)
+        {
+            if (knnParameters.getKnnDistanceMetric() == hdi::dr::knn_distance_metric::KNN_METRIC_INNER_PRODUCT)
+                _space = std::make_unique<hnswlib::InnerProductSpace>(numDimensions);
+            else
+                _space = std::make_unique<hnswlib::L2Space>(numDimensions);
+        }
+
+        void build(const float* data)
+        {
+            const std::uint32_t numPoints = getNumPoints();
+            const std::size_t numDimensions = getNumDimensions();
+
+            _index = std::make_unique<hnswlib::HierarchicalNSW<float>>(_space.get(), numPoints, getKnnParameters().getHNSWm(), getKnnParameters().getHNSWef());
+
+            // Insertion is thread-safe once the entry point exists
+            if (numPoints > 0)
+                _index->addPoint(data, 0);
+
+#pragma omp parallel for schedule(dynamic, 256)
+            for (std::int64_t i = 1; i < static_cast<std::int64_t>(numPoints); i++)
+                _index->addPoint(data + i * numDimensions, static_cast<std::size_t>(i));
+
+            _index->setEf(getKnnParameters().getHNSWef());
+        }
+
+        bool load(const std::filesystem::path& path)
+        {
+            try
+            {
+                _index = std::make_unique<hnswlib::HierarchicalNSW<float>>(_space.get(), path.string());
+            }
+            catch (const std::exception& exception)
+            {
+                qWarning() << "KnnIndex: cannot read HNSW index" << toQString(path) << ":" << exception.what();
+                return false;
+            }
+
+            _index->setEf(getKnnParameters().getHNSWef());
+
+            return _index->cur_element_count == getNumPoints();
+        }
+
+        bool save(const std::filesystem::path& path) const override
+        {
+            try
+            {
+                _index->saveIndex(path.string());
+            }
+            catch (const std::exception& exception)
+            {
+                qWarning() << "KnnIndex: cannot write HNSW index" << toQString(path) << ":" << exception.what();
+                return false;
+            }
+
+            return true;
+        }
+
+        void search(const float* query, std::uint32_t numNeighbors, std::vector<Neighbor>& result) const override
+        {
+            auto queue = _index->searchKnn(query, numNeighbors);
+
+            // The queue holds the farthest result on top
+            result.resize(queue.size());
+
+            for (auto neighbor = result.rbegin(); neighbor != result.rend(); ++neighbor, queue.pop())
+                *neighbor = { queue.top().first, static_cast<std::uint32_t>(queue.top().second) };
+        }
+
+    private:
+        std::unique_ptr<hnswlib::SpaceInterface<float>>     _space;     /** Distance of the metric, used by the index */
+        std::unique_ptr<hnswlib::HierarchicalNSW<float>>    _index;     /** Graph index */
+    };
+
+    /** Annoy index, memory-mapped from its backing file, which is written right after the construction or copied on load */
+    template <typename Distance>
+    class AnnoyKnnIndex : public KnnIndex
+    {
+        using Index = Annoy::AnnoyIndex<int, float, Distance, Annoy::Kiss32Random, Annoy::AnnoyIndexSingleThreadedBuildPolicy>;
+
+    public:
+        AnnoyKnnIndex(std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters) :
+            KnnIndex(numPoints, numDimensions, knnParameters),
+            _index(static_cast<int>(numDimensions))
+        {
+        }
+
+        ~AnnoyKnnIndex() override
+        {
+            _index.unload();
+
+            if (!_backingFile.empty())
+            {
+                std::error_code error;
+                std::filesystem::remove(_backingFile, error);
+            }
+        }
+
+        void build(const float* data)
+        {
+            const std::size_t numDimensions = getNumDimensions();
+
+            for (std::uint32_t i = 0; i < getNumPoints(); i++)
+                _index.add_item(static_cast<int>(i), data + i * numDimensions);
+
+            _index.build(getKnnParameters().getAnnoyNumTrees());
+
+            // Annoy unloads the index and maps it from the file it saves to, so that happens once here and not in save(),
+            // which may run concurrently with searches. If it fails the index stays in memory and cannot be saved
+            const auto backingFile = createBackingFilePath();
+
+            if (!_index.save(backingFile.string().c_str()))
+            {
+                qWarning() << "KnnIndex: cannot write Annoy index" << toQString(backingFile);
+
+                std::error_code error;
+                std::filesystem::remove(backingFile, error);
+                return;
+            }
+
+            _backingFile = backingFile;
+        }
+
+        bool load(const std::filesystem::path& path)
+        {
+            std::error_code error;
+            const auto backingFile = createBackingFilePath();
+
+            // The file that is handed in may be removed while the index is in use, e.g. the files of an opened project
+            if (!std::filesystem::copy_file(path, backingFile, std::filesystem::copy_options::overwrite_existing, error) || !_index.load(backingFile.string().c_str()))
+            {
+                qWarning() << "KnnIndex: cannot read Annoy index" << toQString(path);
+                std::filesystem::remove(backingFile, error);
+                return false;
+            }
+
+            _backingFile = backingFile;
+
+            return static_cast<std::uint32_t>(_index.get_n_items()) == getNumPoints();
+        }
+
+        bool save(const std::filesystem::path& path) const override
+        {
+            std::error_code error;
+
+            if (_backingFile.empty() || !std::filesystem::copy_file(_backingFile, path, std::filesystem::copy_options::overwrite_existing, error))
+            {
+                qWarning() << "KnnIndex: cannot write Annoy index" << toQString(path);
+                return false;
+            }
+
+            return true;
+        }
+
+        void search(const float* query, std::uint32_t numNeighbors, std::vector<Neighbor>& result) const override
+        {
+            thread_local std::vector<int> indices;
+            thread_local std::vector<float> distances;
+
+            indices.clear();
+            distances.clear();
+
+            _index.get_nns_by_vector(query, numNeighbors, getKnnParameters().getAnnoyNumChecks(), &indices, &distances);
+
+            result.resize(indices.size());
+
+            for (std::size_t k = 0; k < indices.size(); k++)
+                result[k] = { distances[k], static_cast<std::uint32_t>(indices[k]) };
+        }
+
+    private:
+        Index                   _index;         /** Forest of random projection trees */
+        std::filesystem::path   _backingFile;   /** File the index is mapped from, empty if it could not be written */
+    };
+
+    template <typename Index>
+    std::unique_ptr<KnnIndex> buildIndex(const float* data, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters)
+    {
+        auto index = std::make_unique<Index>(numPoints, numDimensions, knnParameters);
+        index->build(data);
+        return index;
+    }
+
+    template <typename Index>
+    std::unique_ptr<KnnIndex> loadIndex(const std::filesystem::path& path, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters)
+    {
+        auto index = std::make_unique<Index>(numPoints, numDimensions, knnParameters);
+
+        if (!index->load(path))
+            return nullptr;
+
+        return index;
+    }
+
+    /** Calls function with a null pointer of the index type for the library and metric */
+    template <typename Function>
+    auto visitIndexType(const KnnParameters& knnParameters, Function function)
+    {
+        if (knnParameters.getKnnAlgorithm() == hdi::dr::knn_library::KNN_HNSW)
+            return function(static_cast<HnswKnnIndex*>(nullptr));
+
+        switch (knnParameters.getKnnDistanceMetric())
+        {
+        case hdi::dr::knn_distance_metric::KNN_METRIC_COSINE:       return function(static_cast<AnnoyKnnIndex<Annoy::Angular>*>(nullptr));
+        case hdi::dr::knn_distance_metric::KNN_METRIC_MANHATTAN:    return function(static_cast<AnnoyKnnIndex<Annoy::Manhattan>*>(nullptr));
+        case hdi::dr::knn_distance_metric::KNN_METRIC_DOT:          return function(static_cast<AnnoyKnnIndex<Annoy::DotProduct>*>(nullptr));
+        default:                                                    return function(static_cast<AnnoyKnnIndex<Annoy::Euclidean>*>(nullptr));
+        }
+    }
+}
+
+KnnIndex::KnnIndex(std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters) :
+    _numPoints(numPoints),
+    _numDimensions(numDimensions),
+    _knnParameters(knnParameters)
+{
+}
+
+bool KnnIndex::supports(const KnnParameters& knnParameters)
+{
+    const auto metric = knnParameters.getKnnDistanceMetric();
+
+    switch (knnParameters.getKnnAlgorithm())
+    {
+    case hdi::dr::knn_library::KNN_HNSW:
+        return metric == hdi::dr::knn_distance_metric::KNN_METRIC_EUCLIDEAN || metric == hdi::dr::knn_distance_metric::KNN_METRIC_INNER_PRODUCT;
+    case hdi::dr::knn_library::KNN_ANNOY:
+        return metric == hdi::dr::knn_distance_metric::KNN_METRIC_EUCLIDEAN || metric == hdi::dr::knn_distance_metric::KNN_METRIC_COSINE ||
+               metric == hdi::dr::knn_distance_metric::KNN_METRIC_MANHATTAN || metric == hdi::dr::knn_distance_metric::KNN_METRIC_DOT;
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<KnnIndex> KnnIndex::build(const float* data, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters)
+{
+    assert(supports(knnParameters));
+
+    return visitIndexType(knnParameters, [&](auto* type) -> std::unique_ptr<KnnIndex> {
+        return buildIndex<std::remove_pointer_t<decltype(type)>>(data, numPoints, numDimensions, knnParameters);
+        });
+}
+
+std::unique_ptr<KnnIndex> KnnIndex::load(const std::filesystem::path& path, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters)
+{
+    if (!supports(knnParameters))
+        return nullptr;
+
+    return visitIndexType(knnParameters, [&](auto* type) -> std::unique_ptr<KnnIndex> {
+        return loadIndex<std::remove_pointer_t<decltype(type)>>(path, numPoints, numDimensions, knnParameters);
+        });
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "KnnParameters.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * KnnIndex
+ *
+ * Approximate nearest neighbor index (HNSW or Annoy) of a set of points. HDILib discards its index once
+ * the neighbors are found, this one is kept, so that other numbers of neighbors and points that were
+ * added later can be searched without building it again.
+ *
+ * Indices are stored in the file formats of the libraries. Annoy maps its files into memory, so a built
+ * or loaded Annoy index is backed by a private file in the temporary directory, which lives as long as
+ * the index; saving only copies that file. hnswlib can only read its files into memory.
+ */
+class KnnIndex
+{
+public:
+    /** Search result: distance in the units of the library and index of the point */
+    using Neighbor = std::pair<float, std::uint32_t>;
+
+public:
+    virtual ~KnnIndex() = default;
+
+    /** Whether the parameters select a library and metric that can be built here (HNSW: Euclidean, inner product; Annoy: Euclidean, cosine, Manhattan, dot) */
+    static bool supports(const KnnParameters& knnParameters);
+
+    /**
+     * Index the points with the library and metric of the parameters, which have to be supported
+     * @param data Row-major points, only read during the construction
+     */
+    static std::unique_ptr<KnnIndex> build(const float* data, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters);
+
+    /** Index that was saved with the same library and metric, nullptr if the file cannot be read or does not hold numPoints points */
+    static std::unique_ptr<KnnIndex> load(const std::filesystem::path& path, std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters);
+
+    /** Write the index to path, returns false if it could not be written, thread-safe */
+    virtual bool save(const std::filesystem::path& path) const = 0;
+
+    /**
+     * Up to numNeighbors nearest indexed points of the query, sorted by increasing distance, thread-safe
+     * @param query Point with getNumDimensions() values
+     * @param result Reused output
+     */
+    virtual void search(const float* query, std::uint32_t numNeighbors, std::vector<Neighbor>& result) const = 0;
+
+    std::uint32_t getNumPoints() const { return _numPoints; }
+    std::uint32_t getNumDimensions() const { return _numDimensions; }
+
+    /** Library, metric and library parameters the index was built with */
+    const KnnParameters& getKnnParameters() const { return _knnParameters; }
+
+protected:
+    KnnIndex(std::uint32_t numPoints, std::uint32_t numDimensions, const KnnParameters& knnParameters);
+
+private:
+    std::uint32_t   _numPoints;         /** Number of indexed points */
+    std::uint32_t   _numDimensions;     /** Number of dimensions per point */
+    KnnParameters   _knnParameters;     /** Parameters of the index */
+};
@@ -2,6 +2,40 @@
 
 #include "hdi/dimensionality_reduction/knn_utils.h"
 
+/** Implementation of the nearest neighbor search */
+enum class KnnBackend
+{
+    Library,        /** Approximate search with the HDILib library given by the knn_library */
+    BruteForce,     /** Exact search with our own brute-force engine, see BruteForceKnn.h */
+    Auto            /** One of the above with parameters chosen by measurements on a sample, see KnnAutoSelection.h */
+};
+
+/** Storage of the data during the brute-force search only, the libraries index the dense data. Reduced precisions re-rank their candidates exactly, see QuantizedData.h */
+enum class KnnPrecision
+{
+    Float32,        /** The input as it is */
+    Float16,        /** Half precision floats */
+    Int8,           /** One byte per value, scaled to the range of every dimension */
+    Sparse          /** The non-zero values of the input, for metrics that SparseDistance supports, see SparseData.h */
+};
+
+inline const char* knnPrecisionName(KnnPrecision knnPrecision)
+{
+    switch (knnPrecision)
+    {
+    case KnnPrecision::Float16: return "16-bit float";
+    case KnnPrecision::Int8:    return "8-bit integer";
+    case KnnPrecision::Sparse:  return "sparse 32-bit float";
+    default:                    return "32-bit float";
+    }
+}
+
+/** Whether the brute-force search with the precision finds the exact neighbors, without re-ranking */
+inline bool isFullKnnPrecision(KnnPrecision knnPrecision)
+{
+    return knnPrecision == KnnPrecision::Float32 || knnPrecision == KnnPrecision::Sparse;
+}
+
 /**
  * KnnParameters
  *
@@ -13,31 +47,62 @@ class KnnParameters
 {
 public:
     KnnParameters() :
+        _knnBackend(KnnBackend::Library),
         _knnLibrary(hdi::dr::KNN_FLANN),
         _aknn_metric(hdi::dr::KNN_METRIC_EUCLIDEAN),
         _AnnoyNumChecksAknn(512),
         _AnnoyNumTrees(4),
         _HNSW_M(16),
-        _HNSW_ef_construction(200)
+        _HNSW_ef_construction(200),
+        _cacheKnnGraph(false),
+        _numPcaComponents(0),
+        _knnPrecision(KnnPrecision::Float32)
     {
 
     }
+    void setKnnBackend(KnnBackend knnBackend) { _knnBackend = knnBackend; }
     void setKnnAlgorithm(hdi::dr::knn_library knnLibrary) { _knnLibrary = knnLibrary; }
     void setKnnDistanceMetric(hdi::dr::knn_distance_metric knnDistanceMetric) { _aknn_metric = knnDistanceMetric; }
     void setAnnoyNumChecks(int numChecks) { _AnnoyNumChecksAknn = numChecks; }
     void setAnnoyNumTrees(int numTrees) { _AnnoyNumTrees = numTrees; }
     void setHNSWm(int m) { _HNSW_M = m; }
     void setHNSWef(int ef) { _HNSW_ef_construction = ef; }
+    void setCacheKnnGraph(bool cacheKnnGraph) { _cacheKnnGraph = cacheKnnGraph; }
+    void setNumPcaComponents(int numPcaComponents) { _numPcaComponents = numPcaComponents; }
+    void setKnnPrecision(KnnPrecision knnPrecision) { _knnPrecision = knnPrecision; }
 
+    KnnBackend getKnnBackend() const { return _knnBackend; }
     hdi::dr::knn_library getKnnAlgorithm() const { return _knnLibrary; }
     hdi::dr::knn_distance_metric getKnnDistanceMetric() const { return _aknn_metric; }
     int getAnnoyNumChecks() const { return _AnnoyNumChecksAknn; }
     int getAnnoyNumTrees() const { return _AnnoyNumTrees; }
     int getHNSWm() const { return _HNSW_M; }
     int getHNSWef() const { return _HNSW_ef_construction; }
+    bool getCacheKnnGraph() const { return _cacheKnnGraph; }
+    int getNumPcaComponents() const { return _numPcaComponents; }
+    KnnPrecision getKnnPrecision() const { return _knnPrecision; }
+
+    /** Whether a search with the other parameters finds the same neighbors, the library parameters only matter for the libraries */
+    bool yieldsSameNeighbors(const KnnParameters& other) const
+    {
+        if (_knnBackend != other._knnBackend || _aknn_metric != other._aknn_metric || _numPcaComponents != other._numPcaComponents)
+            return false;
+
+        // Only the brute-force search, which the automatic selection may choose, uses the precision
+        if (_knnBackend != KnnBackend::Library && _knnPrecision != other._knnPrecision)
+            return false;
+
+        if (_knnBackend == KnnBackend::BruteForce)
+            return true;
+
+        return _knnLibrary == other._knnLibrary &&
+               _AnnoyNumChecksAknn == other._AnnoyNumChecksAknn && _AnnoyNumTrees == other._AnnoyNumTrees &&
+               _HNSW_M == other._HNSW_M && _HNSW_ef_construction == other._HNSW_ef_construction;
+    }
 
 private:
     
+    KnnBackend _knnBackend;                         /** Whether to use a HDILib library, the built-in brute-force search or to select automatically */
     hdi::dr::knn_library _knnLibrary;               /** Enum specifying which approximate nearest neighbour library to use for the similarity computation */
     hdi::dr::knn_distance_metric _aknn_metric;      /** Enum specifying which distance to compute knn with */
     
@@ -46,4 +111,8 @@ private:
 
     int            _HNSW_M;                         /** hnsw: construction time/accuracy trade-off  */
     int            _HNSW_ef_construction;           /** hnsw: maximum number of outgoing connections in the graph  */
+
+    bool _cacheKnnGraph;                            /** Store computed kNN graphs on disk and reuse them, see KnnGraphCache */
+    int _numPcaComponents;                          /** Search the neighbors among the projections onto this many principal components, 0 for the input itself, see PcaProjection */
+    KnnPrecision _knnPrecision;                     /** Storage of the data during the brute-force search */
 };
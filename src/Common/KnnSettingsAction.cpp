@@ -1,5 +1,6 @@
 #include "KnnSettingsAction.h"
 
+#include "KnnGraphCache.h"
 #include "KnnParameters.h"
 
 using namespace mv::gui;
@@ -10,22 +11,42 @@ KnnSettingsAction::KnnSettingsAction(QObject* parent, KnnParameters& knnParamete
     _numTreesAction(this, "Annoy Trees"),
     _numChecksAction(this, "Annoy Checks"),
     _mAction(this, "HNSW M"),
-    _efAction(this, "HNSW ef")
+    _efAction(this, "HNSW ef"),
+    _cacheKnnGraphAction(this, "Cache kNN graph", false),
+    _clearKnnGraphCacheAction(this, "Clear kNN cache"),
+    _pcaAction(this, "PCA projection", false),
+    _numPcaComponentsAction(this, "PCA components"),
+    _precisionAction(this, "Precision")
 {
     addAction(&_numTreesAction);
     addAction(&_numChecksAction);
     addAction(&_mAction);
     addAction(&_efAction);
+    addAction(&_cacheKnnGraphAction);
+    addAction(&_clearKnnGraphCacheAction);
+    addAction(&_pcaAction);
+    addAction(&_numPcaComponentsAction);
+    addAction(&_precisionAction);
 
     _numTreesAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _numChecksAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _mAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _efAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
+    _numPcaComponentsAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
+    _precisionAction.setDefaultWidgetFlags(OptionAction::ComboBox);
 
     _numTreesAction.initialize(1, 10000, 4);
     _numChecksAction.initialize(1, 10000, 1024);
     _mAction.initialize(2, 300, 16);
     _efAction.initialize(1, 10000, 200);
+    _numPcaComponentsAction.initialize(2, 256, 50);
+    _precisionAction.initialize(QStringList({ "32-bit float", "16-bit float", "8-bit integer", "Sparse 32-bit float" }), "32-bit float");
+
+    _cacheKnnGraphAction.setToolTip("Store the nearest neighbors of the data on disk.\nRecomputations with the same data and kNN settings, e.g. with another perplexity, reuse them.\nThe least recently used graphs are removed when the cache exceeds 4 GB.");
+    _clearKnnGraphCacheAction.setToolTip("Remove all cached kNN graphs from disk");
+    _pcaAction.setToolTip("Search the nearest neighbors among the projections of the data onto its first principal components.\nFaster and less memory for data with many dimensions, e.g. thousands of genes.");
+    _numPcaComponentsAction.setToolTip("Number of principal components the data is projected onto");
+    _precisionAction.setToolTip("Precision of the data during the exact (brute force) search.\n16 and 8 bit need half or a quarter of the memory bandwidth and are faster for data with many dimensions,\nthe candidates they find are re-ranked with the full data. The recall is logged.\nThey only save memory if the data is not stored as 32-bit floats, e.g. a subset, some of the dimensions or 16-bit data, otherwise their copy is additional.\nSparse keeps only the non-zero values, e.g. of count data, and is exact for Euclidean, cosine, inner product and dot distances.\nAll of them apply to the brute-force search only, i.e. to small datasets. HNSW, Annoy and the PCA projection use the dense 32-bit data.");
 
     const auto updateNumTrees = [this]() -> void {
         _knnParameters.setAnnoyNumTrees(_numTreesAction.getValue());
@@ -43,6 +64,24 @@ KnnSettingsAction::KnnSettingsAction(QObject* parent, KnnParameters& knnParamete
         _knnParameters.setHNSWef(_efAction.getValue());
     };
 
+    const auto updateCacheKnnGraph = [this]() -> void {
+        _knnParameters.setCacheKnnGraph(_cacheKnnGraphAction.isChecked());
+    };
+
+    const auto updateNumPcaComponents = [this]() -> void {
+        _knnParameters.setNumPcaComponents(_pcaAction.isChecked() ? _numPcaComponentsAction.getValue() : 0);
+    };
+
+    const auto updatePrecision = [this]() -> void {
+        switch (_precisionAction.getCurrentIndex())
+        {
+        case 1:     _knnParameters.setKnnPrecision(KnnPrecision::Float16); break;
+        case 2:     _knnParameters.setKnnPrecision(KnnPrecision::Int8); break;
+        case 3:     _knnParameters.setKnnPrecision(KnnPrecision::Sparse); break;
+        default:    _knnParameters.setKnnPrecision(KnnPrecision::Float32); break;
+        }
+    };
+
     const auto updateReadOnly = [this]() -> void {
         const auto enable = !isReadOnly();
 
@@ -50,6 +89,11 @@ KnnSettingsAction::KnnSettingsAction(QObject* parent, KnnParameters& knnParamete
         _numChecksAction.setEnabled(enable);
         _mAction.setEnabled(enable);
         _efAction.setEnabled(enable);
+        _cacheKnnGraphAction.setEnabled(enable);
+        _clearKnnGraphCacheAction.setEnabled(enable);
+        _pcaAction.setEnabled(enable);
+        _numPcaComponentsAction.setEnabled(enable && _pcaAction.isChecked());
+        _precisionAction.setEnabled(enable);
     };
 
     connect(&_numTreesAction, &IntegralAction::valueChanged, this, [this, updateNumTrees](const std::int32_t& value) {
@@ -68,6 +112,27 @@ KnnSettingsAction::KnnSettingsAction(QObject* parent, KnnParameters& knnParamete
         updateEf();
     });
 
+    connect(&_cacheKnnGraphAction, &ToggleAction::toggled, this, [this, updateCacheKnnGraph](bool toggled) {
+        updateCacheKnnGraph();
+    });
+
+    connect(&_clearKnnGraphCacheAction, &TriggerAction::triggered, this, []() {
+        KnnGraphCache(KnnGraphCache::defaultDirectory()).clear();
+    });
+
+    connect(&_pcaAction, &ToggleAction::toggled, this, [this, updateNumPcaComponents, updateReadOnly](bool toggled) {
+        updateNumPcaComponents();
+        updateReadOnly();
+    });
+
+    connect(&_numPcaComponentsAction, &IntegralAction::valueChanged, this, [this, updateNumPcaComponents](const std::int32_t& value) {
+        updateNumPcaComponents();
+    });
+
+    connect(&_precisionAction, &OptionAction::currentIndexChanged, this, [this, updatePrecision](const std::int32_t& currentIndex) {
+        updatePrecision();
+    });
+
     connect(this, &GroupAction::readOnlyChanged, this, [this, updateReadOnly](const bool& readOnly) {
         updateReadOnly();
     });
@@ -76,6 +141,9 @@ KnnSettingsAction::KnnSettingsAction(QObject* parent, KnnParameters& knnParamete
     updateNumChecks();
     updateM();
     updateEf();
+    updateCacheKnnGraph();
+    updateNumPcaComponents();
+    updatePrecision();
     updateReadOnly();
 }
 
@@ -87,6 +155,10 @@ void KnnSettingsAction::fromVariantMap(const QVariantMap& variantMap)
     _numChecksAction.fromParentVariantMap(variantMap);
     _mAction.fromParentVariantMap(variantMap);
     _efAction.fromParentVariantMap(variantMap);
+    _cacheKnnGraphAction.fromParentVariantMap(variantMap);
+    _pcaAction.fromParentVariantMap(variantMap);
+    _numPcaComponentsAction.fromParentVariantMap(variantMap);
+    _precisionAction.fromParentVariantMap(variantMap);
 }
 
 QVariantMap KnnSettingsAction::toVariantMap() const
@@ -97,6 +169,10 @@ QVariantMap KnnSettingsAction::toVariantMap() const
     _numChecksAction.insertIntoVariantMap(variantMap);
     _mAction.insertIntoVariantMap(variantMap);
     _efAction.insertIntoVariantMap(variantMap);
+    _cacheKnnGraphAction.insertIntoVariantMap(variantMap);
+    _pcaAction.insertIntoVariantMap(variantMap);
+    _numPcaComponentsAction.insertIntoVariantMap(variantMap);
+    _precisionAction.insertIntoVariantMap(variantMap);
 
     return variantMap;
 }
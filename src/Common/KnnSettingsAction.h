@@ -2,6 +2,9 @@
 
 #include "actions/GroupAction.h"
 #include "actions/IntegralAction.h"
+#include "actions/OptionAction.h"
+#include "actions/ToggleAction.h"
+#include "actions/TriggerAction.h"
 
 using namespace mv::gui;
 
@@ -30,6 +33,11 @@ public: // Action getters
     IntegralAction& getNumChecksAction() { return _numChecksAction; };
     IntegralAction& getMAction() { return _mAction; };
     IntegralAction& getEfAction() { return _efAction; };
+    ToggleAction& getCacheKnnGraphAction() { return _cacheKnnGraphAction; };
+    TriggerAction& getClearKnnGraphCacheAction() { return _clearKnnGraphCacheAction; };
+    ToggleAction& getPcaAction() { return _pcaAction; };
+    IntegralAction& getNumPcaComponentsAction() { return _numPcaComponentsAction; };
+    OptionAction& getPrecisionAction() { return _precisionAction; };
 
 public: // Serialization
 
@@ -51,6 +59,11 @@ protected:
     IntegralAction          _numChecksAction;           /** Annoy parameter Checks action */
     IntegralAction          _mAction;                   /** HNSW parameter M action */
     IntegralAction          _efAction;                  /** HNSW parameter ef action */
+    ToggleAction            _cacheKnnGraphAction;       /** Cache kNN graphs on disk action */
+    TriggerAction           _clearKnnGraphCacheAction;  /** Remove the cached kNN graphs action */
+    ToggleAction            _pcaAction;                 /** Project the data with PCA before the kNN search action */
+    IntegralAction          _numPcaComponentsAction;    /** Number of principal components action */
+    OptionAction            _precisionAction;           /** Storage precision of the brute-force search action */
 
     friend class Widget;
 };
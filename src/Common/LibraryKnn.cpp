@@ -0,0 +1,148 @@
+#include "LibraryKnn.h"
+
+#include "MetricDistance.h"
+
+#include "hdi/dimensionality_reduction/hd_joint_probability_generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /**
+     * kNN graph of the points [firstQuery, firstQuery + numQueries) from the candidates a library found for them, in the units of MetricDistance
+     * @param numReferences Candidates have to be among the points [0, numReferences)
+     * @param findCandidates Appends the candidates of a point to a vector, may include the point itself and invalid entries are left out
+     * @param control Points after a stop request are skipped, their rows stay empty
+     */
+    template <typename FindCandidates>
+    KnnGraph collectNeighbors(std::uint32_t firstQuery, std::uint32_t numQueries, std::uint32_t numReferences, std::uint32_t numNeighbors, const MetricDistance& distance, FindCandidates findCandidates, const WorkerControl* control = nullptr)
+    {
+        KnnGraph knnGraph(numQueries, numNeighbors);
+
+#pragma omp parallel
+        {
+            std::vector<std::uint32_t> candidates;
+            std::vector<std::pair<float, std::uint32_t>> row;
+
+#pragma omp for schedule(dynamic, 1024)
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(numQueries); i++)
+            {
+                if (control != nullptr && control->isStopRequested())
+                    continue;
+
+                const auto point = firstQuery + static_cast<std::uint32_t>(i);
+
+                candidates.clear();
+                findCandidates(point, candidates);
+
+                row.clear();
+
+                // The point itself is usually, but not always (duplicates), the first result
+                for (const auto neighbor : candidates)
+                    if (neighbor != point && neighbor < numReferences)
+                        row.emplace_back(distance(point, neighbor), neighbor);
+
+                std::sort(row.begin(), row.end());
+
+                // Rows the library could not fill are padded with the farthest neighbor found
+                std::uint32_t* neighbors = knnGraph.neighbors(static_cast<std::uint32_t>(i));
+                float* distances = knnGraph.distances(static_cast<std::uint32_t>(i));
+
+                for (std::uint32_t k = 0; k < numNeighbors; k++)
+                {
+                    const auto& entry = row.empty() ? std::pair<float, std::uint32_t>(0.f, (point + 1) % numReferences) : row[std::min<std::size_t>(k, row.size() - 1)];
+
+                    neighbors[k] = entry.second;
+                    distances[k] = entry.first;
+                }
+            }
+        }
+
+        return knnGraph;
+    }
+}
+
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t numNeighbors, const KnnParameters& knnParameters)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::uint32_t numDimensions = data.getNumDimensions();
+
+    numNeighbors = std::min(numNeighbors, numPoints > 0 ? numPoints - 1 : 0u);
+
+    if (numNeighbors == 0)
+        return KnnGraph(numPoints, 0);
+
+    hdi::dr::HDJointProbabilityGenerator<float>::Parameters probGenParams;
+
+    // HDILib searches perplexity * perplexity multiplier + 1 neighbors, including the point itself
+    probGenParams._perplexity = numNeighbors / 3.0;
+    probGenParams._perplexity_multiplier = 3;
+    probGenParams._num_trees = knnParameters.getAnnoyNumTrees();
+    probGenParams._num_checks = knnParameters.getAnnoyNumChecks();
+    probGenParams._aknn_algorithmP1 = knnParameters.getHNSWm();
+    probGenParams._aknn_algorithmP2 = knnParameters.getHNSWef();
+    probGenParams._aknn_algorithm = knnParameters.getKnnAlgorithm();
+    probGenParams._aknn_metric = knnParameters.getKnnDistanceMetric();
+
+    // HDILib needs all data in one array, it does not modify it
+    const auto denseData = data.getDenseData();
+
+    std::vector<float> probabilities;
+    std::vector<int> indices;
+
+    {
+        hdi::dr::HDJointProbabilityGenerator<float> probabilityGenerator;
+        probabilityGenerator.computeProbabilityDistributions(const_cast<float*>(denseData.data()), numDimensions, numPoints, probabilities, indices, probGenParams);
+    }
+
+    std::vector<float>().swap(probabilities);
+
+    const std::size_t numResults = indices.size() / numPoints;
+    const MetricDistance distance(denseData.data(), numPoints, numDimensions, knnParameters.getKnnDistanceMetric());
+
+    return collectNeighbors(0, numPoints, numPoints, numNeighbors, distance, [&indices, numResults](std::uint32_t point, std::vector<std::uint32_t>& candidates) {
+        for (std::size_t k = 0; k < numResults; k++)
+            if (indices[point * numResults + k] >= 0)
+                candidates.push_back(static_cast<std::uint32_t>(indices[point * numResults + k]));
+        });
+}
+
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t numNeighbors, const KnnIndex& index, const WorkerControl* control)
+{
+    assert(index.getNumPoints() == data.getNumPoints());
+
+    return computeLibraryKnn(data, 0, numNeighbors, index, control);
+}
+
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t firstQuery, std::uint32_t numNeighbors, const KnnIndex& index, const WorkerControl* control)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::size_t numDimensions = data.getNumDimensions();
+
+    // The indexed points are the references, with firstQuery 0 they are searched themselves
+    const std::uint32_t numReferences = firstQuery > 0 ? firstQuery : numPoints;
+    const std::uint32_t numQueries = numPoints - firstQuery;
+
+    assert(firstQuery <= numPoints && index.getNumPoints() == numReferences && index.getNumDimensions() == numDimensions);
+
+    numNeighbors = std::min(numNeighbors, firstQuery > 0 ? numReferences : (numPoints > 0 ? numPoints - 1 : 0u));
+
+    if (numNeighbors == 0)
+        return KnnGraph(numQueries, 0);
+
+    const auto denseData = data.getDenseData();
+    const MetricDistance distance(denseData.data(), numPoints, static_cast<std::uint32_t>(numDimensions), index.getKnnParameters().getKnnDistanceMetric());
+
+    // One more result than neighbors, in case the point itself is found
+    return collectNeighbors(firstQuery, numQueries, numReferences, numNeighbors, distance, [&index, &denseData, numDimensions, numNeighbors](std::uint32_t point, std::vector<std::uint32_t>& candidates) {
+        thread_local std::vector<KnnIndex::Neighbor> result;
+
+        index.search(denseData.data() + point * numDimensions, numNeighbors + 1, result);
+
+        for (const auto& neighbor : result)
+            candidates.push_back(neighbor.second);
+        }, control);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "KnnGraph.h"
+#include "KnnIndex.h"
+#include "KnnParameters.h"
+#include "WorkerControl.h"
+
+#include <cstdint>
+
+/**
+ * Approximate k nearest neighbors with the HDILib library selected in the kNN parameters (FLANN, HNSW or Annoy)
+ *
+ * HDILib only returns the neighbor indices, the distances are recomputed for the found pairs,
+ * with the conventions of MetricDistance, so the graph equals one of computeBruteForceKnn in layout and units.
+ *
+ * @param data Input points, read into one dense array if the provider is not contiguous
+ * @param numNeighbors Number of neighbors per point, clamped to the number of points - 1
+ * @param knnParameters Library, metric and library parameters
+ */
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t numNeighbors, const KnnParameters& knnParameters);
+
+/**
+ * Approximate k nearest neighbors of the indexed points, searched in an index that was built before
+ *
+ * @param data The indexed points, read into one dense array if the provider is not contiguous
+ * @param numNeighbors Number of neighbors per point, clamped to the number of points - 1
+ * @param index Index of the data, see KnnIndex
+ * @param control Polled per point, the remaining points are skipped and the result is incomplete if a stop was requested
+ */
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t numNeighbors, const KnnIndex& index, const WorkerControl* control = nullptr);
+
+/**
+ * Approximate k nearest neighbors of the points [firstQuery, numPoints) among the indexed points [0, firstQuery),
+ * e.g. of points that were appended to a dataset, see computeBruteForceKnn
+ *
+ * @param data Input points, read into one dense array if the provider is not contiguous
+ * @param firstQuery First point whose neighbors are searched, row q of the result belongs to point firstQuery + q
+ * @param numNeighbors Number of neighbors per point, clamped to firstQuery
+ * @param index Index of the points [0, firstQuery)
+ * @param control Polled per point, see above
+ */
+KnnGraph computeLibraryKnn(const DataProvider& data, std::uint32_t firstQuery, std::uint32_t numNeighbors, const KnnIndex& index, const WorkerControl* control = nullptr);
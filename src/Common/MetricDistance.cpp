@@ -0,0 +1,44 @@
+#include "MetricDistance.h"
+
+#include <cmath>
+
+MetricDistance::MetricDistance(const float* points, std::uint32_t numPoints, std::uint32_t numDimensions, hdi::dr::knn_distance_metric metric) :
+    _points(points),
+    _numDimensions(numDimensions),
+    _metric(metric),
+    _kernel(distance::getKernel(kernelFor(metric))),
+    _inverseNorms()
+{
+    if (metric != hdi::dr::knn_distance_metric::KNN_METRIC_COSINE)
+        return;
+
+    _inverseNorms.resize(numPoints);
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < static_cast<std::int64_t>(numPoints); i++)
+    {
+        const float* p = point(static_cast<std::uint32_t>(i));
+        const float norm = std::sqrt(_kernel(p, p, numDimensions));
+        _inverseNorms[i] = norm > 0.f ? 1.f / norm : 0.f;
+    }
+}
+
+distance::Kernel MetricDistance::kernelFor(hdi::dr::knn_distance_metric metric)
+{
+    switch (metric)
+    {
+    case hdi::dr::knn_distance_metric::KNN_METRIC_COSINE:
+    case hdi::dr::knn_distance_metric::KNN_METRIC_INNER_PRODUCT:
+    case hdi::dr::knn_distance_metric::KNN_METRIC_DOT:
+        return distance::Kernel::DotProduct;
+
+    case hdi::dr::knn_distance_metric::KNN_METRIC_MANHATTAN:
+        return distance::Kernel::Manhattan;
+
+    case hdi::dr::knn_distance_metric::KNN_METRIC_HAMMING:
+        return distance::Kernel::Hamming;
+
+    default:
+        return distance::Kernel::SquaredEuclidean;
+    }
+}
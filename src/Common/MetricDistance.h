@@ -0,0 +1,70 @@
+#pragma once
+
+#include "DistanceKernels.h"
+
+#include "hdi/dimensionality_reduction/knn_utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * MetricDistance
+ *
+ * Distance between two points of a dense dataset in one of HDILib's kNN metrics,
+ * with the conventions of HDILib's kNN libraries:
+ *  Euclidean: squared euclidean distance
+ *  Cosine: 1 - cosine similarity
+ *  Inner product: 1 - dot product
+ *  Manhattan: L1 distance
+ *  Hamming: number of differing dimensions
+ *  Dot: negative dot product
+ * The data is referenced, not copied.
+ */
+class MetricDistance
+{
+public:
+    MetricDistance(const float* points, std::uint32_t numPoints, std::uint32_t numDimensions, hdi::dr::knn_distance_metric metric);
+
+    float operator()(std::uint32_t a, std::uint32_t b) const
+    {
+        const float value = _kernel(point(a), point(b), _numDimensions);
+
+        return fromKernelValue(_metric, value, _metric == hdi::dr::knn_distance_metric::KNN_METRIC_COSINE ? _inverseNorms[a] * _inverseNorms[b] : 1.f);
+    }
+
+    /** Distances between the query and the references [referenceBegin, referenceEnd) */
+    void operator()(std::uint32_t query, std::uint32_t referenceBegin, std::uint32_t referenceEnd, float* out) const
+    {
+        for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+            out[reference - referenceBegin] = (*this)(query, reference);
+    }
+
+    /** Kernel the metric is computed with */
+    static distance::Kernel kernelFor(hdi::dr::knn_distance_metric metric);
+
+    /**
+     * Distance in the metric from the value of its kernel
+     * @param inverseNorms Cosine only: product of the inverse norms of both points
+     */
+    static float fromKernelValue(hdi::dr::knn_distance_metric metric, float value, float inverseNorms)
+    {
+        switch (metric)
+        {
+        case hdi::dr::knn_distance_metric::KNN_METRIC_COSINE:           return 1.f - value * inverseNorms;
+        case hdi::dr::knn_distance_metric::KNN_METRIC_INNER_PRODUCT:    return 1.f - value;
+        case hdi::dr::knn_distance_metric::KNN_METRIC_DOT:              return -value;
+        default:                                                        return value;
+        }
+    }
+
+private:
+    const float* point(std::uint32_t index) const { return _points + static_cast<std::size_t>(index) * _numDimensions; }
+
+private:
+    const float*                    _points;            /** Row-major data */
+    std::uint32_t                   _numDimensions;     /** Number of dimensions per point */
+    hdi::dr::knn_distance_metric    _metric;            /** Distance metric */
+    distance::KernelFunction        _kernel;            /** Kernel for the detected instruction set */
+    std::vector<float>              _inverseNorms;      /** Cosine only: inverse norm of every point, 0 for points without direction */
+};
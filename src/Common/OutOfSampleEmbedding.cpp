@@ -0,0 +1,169 @@
+#include "OutOfSampleEmbedding.h"
+
+#include "BruteForceKnn.h"
+#include "LibraryKnn.h"
+#include "ParallelUtils.h"
+#include "PerplexityCalibration.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+SparseMatrix computeOutOfSampleProbabilities(const DataProvider& data, std::uint32_t numEmbeddedPoints, hdi::dr::knn_distance_metric metric, const OutOfSampleParameters& parameters)
+{
+    const auto numNeighbors = static_cast<std::uint32_t>(parameters.perplexity * parameters.perplexityMultiplier);
+
+    // Without an index, the exact search costs new points times embedded points
+    const auto knnGraph = computeBruteForceKnn(data, numEmbeddedPoints, numNeighbors, metric);
+
+    return computeConditionalProbabilities(knnGraph, parameters.perplexity);
+}
+
+SparseMatrix computeOutOfSampleProbabilities(const DataProvider& data, std::uint32_t numEmbeddedPoints, const KnnIndex& index, const OutOfSampleParameters& parameters)
+{
+    const auto numNeighbors = static_cast<std::uint32_t>(parameters.perplexity * parameters.perplexityMultiplier);
+
+    const auto knnGraph = computeLibraryKnn(data, numEmbeddedPoints, numNeighbors, index);
+
+    return computeConditionalProbabilities(knnGraph, parameters.perplexity);
+}
+
+SparseMatrix extendJointProbabilities(const SparseMatrix& jointProbabilities, const SparseMatrix& outOfSampleProbabilities)
+{
+    const std::uint64_t numEmbeddedNonZeros = jointProbabilities.getNumNonZeros();
+    const std::uint32_t numEmbeddedPoints = jointProbabilities.getNumRows();
+    const std::uint32_t numNewPoints = outOfSampleProbabilities.getNumRows();
+
+    // Rows of the embedded points followed by the rows of the new points, whose columns are embedded points
+    std::vector<std::uint64_t> rowOffsets(jointProbabilities.getRowOffsets());
+    rowOffsets.reserve(static_cast<std::size_t>(numEmbeddedPoints) + numNewPoints + 1);
+
+    for (std::uint32_t row = 1; row <= numNewPoints; row++)
+        rowOffsets.push_back(numEmbeddedNonZeros + outOfSampleProbabilities.getRowOffsets()[row]);
+
+    std::vector<std::uint32_t> columns(jointProbabilities.getColumns());
+    columns.insert(columns.end(), outOfSampleProbabilities.getColumns().begin(), outOfSampleProbabilities.getColumns().end());
+
+    std::vector<float> values(jointProbabilities.getValues());
+    values.insert(values.end(), outOfSampleProbabilities.getValues().begin(), outOfSampleProbabilities.getValues().end());
+
+    // The embedded block is symmetric already, the new rows contribute half to their row and half to their column
+    return SparseMatrix(std::move(rowOffsets), std::move(columns), std::move(values)).symmetrized();
+}
+
+void OutOfSampleGradientDescent::initialize(std::shared_ptr<const SparseMatrix> probabilities, Embedding* embedding, const OutOfSampleParameters& parameters)
+{
+    assert(probabilities != nullptr && embedding != nullptr && embedding->numDimensions() == 2);
+    assert(probabilities->getNumRows() <= embedding->numDataPoints());
+
+    _P                  = std::move(probabilities);
+    _embedding          = embedding;
+    _params             = parameters;
+    _numEmbeddedPoints  = embedding->numDataPoints() - _P->getNumRows();
+    _iteration          = 0;
+
+    float* positions = _embedding->getContainer().data();
+
+    _tree.build(positions, _numEmbeddedPoints);
+
+    const auto& rowOffsets  = _P->getRowOffsets();
+    const auto& columns     = _P->getColumns();
+    const auto& values      = _P->getValues();
+
+    const std::int64_t numNewPoints = _P->getNumRows();
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t i = 0; i < numNewPoints; i++)
+    {
+        float x = 0.f, y = 0.f, sum = 0.f;
+
+        for (std::uint64_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)
+        {
+            x += values[k] * positions[2ull * columns[k]];
+            y += values[k] * positions[2ull * columns[k] + 1];
+            sum += values[k];
+        }
+
+        const std::size_t point = static_cast<std::size_t>(_numEmbeddedPoints) + i;
+
+        positions[2 * point]     = sum > 0.f ? x / sum : 0.f;
+        positions[2 * point + 1] = sum > 0.f ? y / sum : 0.f;
+    }
+
+    _gains.assign(2ull * numNewPoints, 1.f);
+    _velocity.assign(2ull * numNewPoints, 0.f);
+}
+
+void OutOfSampleGradientDescent::doAnIteration()
+{
+    assert(isInitialized());
+
+    float* positions = _embedding->getContainer().data();
+
+    const auto& rowOffsets  = _P->getRowOffsets();
+    const auto& columns     = _P->getColumns();
+    const auto& values      = _P->getValues();
+
+    const float theta = _params.theta;
+    const std::int64_t numNewPoints = _P->getNumRows();
+
+    // The new points only interact with the fixed points, so every point is updated right away
+#pragma omp parallel for schedule(dynamic, 256)
+    for (std::int64_t i = 0; i < numNewPoints; i++)
+    {
+        float* position = positions + 2 * (static_cast<std::size_t>(_numEmbeddedPoints) + i);
+
+        const float x = position[0];
+        const float y = position[1];
+
+        float attractiveX = 0.f, attractiveY = 0.f;
+
+        SNE_OMP_SIMD_REDUCTION(+:attractiveX, attractiveY)
+        for (std::uint64_t k = rowOffsets[i]; k < rowOffsets[i + 1]; k++)
+        {
+            const std::uint32_t j = columns[k];
+            const float dx = x - positions[2ull * j];
+            const float dy = y - positions[2ull * j + 1];
+            const float pq = values[k] / (1.f + dx * dx + dy * dy);
+
+            attractiveX += pq * dx;
+            attractiveY += pq * dy;
+        }
+
+        // Repulsion normalized over the distribution of this point only
+        float repulsiveX = 0.f, repulsiveY = 0.f;
+        double sumQ = 0.;
+
+        _tree.computeRepulsion(x, y, theta, repulsiveX, repulsiveY, sumQ);
+
+        const float repulsiveScale = static_cast<float>(1. / std::max(sumQ, 1e-12));
+
+        float gradient[2] = {
+            _params.exaggeration * attractiveX - repulsiveScale * repulsiveX,
+            _params.exaggeration * attractiveY - repulsiveScale * repulsiveY
+        };
+
+        const float norm = std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1]);
+
+        if (norm > _params.maxGradientNorm)
+        {
+            gradient[0] *= _params.maxGradientNorm / norm;
+            gradient[1] *= _params.maxGradientNorm / norm;
+        }
+
+        for (int d = 0; d < 2; d++)
+        {
+            const std::size_t c = 2 * static_cast<std::size_t>(i) + d;
+            const float g = gradient[d];
+
+            // Increase the gain if the gradient changed direction w.r.t. the last step
+            const float gain = (g > 0.f) != (_velocity[c] > 0.f) ? _gains[c] + 0.2f : std::max(_gains[c] * 0.8f, 0.01f);
+            _gains[c] = gain;
+
+            _velocity[c] = _params.momentum * _velocity[c] - _params.learningRate * gain * g;
+            position[d] += _velocity[c];
+        }
+    }
+
+    _iteration++;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "KnnIndex.h"
+#include "QuadTree.h"
+#include "SparseMatrix.h"
+
+#include "hdi/data/embedding.h"
+#include "hdi/dimensionality_reduction/knn_utils.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Out-of-sample t-SNE: points that were appended to a dataset are placed into the existing
+ * 2D embedding of the other points, which is held fixed.
+ *
+ * Every new point i gets conditional probabilities p_j|i over its nearest embedded neighbors j and
+ * its position minimizes KL(p_.|i || q_.|i), with q_.|i the Student-t distribution of its distances
+ * to all embedded points. New points do not interact with each other, so the cost scales with their
+ * number, not with the size of the embedding. The schedule follows openTSNE's transform.
+ */
+struct OutOfSampleParameters
+{
+    float   perplexity = 30.f;              /** Perplexity of the conditional probabilities */
+    int     perplexityMultiplier = 3;       /** Neighbors per point in multiples of the perplexity */
+    float   learningRate = 0.1f;            /** Step size */
+    float   momentum = 0.8f;                /** Momentum of the steps */
+    float   exaggeration = 1.5f;            /** Factor of the attractive forces, keeps new points close to their neighbors */
+    float   maxGradientNorm = 0.25f;        /** Gradients are clipped to this norm, points far from their neighbors move steadily */
+    float   theta = 0.5f;                   /** Barnes-Hut accuracy of the repulsive forces */
+};
+
+/**
+ * Conditional probabilities of the points [numEmbeddedPoints, numPoints) over their exact nearest neighbors among the points [0, numEmbeddedPoints)
+ * Row q of the result belongs to point numEmbeddedPoints + q, every row sums to 1
+ */
+SparseMatrix computeOutOfSampleProbabilities(const DataProvider& data, std::uint32_t numEmbeddedPoints, hdi::dr::knn_distance_metric metric, const OutOfSampleParameters& parameters);
+
+/** As above, with the approximate neighbors in the index of the embedded points */
+SparseMatrix computeOutOfSampleProbabilities(const DataProvider& data, std::uint32_t numEmbeddedPoints, const KnnIndex& index, const OutOfSampleParameters& parameters);
+
+/**
+ * Joint distribution of all points: the symmetric joint distribution of the embedded points, extended by the
+ * conditional probabilities of the new points and symmetrized, such that a gradient descent over all points can continue
+ */
+SparseMatrix extendJointProbabilities(const SparseMatrix& jointProbabilities, const SparseMatrix& outOfSampleProbabilities);
+
+/**
+ * OutOfSampleGradientDescent
+ *
+ * Gradient descent of the new points in an embedding whose first points are fixed.
+ * The repulsive forces of the fixed points are approximated with a Barnes-Hut tree that is built once.
+ */
+class OutOfSampleGradientDescent
+{
+public:
+    using Embedding = hdi::data::Embedding<float>;
+
+public:
+    /**
+     * Place every new point at the probability-weighted mean of its neighbors
+     * @param probabilities Conditional probabilities of the new points, see computeOutOfSampleProbabilities
+     * @param embedding 2D embedding of the fixed points followed by the new ones, not owned
+     * @param parameters Optimization parameters
+     */
+    void initialize(std::shared_ptr<const SparseMatrix> probabilities, Embedding* embedding, const OutOfSampleParameters& parameters);
+
+    /** Perform one gradient descent step on the positions of the new points */
+    void doAnIteration();
+
+    bool isInitialized() const { return _embedding != nullptr; }
+    int iteration() const { return _iteration; }
+
+private:
+    std::shared_ptr<const SparseMatrix>     _P;                     /** Conditional probabilities of the new points */
+    Embedding*                              _embedding = nullptr;   /** Embedding that is optimized, not owned */
+    OutOfSampleParameters                   _params;                /** Optimization parameters */
+    std::uint32_t                           _numEmbeddedPoints = 0; /** Number of fixed points at the start of the embedding */
+    int                                     _iteration = 0;         /** Current iteration */
+    QuadTree                                _tree;                  /** Barnes-Hut tree of the fixed points */
+    std::vector<float>                      _gains;                 /** Per-coordinate adaptive gains of the new points */
+    std::vector<float>                      _velocity;              /** Per-coordinate momentum term of the new points */
+};
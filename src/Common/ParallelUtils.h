@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+// MSVC only implements OpenMP 2.0, which does not know simd constructs
+#if defined(_OPENMP) && _OPENMP >= 201307
+    #define SNE_PRAGMA(x) _Pragma(#x)
+    #define SNE_OMP_SIMD SNE_PRAGMA(omp simd)
+    #define SNE_OMP_SIMD_REDUCTION(...) SNE_PRAGMA(omp simd reduction(__VA_ARGS__))
+#else
+    #define SNE_OMP_SIMD
+    #define SNE_OMP_SIMD_REDUCTION(...)
+#endif
+
+/** Number of threads an OpenMP parallel region will use */
+inline int numParallelThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/** Number of threads for the OpenMP parallel regions started by the calling thread */
+inline void setNumParallelThreads(int numThreads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(std::max(1, numThreads));
+#else
+    (void)numThreads;
+#endif
+}
+
+/** Index of the calling thread inside an OpenMP parallel region */
+inline int parallelThreadIndex()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Replaces the values by their exclusive prefix sum and returns the total
+ * Blocked two-pass scan: per-block sums, scan of the block sums, per-block rescan
+ */
+template <typename T>
+T exclusiveScan(std::vector<T>& values)
+{
+    const std::int64_t numValues = static_cast<std::int64_t>(values.size());
+    const std::int64_t numBlocks = std::max<std::int64_t>(1, std::min<std::int64_t>(numParallelThreads() * 4, numValues / 4096));
+    const std::int64_t blockSize = (numValues + numBlocks - 1) / numBlocks;
+
+    std::vector<T> blockSums(numBlocks + 1, T(0));
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        const std::int64_t begin = block * blockSize;
+        const std::int64_t end = std::min(begin + blockSize, numValues);
+
+        T sum = T(0);
+        for (std::int64_t i = begin; i < end; i++)
+            sum += values[i];
+
+        blockSums[block + 1] = sum;
+    }
+
+    for (std::int64_t block = 0; block < numBlocks; block++)
+        blockSums[block + 1] += blockSums[block];
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        const std::int64_t begin = block * blockSize;
+        const std::int64_t end = std::min(begin + blockSize, numValues);
+
+        T running = blockSums[block];
+        for (std::int64_t i = begin; i < end; i++)
+        {
+            const T value = values[i];
+            values[i] = running;
+            running += value;
+        }
+    }
+
+    return blockSums[numBlocks];
+}
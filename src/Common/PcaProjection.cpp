@@ -0,0 +1,378 @@
+#include "PcaProjection.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace
+{
+    /** Points per block, such that a block of a non-contiguous provider takes about 64 MB */
+    std::uint32_t blockSizeFor(std::uint32_t numDimensions)
+    {
+        return std::clamp<std::uint32_t>((1u << 24) / std::max(numDimensions, 1u), 256u, 65536u);
+    }
+
+    /**
+     * Eigen decomposition of a symmetric matrix with cyclic Jacobi rotations
+     * @param matrix Row-major n x n matrix, destroyed
+     * @param values Eigenvalues, descending
+     * @param vectors Row-major n x n matrix with the eigenvectors as columns, in the order of the values
+     */
+    void symmetricEigen(std::vector<double> matrix, std::size_t n, std::vector<double>& values, std::vector<double>& vectors)
+    {
+        std::vector<double> rotations(n * n, 0.);
+
+        for (std::size_t i = 0; i < n; i++)
+            rotations[i * n + i] = 1.;
+
+        const auto at = [&matrix, n](std::size_t row, std::size_t column) -> double& { return matrix[row * n + column]; };
+
+        for (int sweep = 0; sweep < 64; sweep++)
+        {
+            double offDiagonal = 0., diagonal = 0.;
+
+            for (std::size_t p = 0; p < n; p++)
+            {
+                diagonal += at(p, p) * at(p, p);
+
+                for (std::size_t q = p + 1; q < n; q++)
+                    offDiagonal += at(p, q) * at(p, q);
+            }
+
+            if (offDiagonal <= 1e-24 * diagonal || offDiagonal == 0.)
+                break;
+
+            for (std::size_t p = 0; p < n; p++)
+            {
+                for (std::size_t q = p + 1; q < n; q++)
+                {
+                    if (at(p, q) == 0.)
+                        continue;
+
+                    // Rotation that zeroes the (p, q) entry
+                    const double theta = (at(q, q) - at(p, p)) / (2. * at(p, q));
+                    const double t = (theta >= 0. ? 1. : -1.) / (std::abs(theta) + std::sqrt(theta * theta + 1.));
+                    const double c = 1. / std::sqrt(t * t + 1.);
+                    const double s = t * c;
+
+                    for (std::size_t k = 0; k < n; k++)
+                    {
+                        const double kp = at(k, p), kq = at(k, q);
+                        at(k, p) = c * kp - s * kq;
+                        at(k, q) = s * kp + c * kq;
+                    }
+
+                    for (std::size_t k = 0; k < n; k++)
+                    {
+                        const double pk = at(p, k), qk = at(q, k);
+                        at(p, k) = c * pk - s * qk;
+                        at(q, k) = s * pk + c * qk;
+                    }
+
+                    for (std::size_t k = 0; k < n; k++)
+                    {
+                        const double kp = rotations[k * n + p], kq = rotations[k * n + q];
+                        rotations[k * n + p] = c * kp - s * kq;
+                        rotations[k * n + q] = s * kp + c * kq;
+                    }
+                }
+            }
+        }
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&at](std::size_t a, std::size_t b) { return at(a, a) > at(b, b); });
+
+        values.resize(n);
+        vectors.resize(n * n);
+
+        for (std::size_t j = 0; j < n; j++)
+        {
+            values[j] = at(order[j], order[j]);
+
+            for (std::size_t k = 0; k < n; k++)
+                vectors[k * n + j] = rotations[k * n + order[j]];
+        }
+    }
+
+    /** Gram matrix A^T A of a row-major rows x width matrix */
+    std::vector<double> gramMatrix(const std::vector<float>& matrix, std::size_t rows, std::size_t width)
+    {
+        std::vector<double> gram(width * width, 0.);
+
+#pragma omp parallel
+        {
+            std::vector<double> partial(width * width, 0.);
+
+#pragma omp for schedule(static)
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(rows); i++)
+            {
+                const float* row = matrix.data() + i * width;
+
+                for (std::size_t a = 0; a < width; a++)
+                    for (std::size_t b = a; b < width; b++)
+                        partial[a * width + b] += static_cast<double>(row[a]) * row[b];
+            }
+
+#pragma omp critical
+            for (std::size_t k = 0; k < partial.size(); k++)
+                gram[k] += partial[k];
+        }
+
+        for (std::size_t a = 0; a < width; a++)
+            for (std::size_t b = 0; b < a; b++)
+                gram[a * width + b] = gram[b * width + a];
+
+        return gram;
+    }
+
+    /** Replace A by A * transform, transform is width x width */
+    void multiplyInPlace(std::vector<float>& matrix, std::size_t rows, std::size_t width, const std::vector<float>& transform)
+    {
+#pragma omp parallel
+        {
+            std::vector<float> row(width);
+
+#pragma omp for schedule(static)
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(rows); i++)
+            {
+                float* values = matrix.data() + i * width;
+
+                std::fill(row.begin(), row.end(), 0.f);
+
+                for (std::size_t a = 0; a < width; a++)
+                {
+                    const float value = values[a];
+
+                    SNE_OMP_SIMD
+                    for (std::int64_t b = 0; b < static_cast<std::int64_t>(width); b++)
+                        row[b] += value * transform[a * width + b];
+                }
+
+                std::copy(row.begin(), row.end(), values);
+            }
+        }
+    }
+
+    /**
+     * Orthonormalize the columns of a row-major rows x width matrix by the eigen decomposition of its Gram matrix, twice for accuracy
+     * Columns without independent direction become zero
+     */
+    void orthonormalize(std::vector<float>& matrix, std::size_t rows, std::size_t width)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            std::vector<double> values, vectors;
+            symmetricEigen(gramMatrix(matrix, rows, width), width, values, vectors);
+
+            const double threshold = std::max(values.front(), 0.) * 1e-10;
+
+            // transform = W * diag(1 / sqrt(lambda)), mapping onto the orthonormal eigenbasis of the Gram matrix
+            std::vector<float> transform(width * width, 0.f);
+
+            for (std::size_t j = 0; j < width; j++)
+            {
+                if (values[j] <= threshold || values[j] <= 0.)
+                    continue;
+
+                const double scale = 1. / std::sqrt(values[j]);
+
+                for (std::size_t k = 0; k < width; k++)
+                    transform[k * width + j] = static_cast<float>(vectors[k * width + j] * scale);
+            }
+
+            multiplyInPlace(matrix, rows, width, transform);
+        }
+    }
+
+    /** result[begin + i] = (x_i - mean) * weights for the points of a block, weights are numDimensions x width */
+    void multiplyBlock(const float* block, std::uint32_t begin, std::uint32_t count, std::size_t numDimensions, const std::vector<float>& mean, const std::vector<float>& weights, std::size_t width, float* result)
+    {
+#pragma omp parallel for schedule(static)
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+        {
+            const float* point = block + i * numDimensions;
+            float* row = result + (begin + i) * width;
+
+            std::fill(row, row + width, 0.f);
+
+            for (std::size_t d = 0; d < numDimensions; d++)
+            {
+                const float value = point[d] - mean[d];
+                const float* weight = weights.data() + d * width;
+
+                SNE_OMP_SIMD
+                for (std::int64_t c = 0; c < static_cast<std::int64_t>(width); c++)
+                    row[c] += value * weight[c];
+            }
+        }
+    }
+
+    /** result += (X_block - mean)^T * factors[begin, begin + count), result is numDimensions x width */
+    void multiplyTransposedBlock(const float* block, std::uint32_t begin, std::uint32_t count, std::size_t numDimensions, const std::vector<float>& mean, const std::vector<float>& factors, std::size_t width, std::vector<float>& result)
+    {
+        // Threads own ranges of dimensions, so they accumulate without synchronization
+        constexpr std::int64_t dimensionsPerRange = 64;
+        const std::int64_t numRanges = (static_cast<std::int64_t>(numDimensions) + dimensionsPerRange - 1) / dimensionsPerRange;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t range = 0; range < numRanges; range++)
+        {
+            const std::size_t first = range * dimensionsPerRange;
+            const std::size_t last = std::min<std::size_t>(first + dimensionsPerRange, numDimensions);
+
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                const float* point = block + static_cast<std::size_t>(i) * numDimensions;
+                const float* factor = factors.data() + static_cast<std::size_t>(begin + i) * width;
+
+                for (std::size_t d = first; d < last; d++)
+                {
+                    const float value = point[d] - mean[d];
+                    float* row = result.data() + d * width;
+
+                    SNE_OMP_SIMD
+                    for (std::int64_t c = 0; c < static_cast<std::int64_t>(width); c++)
+                        row[c] += value * factor[c];
+                }
+            }
+        }
+    }
+}
+
+PcaProjection PcaProjection::fit(const DataProvider& data, const Parameters& parameters)
+{
+    const std::uint32_t numPoints = data.getNumPoints();
+    const std::size_t numDimensions = data.getNumDimensions();
+    const std::uint32_t blockSize = blockSizeFor(data.getNumDimensions());
+
+    PcaProjection projection;
+
+    // Pass 1: mean
+    std::vector<double> sum(numDimensions, 0.);
+
+    data.forEachBlock(blockSize, [&sum, numDimensions](std::uint32_t, std::uint32_t count, const float* block) {
+        constexpr std::int64_t dimensionsPerRange = 64;
+        const std::int64_t numRanges = (static_cast<std::int64_t>(numDimensions) + dimensionsPerRange - 1) / dimensionsPerRange;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t range = 0; range < numRanges; range++)
+        {
+            const std::size_t first = range * dimensionsPerRange;
+            const std::size_t last = std::min<std::size_t>(first + dimensionsPerRange, numDimensions);
+
+            for (std::uint32_t i = 0; i < count; i++)
+                for (std::size_t d = first; d < last; d++)
+                    sum[d] += block[i * numDimensions + d];
+        }
+        });
+
+    projection._mean.resize(numDimensions);
+
+    for (std::size_t d = 0; d < numDimensions; d++)
+        projection._mean[d] = numPoints > 0 ? static_cast<float>(sum[d] / numPoints) : 0.f;
+
+    const std::size_t width = std::min<std::size_t>({ static_cast<std::size_t>(parameters.numComponents) + parameters.oversampling, numDimensions, numPoints });
+    const std::size_t numComponents = std::min<std::size_t>(parameters.numComponents, width);
+
+    projection._numComponents = static_cast<std::uint32_t>(numComponents);
+
+    if (numComponents == 0)
+        return projection;
+
+    const auto& mean = projection._mean;
+
+    // Random Gaussian directions in the input space
+    std::vector<float> directions(numDimensions * width);
+    {
+        std::mt19937 generator(parameters.seed);
+        std::normal_distribution<float> normal;
+
+        for (auto& value : directions)
+            value = normal(generator);
+    }
+
+    // Range of the centered data: rangeBasis = orthonormalize((X - mean) * directions)
+    std::vector<float> rangeBasis(static_cast<std::size_t>(numPoints) * width);
+
+    const auto multiply = [&](const std::vector<float>& weights) {
+        data.forEachBlock(blockSize, [&](std::uint32_t begin, std::uint32_t count, const float* block) {
+            multiplyBlock(block, begin, count, numDimensions, mean, weights, width, rangeBasis.data());
+            });
+        orthonormalize(rangeBasis, numPoints, width);
+    };
+
+    const auto multiplyTransposed = [&]() {
+        std::fill(directions.begin(), directions.end(), 0.f);
+        data.forEachBlock(blockSize, [&](std::uint32_t begin, std::uint32_t count, const float* block) {
+            multiplyTransposedBlock(block, begin, count, numDimensions, mean, rangeBasis, width, directions);
+            });
+    };
+
+    multiply(directions);
+
+    // Power iterations amplify the gap between the leading components and the rest
+    for (std::uint32_t iteration = 0; iteration < parameters.numPowerIterations; iteration++)
+    {
+        multiplyTransposed();
+        orthonormalize(directions, numDimensions, width);
+        multiply(directions);
+    }
+
+    // The data in the range basis: B = rangeBasis^T (X - mean), held transposed in directions
+    multiplyTransposed();
+
+    // B B^T = U S^2 U^T, the right singular vectors of the data are B^T U S^-1
+    std::vector<double> values, vectors;
+    symmetricEigen(gramMatrix(directions, numDimensions, width), width, values, vectors);
+
+    projection._components.assign(numDimensions * numComponents, 0.f);
+    projection._explainedVariance.resize(numComponents);
+
+    for (std::size_t c = 0; c < numComponents; c++)
+    {
+        const double squaredSingularValue = std::max(values[c], 0.);
+
+        projection._explainedVariance[c] = numPoints > 1 ? static_cast<float>(squaredSingularValue / (numPoints - 1)) : 0.f;
+
+        if (squaredSingularValue <= 0.)
+            continue;
+
+        const double scale = 1. / std::sqrt(squaredSingularValue);
+
+#pragma omp parallel for schedule(static)
+        for (std::int64_t d = 0; d < static_cast<std::int64_t>(numDimensions); d++)
+        {
+            double component = 0.;
+
+            for (std::size_t j = 0; j < width; j++)
+                component += directions[d * width + j] * vectors[j * width + c];
+
+            projection._components[d * numComponents + c] = static_cast<float>(component * scale);
+        }
+    }
+
+    return projection;
+}
+
+std::vector<float> PcaProjection::project(const DataProvider& data) const
+{
+    assert(data.getNumDimensions() == getNumInputDimensions());
+
+    const std::size_t numDimensions = data.getNumDimensions();
+
+    std::vector<float> projected(static_cast<std::size_t>(data.getNumPoints()) * _numComponents);
+
+    if (_numComponents == 0)
+        return projected;
+
+    data.forEachBlock(blockSizeFor(data.getNumDimensions()), [this, &projected, numDimensions](std::uint32_t begin, std::uint32_t count, const float* block) {
+        multiplyBlock(block, begin, count, numDimensions, _mean, _components, _numComponents, projected.data());
+        });
+
+    return projected;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "DataProvider.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * PcaProjection
+ *
+ * Projection of high-dimensional data onto its first principal components, used to reduce the
+ * input of the kNN search. The components are found with a randomized SVD (Halko, Martinsson and Tropp):
+ * the centered data is multiplied with a random Gaussian matrix of a few more columns than components,
+ * refined with power iterations and the small remaining problem is solved exactly.
+ *
+ * The data is only read block-wise, in a fixed number of passes, and never copied as a whole.
+ * Every pass distributes its block over the OpenMP threads. With a fixed seed the projection
+ * of the same data is the same, so results that depend on it, e.g. a kNN index, stay valid.
+ */
+class PcaProjection
+{
+public:
+    /** Randomized SVD settings */
+    struct Parameters
+    {
+        std::uint32_t   numComponents = 50;         /** Number of principal components */
+        std::uint32_t   oversampling = 10;          /** Additional random directions, improve the accuracy of the last components */
+        std::uint32_t   numPowerIterations = 2;     /** Passes that separate components of similar variance, two passes each */
+        std::uint32_t   seed = 0;                   /** Seed of the random directions */
+    };
+
+public:
+    PcaProjection() = default;
+
+    /**
+     * Principal components of the data, at most as many as it has points and dimensions
+     * @param data Input points, read in blocks
+     * @param parameters Number of components and randomized SVD settings
+     */
+    static PcaProjection fit(const DataProvider& data, const Parameters& parameters);
+
+    /** Coordinates of the points of data (with getNumInputDimensions() dimensions) in the components, row-major */
+    std::vector<float> project(const DataProvider& data) const;
+
+    std::uint32_t getNumInputDimensions() const { return static_cast<std::uint32_t>(_mean.size()); }
+    std::uint32_t getNumComponents() const { return _numComponents; }
+
+    /** Mean of every input dimension */
+    const std::vector<float>& getMean() const { return _mean; }
+
+    /** Unit length components as columns, row-major with getNumComponents() values per input dimension */
+    const std::vector<float>& getComponents() const { return _components; }
+
+    /** Variance of the data along every component, descending */
+    const std::vector<float>& getExplainedVariance() const { return _explainedVariance; }
+
+private:
+    std::uint32_t       _numComponents = 0;     /** Number of components */
+    std::vector<float>  _mean;                  /** Mean of the input */
+    std::vector<float>  _components;            /** Input dimensions x components */
+    std::vector<float>  _explainedVariance;     /** Variance per component */
+};
+
+/**
+ * ProjectedData
+ *
+ * A PCA projection together with the projected points of the data it was fitted to, kept
+ * so that another kNN search on the same data does not repeat the projection
+ */
+struct ProjectedData
+{
+    PcaProjection                               projection;     /** Mean and components */
+    std::shared_ptr<const VectorDataProvider>   data;           /** Projected points */
+    std::uint32_t                               numComponents;  /** Requested number of components, the projection may have fewer */
+};
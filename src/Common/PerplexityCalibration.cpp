@@ -0,0 +1,114 @@
+#include "PerplexityCalibration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr int maxIterations = 200;
+    constexpr double tolerance = 1e-5;
+
+    /**
+     * Binary search for the precision beta of exp(-beta * d), writes the normalized probabilities
+     * Distances are shifted by their minimum, which does not change the distribution but keeps exp() finite for negative distances (dot product)
+     */
+    void calibrateRow(const float* distances, std::uint32_t numNeighbors, double targetEntropy, double* probabilities)
+    {
+        const double minDistance = *std::min_element(distances, distances + numNeighbors);
+
+        double beta = 1.0;
+        double betaMin = -std::numeric_limits<double>::max();
+        double betaMax = std::numeric_limits<double>::max();
+        double sum = 0.0;
+
+        for (int iteration = 0; iteration < maxIterations; iteration++)
+        {
+            sum = 0.0;
+            double weightedDistances = 0.0;
+
+            for (std::uint32_t k = 0; k < numNeighbors; k++)
+            {
+                const double d = distances[k] - minDistance;
+                probabilities[k] = std::exp(-beta * d);
+                sum += probabilities[k];
+                weightedDistances += d * probabilities[k];
+            }
+
+            // Shannon entropy of the normalized distribution
+            const double entropy = std::log(sum) + beta * weightedDistances / sum;
+            const double difference = entropy - targetEntropy;
+
+            if (std::abs(difference) < tolerance)
+                break;
+
+            if (difference > 0)
+            {
+                betaMin = beta;
+                beta = betaMax == std::numeric_limits<double>::max() ? beta * 2 : (beta + betaMax) / 2;
+            }
+            else
+            {
+                betaMax = beta;
+                beta = betaMin == -std::numeric_limits<double>::max() ? beta / 2 : (beta + betaMin) / 2;
+            }
+        }
+
+        for (std::uint32_t k = 0; k < numNeighbors; k++)
+            probabilities[k] /= sum;
+    }
+}
+
+SparseMatrix computeConditionalProbabilities(const KnnGraph& knnGraph, float perplexity)
+{
+    const std::uint32_t numPoints = knnGraph.getNumPoints();
+    const std::uint32_t numNeighbors = knnGraph.getNumNeighbors();
+    const double targetEntropy = std::log(static_cast<double>(perplexity));
+
+    // Every row has numNeighbors entries
+    std::vector<std::uint64_t> rowOffsets(static_cast<std::size_t>(numPoints) + 1);
+
+    for (std::uint32_t i = 0; i <= numPoints; i++)
+        rowOffsets[i] = static_cast<std::uint64_t>(i) * numNeighbors;
+
+    std::vector<std::uint32_t> columns(rowOffsets.back());
+    std::vector<float> values(rowOffsets.back());
+
+    if (numNeighbors == 0)
+        return SparseMatrix(std::move(rowOffsets), std::move(columns), std::move(values));
+
+#pragma omp parallel
+    {
+        std::vector<double> probabilities(numNeighbors);
+        std::vector<std::pair<std::uint32_t, float>> entries(numNeighbors);
+
+#pragma omp for schedule(dynamic, 1024)
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(numPoints); i++)
+        {
+            const auto point = static_cast<std::uint32_t>(i);
+
+            calibrateRow(knnGraph.distances(point), numNeighbors, targetEntropy, probabilities.data());
+
+            // CSR rows are sorted by column, the neighbors by distance
+            const std::uint32_t* neighbors = knnGraph.neighbors(point);
+
+            for (std::uint32_t k = 0; k < numNeighbors; k++)
+                entries[k] = { neighbors[k], static_cast<float>(probabilities[k]) };
+
+            std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            const std::uint64_t offset = rowOffsets[point];
+
+            for (std::uint32_t k = 0; k < numNeighbors; k++)
+            {
+                columns[offset + k] = entries[k].first;
+                values[offset + k] = entries[k].second;
+            }
+        }
+    }
+
+    return SparseMatrix(std::move(rowOffsets), std::move(columns), std::move(values));
+}
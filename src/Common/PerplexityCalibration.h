@@ -0,0 +1,17 @@
+#pragma once
+
+#include "KnnGraph.h"
+#include "SparseMatrix.h"
+
+/**
+ * Gaussian conditional probabilities p_j|i over the neighbors j of every point i
+ *
+ * The bandwidth of every point is found by a binary search, such that the perplexity of
+ * its distribution matches the requested one (as HDILib does for its kNN libraries).
+ * Every row of the result sums to 1: it is the transition matrix HSNE expects,
+ * t-SNE's joint distribution is its symmetrized() version.
+ *
+ * @param knnGraph Neighbors and distances, e.g. from computeBruteForceKnn
+ * @param perplexity Target perplexity, should be smaller than the number of neighbors
+ */
+SparseMatrix computeConditionalProbabilities(const KnnGraph& knnGraph, float perplexity);
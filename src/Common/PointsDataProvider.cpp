@@ -0,0 +1,88 @@
+#include "PointsDataProvider.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <span>
+#include <type_traits>
+
+PointsDataProvider::PointsDataProvider(const mv::Dataset<Points>& points, const std::vector<bool>& enabledDimensions) :
+    _points(points),
+    _dimensionIndices(),
+    _pointIndices(),
+    _numPoints(0),
+    _contiguousData(nullptr)
+{
+    assert(_points.isValid());
+    assert(enabledDimensions.size() == _points->getNumDimensions());
+
+    for (unsigned int i = 0; i < _points->getNumDimensions(); i++)
+        if (enabledDimensions[i])
+            _dimensionIndices.push_back(i);
+
+    if (_points->isFull())
+    {
+        _numPoints = _points->getNumPoints();
+    }
+    else
+    {
+        _pointIndices = _points->indices;
+        _numPoints = static_cast<std::uint32_t>(_pointIndices.size());
+    }
+
+    // Use the dataset's own storage if it has exactly the layout we provide
+    if (_points->isFull() && !_points->isDerivedData() && _dimensionIndices.size() == _points->getNumDimensions())
+    {
+        _points->constVisitFromBeginToEnd([this](auto beginOfData, auto endOfData) -> void {
+            using ValueType = std::decay_t<decltype(*beginOfData)>;
+
+            if constexpr (std::is_same_v<ValueType, float>)
+                if (beginOfData != endOfData)
+                    _contiguousData = &*beginOfData;
+            });
+    }
+}
+
+void PointsDataProvider::readBlock(std::uint32_t begin, std::uint32_t count, float* out) const
+{
+    assert(begin + count <= _numPoints);
+
+    // The dataset writes into the caller's buffer through a non-owning view, without a temporary block
+    std::span<float> block(out, static_cast<std::size_t>(count) * _dimensionIndices.size());
+
+    if (_pointIndices.empty())
+    {
+        std::vector<unsigned int> blockIndices(count);
+        std::iota(blockIndices.begin(), blockIndices.end(), begin);
+
+        _points->populateDataForDimensions<std::span<float>, std::vector<unsigned int>, std::vector<unsigned int>>(block, _dimensionIndices, blockIndices);
+    }
+    else
+    {
+        const std::span<const unsigned int> blockIndices(_pointIndices.data() + begin, count);
+
+        _points->populateDataForDimensions<std::span<float>, std::vector<unsigned int>, std::span<const unsigned int>>(block, _dimensionIndices, blockIndices);
+    }
+}
+
+void PointsDataProvider::readPoints(const std::uint32_t* indices, std::uint32_t count, float* out) const
+{
+    if (_contiguousData != nullptr)
+    {
+        DataProvider::readPoints(indices, count, out);
+        return;
+    }
+
+    // One request for all points instead of one per point
+    std::vector<unsigned int> pointIndices(count);
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        assert(indices[i] < _numPoints);
+        pointIndices[i] = _pointIndices.empty() ? indices[i] : _pointIndices[indices[i]];
+    }
+
+    std::span<float> points(out, static_cast<std::size_t>(count) * _dimensionIndices.size());
+
+    _points->populateDataForDimensions<std::span<float>, std::vector<unsigned int>, std::vector<unsigned int>>(points, _dimensionIndices, pointIndices);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "DataProvider.h"
+
+#include <PointData/PointData.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * PointsDataProvider
+ *
+ * Provides the enabled dimensions of a points dataset block-wise, without a dense copy.
+ * If the dataset is a full, non-derived float dataset and all dimensions are enabled,
+ * its storage is used directly (zero-copy). The dataset must not change while the provider is used.
+ */
+class PointsDataProvider : public DataProvider
+{
+public:
+    PointsDataProvider(const mv::Dataset<Points>& points, const std::vector<bool>& enabledDimensions);
+
+    std::uint32_t getNumPoints() const override { return _numPoints; }
+    std::uint32_t getNumDimensions() const override { return static_cast<std::uint32_t>(_dimensionIndices.size()); }
+
+    const float* getContiguousData() const override { return _contiguousData; }
+
+    void readBlock(std::uint32_t begin, std::uint32_t count, float* out) const override;
+    void readPoints(const std::uint32_t* indices, std::uint32_t count, float* out) const override;
+
+private:
+    mv::Dataset<Points>         _points;            /** Input dataset */
+    std::vector<unsigned int>   _dimensionIndices;  /** Enabled dimensions */
+    std::vector<unsigned int>   _pointIndices;      /** Indices into the full data of a subset, empty for full datasets */
+    std::uint32_t               _numPoints;         /** Number of provided points */
+    const float*                _contiguousData;    /** Storage of the dataset if it can be used directly */
+};
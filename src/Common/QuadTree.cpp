@@ -0,0 +1,369 @@
+#include "QuadTree.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr std::uint32_t kLeafSize   = 8;    // Nodes with at most this many points are not subdivided
+    constexpr std::uint32_t kMaxDepth   = 16;   // 16 bits per axis in the 32 bit Morton codes
+    constexpr int           kStackSize  = 64;   // 3 * (kMaxDepth + 1) + 1 rounded up
+
+    constexpr std::uint32_t kNoPoint    = std::numeric_limits<std::uint32_t>::max();   // Query positions that are not points of the tree
+
+    // Spread the lower 16 bits of v such that there is a zero bit between every two bits
+    inline std::uint32_t spreadBits(std::uint32_t v)
+    {
+        v &= 0x0000FFFF;
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    std::int64_t numBlocksFor(std::int64_t numElements, std::int64_t minBlockSize)
+    {
+        return std::max<std::int64_t>(1, std::min<std::int64_t>(numParallelThreads() * 4, numElements / minBlockSize));
+    }
+}
+
+void QuadTree::sortByMortonCode(const float* positions, std::uint32_t numPoints)
+{
+    const std::int64_t n = numPoints;
+    const std::int64_t numBlocks = numBlocksFor(n, 16384);
+    const std::int64_t blockSize = (n + numBlocks - 1) / numBlocks;
+
+    // Bounding box, per block since OpenMP 2.0 has no min/max reductions
+    std::vector<std::array<float, 4>> blockBounds(numBlocks, { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() });
+
+#pragma omp parallel for
+    for (std::int64_t block = 0; block < numBlocks; block++)
+    {
+        auto& bounds = blockBounds[block];
+
+        for (std::int64_t i = block * blockSize; i < std::min(n, (block + 1) * blockSize); i++)
+        {
+            bounds[0] = std::min(bounds[0], positions[2 * i]);
+            bounds[1] = std::min(bounds[1], positions[2 * i + 1]);
+            bounds[2] = std::max(bounds[2], positions[2 * i]);
+            bounds[3] = std::max(bounds[3], positions[2 * i + 1]);
+        }
+    }
+
+    float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest(), maxY = std::numeric_limits<float>::lowest();
+
+    for (const auto& bounds : blockBounds)
+    {
+        minX = std::min(minX, bounds[0]);
+        minY = std::min(minY, bounds[1]);
+        maxX = std::max(maxX, bounds[2]);
+        maxY = std::max(maxY, bounds[3]);
+    }
+
+    // Square root cell, slightly enlarged so that the maximum maps inside the grid
+    const float side = std::max({ maxX - minX, maxY - minY, std::numeric_limits<float>::min() }) * 1.0001f;
+    const float scale = 65536.f / side;
+
+    std::vector<std::uint32_t> codes(n), order(n);
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < n; i++)
+    {
+        const auto qx = static_cast<std::uint32_t>(std::min(65535.f, (positions[2 * i] - minX) * scale));
+        const auto qy = static_cast<std::uint32_t>(std::min(65535.f, (positions[2 * i + 1] - minY) * scale));
+
+        codes[i] = (spreadBits(qy) << 1) | spreadBits(qx);
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    // Parallel LSD radix sort, 8 bits per pass, stable since blocks are scattered in order
+    std::vector<std::uint32_t> codesOut(n), orderOut(n);
+    std::vector<std::array<std::uint64_t, 256>> histograms(numBlocks);
+
+    for (int pass = 0; pass < 4; pass++)
+    {
+        const int shift = 8 * pass;
+
+#pragma omp parallel for
+        for (std::int64_t block = 0; block < numBlocks; block++)
+        {
+            auto& histogram = histograms[block];
+            histogram.fill(0);
+
+            for (std::int64_t i = block * blockSize; i < std::min(n, (block + 1) * blockSize); i++)
+                histogram[(codes[i] >> shift) & 0xFF]++;
+        }
+
+        std::uint64_t running = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            for (std::int64_t block = 0; block < numBlocks; block++)
+            {
+                const auto count = histograms[block][digit];
+                histograms[block][digit] = running;
+                running += count;
+            }
+        }
+
+#pragma omp parallel for
+        for (std::int64_t block = 0; block < numBlocks; block++)
+        {
+            auto& histogram = histograms[block];
+
+            for (std::int64_t i = block * blockSize; i < std::min(n, (block + 1) * blockSize); i++)
+            {
+                const auto target = histogram[(codes[i] >> shift) & 0xFF]++;
+                codesOut[target] = codes[i];
+                orderOut[target] = order[i];
+            }
+        }
+
+        codes.swap(codesOut);
+        order.swap(orderOut);
+    }
+
+    _codes = std::move(codes);
+    _order = std::move(order);
+
+    _sortedX.resize(n);
+    _sortedY.resize(n);
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < n; i++)
+    {
+        _sortedX[i] = positions[2 * _order[i]];
+        _sortedY[i] = positions[2 * _order[i] + 1];
+    }
+
+    _nodes.clear();
+    _nodes.push_back({ 0, numPoints, 0, 0, 0.f, 0.f, side });
+}
+
+void QuadTree::build(const float* positions, std::uint32_t numPoints)
+{
+    assert(numPoints > 0);
+
+    sortByMortonCode(positions, numPoints);
+
+    // Prefix sums of the sorted positions give the center of mass of any node in constant time
+    std::vector<double> prefixX(numPoints + 1, 0.), prefixY(numPoints + 1, 0.);
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < static_cast<std::int64_t>(numPoints); i++)
+    {
+        prefixX[i] = _sortedX[i];
+        prefixY[i] = _sortedY[i];
+    }
+
+    exclusiveScan(prefixX);
+    exclusiveScan(prefixY);
+
+    const auto setCenterOfMass = [&prefixX, &prefixY](Node& node) -> void {
+        const double count = node.end - node.begin;
+        node.centerX = static_cast<float>((prefixX[node.end] - prefixX[node.begin]) / count);
+        node.centerY = static_cast<float>((prefixY[node.end] - prefixY[node.begin]) / count);
+    };
+
+    setCenterOfMass(_nodes[0]);
+
+    // Subdivide level by level, all nodes of a level in parallel
+    std::size_t levelBegin = 0;
+    std::size_t levelEnd = 1;
+
+    for (std::uint32_t level = 0; levelBegin < levelEnd; level++)
+    {
+        const std::int64_t numLevelNodes = static_cast<std::int64_t>(levelEnd - levelBegin);
+        const std::uint32_t shift = 30 - 2 * std::min(level, kMaxDepth - 1);
+
+        std::vector<std::array<std::uint32_t, 5>> childBounds(numLevelNodes);
+        std::vector<std::uint64_t> childOffsets(numLevelNodes + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 256)
+        for (std::int64_t n = 0; n < numLevelNodes; n++)
+        {
+            const Node& node = _nodes[levelBegin + n];
+
+            if (node.end - node.begin <= kLeafSize || level >= kMaxDepth)
+                continue;
+
+            // Within a node all codes share the prefix, so the children are the runs of the next digit
+            auto& bounds = childBounds[n];
+            bounds[0] = node.begin;
+            bounds[4] = node.end;
+
+            for (std::uint32_t digit = 1; digit < 4; digit++)
+            {
+                const auto it = std::partition_point(_codes.begin() + node.begin, _codes.begin() + node.end, [shift, digit](std::uint32_t code) {
+                    return ((code >> shift) & 3u) < digit;
+                    });
+
+                bounds[digit] = static_cast<std::uint32_t>(it - _codes.begin());
+            }
+
+            std::uint64_t numChildren = 0;
+            for (int digit = 0; digit < 4; digit++)
+                numChildren += bounds[digit + 1] > bounds[digit] ? 1 : 0;
+
+            childOffsets[n] = numChildren;
+        }
+
+        const std::uint64_t numChildren = exclusiveScan(childOffsets);
+        const std::size_t childBase = _nodes.size();
+
+        _nodes.resize(childBase + numChildren);
+
+#pragma omp parallel for schedule(dynamic, 256)
+        for (std::int64_t n = 0; n < numLevelNodes; n++)
+        {
+            const std::uint32_t numNodeChildren = static_cast<std::uint32_t>(childOffsets[n + 1] - childOffsets[n]);
+
+            if (numNodeChildren == 0)
+                continue;
+
+            Node& node = _nodes[levelBegin + n];
+            node.firstChild = static_cast<std::uint32_t>(childBase + childOffsets[n]);
+            node.numChildren = numNodeChildren;
+
+            const auto& bounds = childBounds[n];
+            std::uint32_t child = node.firstChild;
+
+            for (int digit = 0; digit < 4; digit++)
+            {
+                if (bounds[digit + 1] == bounds[digit])
+                    continue;
+
+                Node& childNode = _nodes[child++];
+                childNode = { bounds[digit], bounds[digit + 1], 0, 0, 0.f, 0.f, 0.5f * node.width };
+                setCenterOfMass(childNode);
+            }
+        }
+
+        levelBegin = levelEnd;
+        levelEnd = _nodes.size();
+    }
+}
+
+void QuadTree::computeRepulsion(float x, float y, float theta, float& forceX, float& forceY, double& sumQ) const
+{
+    accumulateRepulsion(x, y, kNoPoint, theta, forceX, forceY, sumQ);
+}
+
+void QuadTree::computeRepulsionOnPoint(std::uint32_t sortedIndex, float theta, float& forceX, float& forceY, double& sumQ) const
+{
+    assert(sortedIndex < _sortedX.size());
+
+    accumulateRepulsion(_sortedX[sortedIndex], _sortedY[sortedIndex], sortedIndex, theta, forceX, forceY, sumQ);
+}
+
+void QuadTree::accumulateRepulsion(float x, float y, std::uint32_t sortedIndex, float theta, float& forceX, float& forceY, double& sumQ) const
+{
+    const float theta2 = theta * theta;
+
+    std::uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+
+    float fx = 0.f, fy = 0.f;
+    double q = 0.;
+
+    while (top > 0)
+    {
+        const Node& node = _nodes[stack[--top]];
+        const bool containsQuery = sortedIndex >= node.begin && sortedIndex < node.end;
+
+        float dx = x - node.centerX;
+        float dy = y - node.centerY;
+        float d2 = dx * dx + dy * dy;
+
+        if (node.numChildren == 0)
+        {
+            // Exact interaction with all points in the leaf
+            float leafX = 0.f, leafY = 0.f, leafQ = 0.f;
+
+            SNE_OMP_SIMD_REDUCTION(+:leafX, leafY, leafQ)
+            for (std::uint32_t k = node.begin; k < node.end; k++)
+            {
+                const float ex = x - _sortedX[k];
+                const float ey = y - _sortedY[k];
+                const float qk = 1.f / (1.f + ex * ex + ey * ey);
+                const float q2 = qk * qk;
+
+                leafQ += qk;
+                leafX += q2 * ex;
+                leafY += q2 * ey;
+            }
+
+            // The query's own term is exactly q = 1 without force
+            if (containsQuery)
+                leafQ -= 1.f;
+
+            fx += leafX;
+            fy += leafY;
+            q += leafQ;
+        }
+        else if (node.width * node.width < theta2 * d2)
+        {
+            // Far enough away: summarize the cell by its center of mass
+            float count = static_cast<float>(node.end - node.begin);
+
+            // At large theta the query's own cell can be summarized, its center of mass then excludes the query
+            if (containsQuery)
+            {
+                dx = x - (count * node.centerX - x) / (count - 1.f);
+                dy = y - (count * node.centerY - y) / (count - 1.f);
+                d2 = dx * dx + dy * dy;
+                count -= 1.f;
+            }
+
+            const float qn = 1.f / (1.f + d2);
+            const float mult = count * qn * qn;
+
+            q += count * qn;
+            fx += mult * dx;
+            fy += mult * dy;
+        }
+        else
+        {
+            assert(top + static_cast<int>(node.numChildren) <= kStackSize);
+
+            for (std::uint32_t c = 0; c < node.numChildren; c++)
+                stack[top++] = node.firstChild + c;
+        }
+    }
+
+    forceX += fx;
+    forceY += fy;
+    sumQ += q;
+}
+
+double QuadTree::computeRepulsiveForces(const float* positions, std::uint32_t numPoints, float theta, float* forces)
+{
+    build(positions, numPoints);
+
+    double sumQ = 0.;
+
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:sumQ)
+    for (std::int64_t k = 0; k < static_cast<std::int64_t>(numPoints); k++)
+    {
+        const std::uint32_t i = _order[k];
+
+        float forceX = 0.f, forceY = 0.f;
+        double q = 0.;
+
+        computeRepulsionOnPoint(static_cast<std::uint32_t>(k), theta, forceX, forceY, q);
+
+        forces[2ull * i]     = forceX;
+        forces[2ull * i + 1] = forceY;
+
+        sumQ += q;
+    }
+
+    return sumQ;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * QuadTree
+ *
+ * Barnes-Hut space partitioning of a 2D embedding.
+ * Points are sorted along a Morton (Z-order) curve, every node covers a contiguous
+ * range of the sorted points, which makes the construction parallel level by level
+ * and keeps the leaf loops cache friendly.
+ */
+class QuadTree
+{
+public:
+    struct Node
+    {
+        std::uint32_t   begin;          /** First point (in sorted order) covered by this node */
+        std::uint32_t   end;            /** One past the last point covered by this node */
+        std::uint32_t   firstChild;     /** Index of the first child node, children are stored consecutively */
+        std::uint32_t   numChildren;    /** Zero for leaves */
+        float           centerX;        /** Center of mass */
+        float           centerY;        /** Center of mass */
+        float           width;          /** Side length of the (square) cell */
+    };
+
+public:
+    /**
+     * Build the tree
+     * @param positions Interleaved xy positions
+     * @param numPoints Number of points
+     */
+    void build(const float* positions, std::uint32_t numPoints);
+
+    /**
+     * Accumulate the t-SNE repulsive force of all points in the tree on the position (x, y)
+     * Adds sum_j q_ij^2 (y_i - y_j) to forceX/forceY and sum_j q_ij to sumQ, with q_ij = 1 / (1 + |y_i - y_j|^2)
+     * A point at (x, y) itself contributes q = 1 and no force
+     * @param theta Barnes-Hut accuracy, cells with width / distance < theta are approximated by their center of mass
+     */
+    void computeRepulsion(float x, float y, float theta, float& forceX, float& forceY, double& sumQ) const;
+
+    /**
+     * Accumulate the repulsive force of all other points in the tree on one of its points, like computeRepulsion
+     * The point does not interact with itself, also not when its cell is summarized by the center of mass
+     * @param sortedIndex Index of the point in getOrder()
+     */
+    void computeRepulsionOnPoint(std::uint32_t sortedIndex, float theta, float& forceX, float& forceY, double& sumQ) const;
+
+    /**
+     * Build the tree and compute the repulsive forces on all points in parallel, in Morton order
+     * @param forces Output, interleaved xy forces
+     * @return Normalization sum_{i != j} q_ij
+     */
+    double computeRepulsiveForces(const float* positions, std::uint32_t numPoints, float theta, float* forces);
+
+public: // Getter
+    std::uint32_t getNumPoints() const { return static_cast<std::uint32_t>(_order.size()); }
+
+    /** Point indices in Morton order, iterating in this order improves traversal locality */
+    const std::vector<std::uint32_t>& getOrder() const { return _order; }
+
+    const std::vector<Node>& getNodes() const { return _nodes; }
+
+private:
+    void sortByMortonCode(const float* positions, std::uint32_t numPoints);
+
+    /** Repulsion on (x, y), excluding the point at sortedIndex if it is one of the points of the tree */
+    void accumulateRepulsion(float x, float y, std::uint32_t sortedIndex, float theta, float& forceX, float& forceY, double& sumQ) const;
+
+private:
+    std::vector<Node>           _nodes;         /** Breadth-first node storage, root at index 0 */
+    std::vector<std::uint32_t>  _order;         /** Point indices sorted by Morton code */
+    std::vector<std::uint32_t>  _codes;         /** Sorted Morton codes */
+    std::vector<float>          _sortedX;       /** X positions in sorted order */
+    std::vector<float>          _sortedY;       /** Y positions in sorted order */
+};
@@ -0,0 +1,171 @@
+#include "QuantizedData.h"
+
+#include "MetricDistance.h"
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr std::uint32_t encodeBlockSize = 16384;   /** Points per block read from the data provider */
+}
+
+QuantizedData::QuantizedData(const DataProvider& data, KnnPrecision precision) :
+    _numPoints(data.getNumPoints()),
+    _numDimensions(data.getNumDimensions()),
+    _precision(precision),
+    _halfData(),
+    _byteData(),
+    _scales(),
+    _offsets()
+{
+    assert(precision != KnnPrecision::Float32);
+
+    const std::size_t numDimensions = _numDimensions;
+
+    if (precision == KnnPrecision::Float16)
+    {
+        _halfData.resize(static_cast<std::size_t>(_numPoints) * numDimensions);
+
+        data.forEachBlock(encodeBlockSize, [this, numDimensions](std::uint32_t begin, std::uint32_t count, const float* block) {
+            const std::int64_t numValues = static_cast<std::int64_t>(count * numDimensions);
+            std::uint16_t* out = _halfData.data() + begin * numDimensions;
+
+#pragma omp parallel for
+            for (std::int64_t i = 0; i < numValues; i++)
+                out[i] = distance::floatToHalf(block[i]);
+            });
+
+        return;
+    }
+
+    // First pass: range of every dimension, threads keep their own ranges of a block
+    std::vector<float> minima(numDimensions, std::numeric_limits<float>::max());
+    std::vector<float> maxima(numDimensions, std::numeric_limits<float>::lowest());
+
+    data.forEachBlock(encodeBlockSize, [&minima, &maxima, numDimensions](std::uint32_t, std::uint32_t count, const float* block) {
+#pragma omp parallel
+        {
+            std::vector<float> threadMinima(minima), threadMaxima(maxima);
+
+#pragma omp for
+            for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+            {
+                const float* point = block + i * numDimensions;
+
+                for (std::size_t d = 0; d < numDimensions; d++)
+                {
+                    threadMinima[d] = std::min(threadMinima[d], point[d]);
+                    threadMaxima[d] = std::max(threadMaxima[d], point[d]);
+                }
+            }
+
+#pragma omp critical
+            for (std::size_t d = 0; d < numDimensions; d++)
+            {
+                minima[d] = std::min(minima[d], threadMinima[d]);
+                maxima[d] = std::max(maxima[d], threadMaxima[d]);
+            }
+        }
+        });
+
+    _offsets.resize(numDimensions);
+    _scales.resize(numDimensions);
+
+    std::vector<float> inverseScales(numDimensions);
+
+    for (std::size_t d = 0; d < numDimensions; d++)
+    {
+        // Constant dimensions are encoded as 0 with step 0
+        const float range = _numPoints > 0 ? maxima[d] - minima[d] : 0.f;
+
+        _offsets[d]         = _numPoints > 0 ? minima[d] : 0.f;
+        _scales[d]          = range / 255.f;
+        inverseScales[d]    = range > 0.f ? 255.f / range : 0.f;
+    }
+
+    // Second pass: round to the nearest code
+    _byteData.resize(static_cast<std::size_t>(_numPoints) * numDimensions);
+
+    data.forEachBlock(encodeBlockSize, [this, &inverseScales, numDimensions](std::uint32_t begin, std::uint32_t count, const float* block) {
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+        {
+            const float* point = block + i * numDimensions;
+            std::uint8_t* codes = _byteData.data() + (begin + i) * numDimensions;
+
+            for (std::size_t d = 0; d < numDimensions; d++)
+                codes[d] = static_cast<std::uint8_t>(std::clamp((point[d] - _offsets[d]) * inverseScales[d] + .5f, 0.f, 255.f));
+        }
+        });
+}
+
+void QuantizedData::decode(std::uint32_t index, float* out) const
+{
+    if (_precision == KnnPrecision::Float16)
+    {
+        const std::uint16_t* values = halfPoint(index);
+
+        for (std::uint32_t d = 0; d < _numDimensions; d++)
+            out[d] = distance::halfToFloat(values[d]);
+    }
+    else
+    {
+        const std::uint8_t* codes = bytePoint(index);
+
+        for (std::uint32_t d = 0; d < _numDimensions; d++)
+            out[d] = _offsets[d] + _scales[d] * codes[d];
+    }
+}
+
+QuantizedDistance::QuantizedDistance(const QuantizedData& data, hdi::dr::knn_distance_metric metric) :
+    _data(data),
+    _metric(metric),
+    _halfKernel(distance::getHalfKernel(MetricDistance::kernelFor(metric))),
+    _byteKernel(distance::getByteKernel(MetricDistance::kernelFor(metric))),
+    _inverseNorms()
+{
+    if (metric != hdi::dr::knn_distance_metric::KNN_METRIC_COSINE)
+        return;
+
+    _inverseNorms.resize(data.getNumPoints());
+
+    const auto dotProduct = distance::getKernel(distance::Kernel::DotProduct);
+
+#pragma omp parallel
+    {
+        std::vector<float> point(data.getNumDimensions());
+
+#pragma omp for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(data.getNumPoints()); i++)
+        {
+            data.decode(static_cast<std::uint32_t>(i), point.data());
+
+            const float norm = std::sqrt(dotProduct(point.data(), point.data(), data.getNumDimensions()));
+            _inverseNorms[i] = norm > 0.f ? 1.f / norm : 0.f;
+        }
+    }
+}
+
+void QuantizedDistance::operator()(std::uint32_t query, std::uint32_t referenceBegin, std::uint32_t referenceEnd, float* out) const
+{
+    const std::uint32_t numDimensions = _data.getNumDimensions();
+    const bool cosine = _metric == hdi::dr::knn_distance_metric::KNN_METRIC_COSINE;
+
+    thread_local std::vector<float> queryPoint;
+
+    queryPoint.resize(numDimensions);
+    _data.decode(query, queryPoint.data());
+
+    for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+    {
+        const float value = _data.getPrecision() == KnnPrecision::Float16 ?
+            _halfKernel(queryPoint.data(), _data.halfPoint(reference), numDimensions) :
+            _byteKernel(queryPoint.data(), _data.bytePoint(reference), _data.getScales().data(), _data.getOffsets().data(), numDimensions);
+
+        out[reference - referenceBegin] = MetricDistance::fromKernelValue(_metric, value, cosine ? _inverseNorms[query] * _inverseNorms[reference] : 1.f);
+    }
+}
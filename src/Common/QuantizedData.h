@@ -0,0 +1,80 @@
+#pragma once
+
+#include "DataProvider.h"
+#include "DistanceKernels.h"
+#include "KnnParameters.h"
+
+#include "hdi/dimensionality_reduction/knn_utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * QuantizedData
+ *
+ * Dense copy of a dataset with reduced precision for the brute-force kNN search: half precision
+ * floats (2 bytes per value) or bytes that are scaled to the range of every dimension (1 byte per value).
+ * Distances between quantized points are approximate, the search re-ranks its candidates with the
+ * full precision data, see computeBruteForceKnn.
+ */
+class QuantizedData
+{
+public:
+    /**
+     * Encode the data, which is read in blocks, int8 needs two passes
+     * @param precision Float16 or Int8
+     */
+    QuantizedData(const DataProvider& data, KnnPrecision precision);
+
+    std::uint32_t getNumPoints() const { return _numPoints; }
+    std::uint32_t getNumDimensions() const { return _numDimensions; }
+    KnnPrecision getPrecision() const { return _precision; }
+
+    /** Size of the encoded data in bytes */
+    std::size_t getMemoryUsage() const { return _halfData.size() * sizeof(std::uint16_t) + _byteData.size() + (_scales.size() + _offsets.size()) * sizeof(float); }
+
+    /** Float16 only: values of the point */
+    const std::uint16_t* halfPoint(std::uint32_t index) const { return _halfData.data() + static_cast<std::size_t>(index) * _numDimensions; }
+
+    /** Int8 only: codes of the point, value i is getOffsets()[i] + getScales()[i] * code */
+    const std::uint8_t* bytePoint(std::uint32_t index) const { return _byteData.data() + static_cast<std::size_t>(index) * _numDimensions; }
+
+    const std::vector<float>& getScales() const { return _scales; }
+    const std::vector<float>& getOffsets() const { return _offsets; }
+
+    /** Approximate values of a point, getNumDimensions() floats */
+    void decode(std::uint32_t index, float* out) const;
+
+private:
+    std::uint32_t               _numPoints;         /** Number of points */
+    std::uint32_t               _numDimensions;     /** Number of dimensions per point */
+    KnnPrecision                _precision;         /** Encoding */
+    std::vector<std::uint16_t>  _halfData;          /** Float16: row-major half precision floats */
+    std::vector<std::uint8_t>   _byteData;          /** Int8: row-major codes */
+    std::vector<float>          _scales;            /** Int8: value step per code of every dimension */
+    std::vector<float>          _offsets;           /** Int8: minimum of every dimension */
+};
+
+/**
+ * QuantizedDistance
+ *
+ * Distance between points of quantized data in one of HDILib's kNN metrics, with the conventions
+ * of MetricDistance. The query is decoded once per row of references, the references are decoded
+ * by the reduced precision kernels. The data is referenced, not copied.
+ */
+class QuantizedDistance
+{
+public:
+    QuantizedDistance(const QuantizedData& data, hdi::dr::knn_distance_metric metric);
+
+    /** Distances between the query and the references [referenceBegin, referenceEnd) */
+    void operator()(std::uint32_t query, std::uint32_t referenceBegin, std::uint32_t referenceEnd, float* out) const;
+
+private:
+    const QuantizedData&            _data;              /** Encoded points */
+    hdi::dr::knn_distance_metric    _metric;            /** Distance metric */
+    distance::HalfKernelFunction    _halfKernel;        /** Float16 kernel for the detected instruction set */
+    distance::ByteKernelFunction    _byteKernel;        /** Int8 kernel for the detected instruction set */
+    std::vector<float>              _inverseNorms;      /** Cosine only: inverse norm of every decoded point, 0 for points without direction */
+};
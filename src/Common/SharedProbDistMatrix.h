@@ -0,0 +1,88 @@
+#pragma once
+
+#include "SparseMatrix.h"
+
+#include "hdi/dimensionality_reduction/hd_joint_probability_generator.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/** HDILib's row-wise layout of a probability distribution, only used at the boundaries to HDILib */
+using ProbDistMatrix = hdi::dr::HDJointProbabilityGenerator<float>::sparse_scalar_matrix_type;
+
+/**
+ * SharedProbDistMatrix
+ *
+ * Reference-counted, copy-on-write handle to a probability distribution in CSR layout.
+ * Copies of the handle share one matrix, it is only duplicated when a holder asks for
+ * write access (detach) while others still reference it.
+ * HDILib's row-wise matrices are converted once when the handle is created from them.
+ */
+class SharedProbDistMatrix
+{
+public:
+    SharedProbDistMatrix() = default;
+
+    /** Take ownership of the matrix without copying it */
+    SharedProbDistMatrix(SparseMatrix&& matrix) :
+        _matrix(std::make_shared<SparseMatrix>(std::move(matrix)))
+    {
+    }
+
+    /** Convert a HDILib matrix, which is released afterwards */
+    SharedProbDistMatrix(ProbDistMatrix&& matrix) :
+        _matrix(std::make_shared<SparseMatrix>(SparseMatrix::fromMapMemEff(matrix)))
+    {
+        ProbDistMatrix().swap(matrix);
+    }
+
+    /** Share a matrix that is also held elsewhere */
+    explicit SharedProbDistMatrix(std::shared_ptr<SparseMatrix> matrix) :
+        _matrix(std::move(matrix))
+    {
+    }
+
+    bool isNull() const { return _matrix == nullptr; }
+
+    /** Number of rows, 0 for a null handle */
+    std::size_t size() const { return _matrix ? _matrix->getNumRows() : 0; }
+
+    const SparseMatrix& get() const
+    {
+        static const SparseMatrix empty;
+        return _matrix ? *_matrix : empty;
+    }
+
+    const SparseMatrix& operator*() const { return get(); }
+    const SparseMatrix* operator->() const { return &get(); }
+
+    /** Shared pointer to the matrix, e.g. to share it with the CPU gradient descent */
+    std::shared_ptr<const SparseMatrix> getSparseMatrix() const
+    {
+        return _matrix ? std::shared_ptr<const SparseMatrix>(_matrix) : std::make_shared<const SparseMatrix>();
+    }
+
+    /** Row-wise copy for HDILib (GPU gradient descent, serialization) */
+    ProbDistMatrix toMapMemEff() const { return get().toMapMemEff(); }
+
+    /** Write access, copies the matrix first if it is shared with other handles */
+    SparseMatrix& detach()
+    {
+        if (_matrix == nullptr)
+            _matrix = std::make_shared<SparseMatrix>();
+        else if (_matrix.use_count() > 1)
+            _matrix = std::make_shared<SparseMatrix>(*_matrix);
+
+        return *_matrix;
+    }
+
+    /** Number of handles (and owners) sharing the matrix */
+    long useCount() const { return _matrix.use_count(); }
+
+    /** Heap memory of the matrix in bytes */
+    std::size_t memoryUsage() const { return _matrix ? _matrix->memoryUsage() : 0; }
+
+private:
+    std::shared_ptr<SparseMatrix>   _matrix;    /** Shared matrix, only modified through detach() */
+};
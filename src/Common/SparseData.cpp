@@ -0,0 +1,163 @@
+#include "SparseData.h"
+
+#include "MetricDistance.h"
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    constexpr std::uint32_t compressBlockSize = 4096;   /** Dense rows read from the data provider at once */
+}
+
+SparseData::SparseData(const DataProvider& data) :
+    _numDimensions(data.getNumDimensions()),
+    _rowOffsets(1, 0),
+    _columns(),
+    _values()
+{
+    const std::size_t numDimensions = _numDimensions;
+
+    _rowOffsets.reserve(static_cast<std::size_t>(data.getNumPoints()) + 1);
+
+    std::vector<std::uint64_t> blockOffsets;
+
+    data.forEachBlock(compressBlockSize, [this, &blockOffsets, numDimensions](std::uint32_t, std::uint32_t count, const float* block) {
+        // Count the entries of every row first, so that the rows are filled in parallel
+        blockOffsets.assign(static_cast<std::size_t>(count) + 1, 0);
+
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+        {
+            const float* row = block + i * numDimensions;
+            blockOffsets[i + 1] = static_cast<std::uint64_t>(numDimensions - std::count(row, row + numDimensions, 0.f));
+        }
+
+        const std::uint64_t first = _rowOffsets.back();
+
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            blockOffsets[i + 1] += blockOffsets[i];
+            _rowOffsets.push_back(first + blockOffsets[i + 1]);
+        }
+
+        _columns.resize(first + blockOffsets[count]);
+        _values.resize(first + blockOffsets[count]);
+
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < static_cast<std::int64_t>(count); i++)
+        {
+            const float* row = block + i * numDimensions;
+            std::uint64_t entry = first + blockOffsets[i];
+
+            for (std::size_t d = 0; d < numDimensions; d++)
+            {
+                if (row[d] == 0.f)
+                    continue;
+
+                _columns[entry] = static_cast<std::uint32_t>(d);
+                _values[entry] = row[d];
+                entry++;
+            }
+        }
+        });
+}
+
+void SparseData::readBlock(std::uint32_t begin, std::uint32_t count, float* out) const
+{
+    assert(begin + count <= getNumPoints());
+
+    const std::size_t numDimensions = _numDimensions;
+
+    std::fill_n(out, count * numDimensions, 0.f);
+
+    for (std::uint32_t i = 0; i < count; i++)
+        for (std::uint64_t entry = _rowOffsets[begin + i]; entry < _rowOffsets[begin + i + 1]; entry++)
+            out[i * numDimensions + _columns[entry]] = _values[entry];
+}
+
+double SparseData::getDensity() const
+{
+    const double numValues = static_cast<double>(getNumPoints()) * _numDimensions;
+
+    return numValues > 0. ? static_cast<double>(getNumNonZeros()) / numValues : 0.;
+}
+
+SparseDistance::SparseDistance(const SparseData& data, hdi::dr::knn_distance_metric metric) :
+    _data(data),
+    _metric(metric),
+    _squaredNorms(data.getNumPoints())
+{
+    assert(supports(metric));
+
+    const auto& values = data.getValues();
+
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < static_cast<std::int64_t>(data.getNumPoints()); i++)
+    {
+        float sum = 0.f;
+
+        for (std::uint64_t entry = data.rowBegin(static_cast<std::uint32_t>(i)); entry < data.rowBegin(static_cast<std::uint32_t>(i) + 1); entry++)
+            sum += values[entry] * values[entry];
+
+        _squaredNorms[i] = sum;
+    }
+}
+
+bool SparseDistance::supports(hdi::dr::knn_distance_metric metric)
+{
+    switch (metric)
+    {
+    case hdi::dr::knn_distance_metric::KNN_METRIC_EUCLIDEAN:
+    case hdi::dr::knn_distance_metric::KNN_METRIC_COSINE:
+    case hdi::dr::knn_distance_metric::KNN_METRIC_INNER_PRODUCT:
+    case hdi::dr::knn_distance_metric::KNN_METRIC_DOT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void SparseDistance::operator()(std::uint32_t query, std::uint32_t referenceBegin, std::uint32_t referenceEnd, float* out) const
+{
+    const auto& columns = _data.getColumns();
+    const auto& values  = _data.getValues();
+
+    // Dense copy of the query, all zeros between the calls
+    thread_local std::vector<float> queryRow;
+
+    if (queryRow.size() != _data.getNumDimensions())
+        queryRow.assign(_data.getNumDimensions(), 0.f);
+
+    const std::uint64_t queryBegin = _data.rowBegin(query);
+    const std::uint64_t queryEnd = _data.rowBegin(query + 1);
+
+    for (std::uint64_t entry = queryBegin; entry < queryEnd; entry++)
+        queryRow[columns[entry]] = values[entry];
+
+    const float queryNorm = _squaredNorms[query];
+
+    for (std::uint32_t reference = referenceBegin; reference < referenceEnd; reference++)
+    {
+        float dotProduct = 0.f;
+
+        for (std::uint64_t entry = _data.rowBegin(reference); entry < _data.rowBegin(reference + 1); entry++)
+            dotProduct += queryRow[columns[entry]] * values[entry];
+
+        float result;
+
+        if (_metric == hdi::dr::knn_distance_metric::KNN_METRIC_EUCLIDEAN)
+            result = std::max(queryNorm + _squaredNorms[reference] - 2.f * dotProduct, 0.f);
+        else if (_metric == hdi::dr::knn_distance_metric::KNN_METRIC_COSINE)
+            result = MetricDistance::fromKernelValue(_metric, dotProduct, queryNorm > 0.f && _squaredNorms[reference] > 0.f ? 1.f / std::sqrt(queryNorm * _squaredNorms[reference]) : 0.f);
+        else
+            result = MetricDistance::fromKernelValue(_metric, dotProduct, 1.f);
+
+        out[reference - referenceBegin] = result;
+    }
+
+    for (std::uint64_t entry = queryBegin; entry < queryEnd; entry++)
+        queryRow[columns[entry]] = 0.f;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "DataProvider.h"
+
+#include "hdi/dimensionality_reduction/knn_utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * SparseData
+ *
+ * Compressed sparse row copy of data that is mostly zeros, e.g. count matrices of single cell data.
+ * It is built from another provider block by block, so the data is never dense as a whole, and
+ * provides blocks of dense rows itself, e.g. for a PCA projection.
+ */
+class SparseData : public DataProvider
+{
+public:
+    /** Compress the data, which is read in blocks, all values but zeros are kept */
+    explicit SparseData(const DataProvider& data);
+
+    std::uint32_t getNumPoints() const override { return static_cast<std::uint32_t>(_rowOffsets.size() - 1); }
+    std::uint32_t getNumDimensions() const override { return _numDimensions; }
+
+    void readBlock(std::uint32_t begin, std::uint32_t count, float* out) const override;
+
+    std::uint64_t getNumNonZeros() const { return _rowOffsets.back(); }
+
+    /** Fraction of the values that are not zero */
+    double getDensity() const;
+
+    /** Size of the compressed data in bytes */
+    std::size_t getMemoryUsage() const { return _rowOffsets.size() * sizeof(std::uint64_t) + _columns.size() * sizeof(std::uint32_t) + _values.size() * sizeof(float); }
+
+    /** Entries of the point are [rowBegin(point), rowBegin(point + 1)) of getColumns() and getValues(), with increasing columns */
+    std::uint64_t rowBegin(std::uint32_t point) const { return _rowOffsets[point]; }
+
+    const std::vector<std::uint32_t>& getColumns() const { return _columns; }
+    const std::vector<float>& getValues() const { return _values; }
+
+private:
+    std::uint32_t               _numDimensions;     /** Number of dimensions per point */
+    std::vector<std::uint64_t>  _rowOffsets;        /** First entry of every point and the number of entries at the end */
+    std::vector<std::uint32_t>  _columns;           /** Dimension of every entry */
+    std::vector<float>          _values;            /** Value of every entry */
+};
+
+/**
+ * SparseDistance
+ *
+ * Distance between points of sparse data in one of HDILib's kNN metrics, with the conventions of MetricDistance.
+ * The query is scattered into a dense row once per row of references, so every reference only costs its own entries.
+ * Euclidean distances are computed from the norms and the dot product. The data is referenced, not copied.
+ */
+class SparseDistance
+{
+public:
+    SparseDistance(const SparseData& data, hdi::dr::knn_distance_metric metric);
+
+    /** Whether the metric can be computed from dot products: Euclidean, cosine, inner product and dot */
+    static bool supports(hdi::dr::knn_distance_metric metric);
+
+    /** Distances between the query and the references [referenceBegin, referenceEnd) */
+    void operator()(std::uint32_t query, std::uint32_t referenceBegin, std::uint32_t referenceEnd, float* out) const;
+
+private:
+    const SparseData&               _data;              /** Compressed points */
+    hdi::dr::knn_distance_metric    _metric;            /** Distance metric */
+    std::vector<float>              _squaredNorms;      /** Squared norm of every point */
+};
@@ -0,0 +1,329 @@
+#include "SparseMatrix.h"
+
+#include "ParallelUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+namespace
+{
+    /**
+     * Submatrix of the given rows and the same columns, renumbered to the positions in indices
+     * @param forEachEntry Calls visit(column, value) for every entry of a row of the full matrix
+     */
+    template <typename ForEachEntry>
+    SparseMatrix extractSubMatrix(std::uint32_t numRows, const std::vector<std::uint32_t>& indices, ForEachEntry forEachEntry)
+    {
+        constexpr auto notSelected = std::numeric_limits<std::uint32_t>::max();
+
+        const std::int64_t numSelected = static_cast<std::int64_t>(indices.size());
+
+        // New index of every selected row/column
+        std::vector<std::uint32_t> newIndices(numRows, notSelected);
+
+        for (std::int64_t i = 0; i < numSelected; i++)
+        {
+            assert(indices[i] < numRows);
+            newIndices[indices[i]] = static_cast<std::uint32_t>(i);
+        }
+
+        std::vector<std::uint64_t> rowOffsets(numSelected + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+        for (std::int64_t i = 0; i < numSelected; i++)
+        {
+            std::uint64_t count = 0;
+            forEachEntry(indices[i], [&count, &newIndices](std::uint32_t column, float) { count += newIndices[column] != notSelected; });
+
+            rowOffsets[i] = count;
+        }
+
+        exclusiveScan(rowOffsets);
+
+        std::vector<std::uint32_t> columns(rowOffsets.back());
+        std::vector<float> values(rowOffsets.back());
+
+#pragma omp parallel for schedule(dynamic, 1024)
+        for (std::int64_t i = 0; i < numSelected; i++)
+        {
+            std::vector<std::pair<std::uint32_t, float>> entries;
+            entries.reserve(rowOffsets[i + 1] - rowOffsets[i]);
+
+            forEachEntry(indices[i], [&entries, &newIndices](std::uint32_t column, float value) {
+                if (const auto newColumn = newIndices[column]; newColumn != notSelected)
+                    entries.emplace_back(newColumn, value);
+                });
+
+            // The renumbering does not preserve the column order if the indices are not sorted
+            std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            std::uint64_t offset = rowOffsets[i];
+
+            for (const auto& [column, value] : entries)
+            {
+                columns[offset] = column;
+                values[offset] = value;
+                offset++;
+            }
+        }
+
+        return SparseMatrix(std::move(rowOffsets), std::move(columns), std::move(values));
+    }
+}
+
+SparseMatrix::SparseMatrix(std::vector<std::uint64_t>&& rowOffsets, std::vector<std::uint32_t>&& columns, std::vector<float>&& values) :
+    _rowOffsets(std::move(rowOffsets)),
+    _columns(std::move(columns)),
+    _values(std::move(values))
+{
+    assert(_columns.size() == _values.size());
+    assert(_rowOffsets.empty() || _rowOffsets.back() == _columns.size());
+}
+
+SparseMatrix SparseMatrix::fromMapMemEff(const MapMemEffMatrix& matrix)
+{
+    SparseMatrix result;
+
+    const std::int64_t numRows = static_cast<std::int64_t>(matrix.size());
+
+    result._rowOffsets.resize(numRows + 1, 0);
+
+    for (std::int64_t row = 0; row < numRows; row++)
+        result._rowOffsets[row] = matrix[row].size();
+
+    exclusiveScan(result._rowOffsets);
+
+    result._columns.resize(result._rowOffsets.back());
+    result._values.resize(result._rowOffsets.back());
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t row = 0; row < numRows; row++)
+    {
+        std::uint64_t offset = result._rowOffsets[row];
+
+        for (const auto& entry : matrix[row])
+        {
+            result._columns[offset] = entry.first;
+            result._values[offset] = entry.second;
+            offset++;
+        }
+    }
+
+    return result;
+}
+
+SparseMatrix::MapMemEffMatrix SparseMatrix::toMapMemEff() const
+{
+    const std::int64_t numRows = getNumRows();
+
+    MapMemEffMatrix result(numRows);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t row = 0; row < numRows; row++)
+    {
+        // Columns are sorted, so the entries can be appended to the map's storage directly
+        auto& entries = result[row].memory();
+        entries.reserve(_rowOffsets[row + 1] - _rowOffsets[row]);
+
+        for (std::uint64_t k = _rowOffsets[row]; k < _rowOffsets[row + 1]; k++)
+            entries.emplace_back(_columns[k], _values[k]);
+    }
+
+    return result;
+}
+
+SparseMatrix SparseMatrix::symmetrized() const
+{
+    const std::int64_t numRows = getNumRows();
+    const std::uint64_t numNonZeros = _columns.size();
+
+    if (numRows == 0)
+        return *this;
+
+    // The transpose is built in two cache-friendly passes without atomics:
+    // 1. The entries are partitioned into buckets of consecutive columns, chunks of rows in parallel
+    // 2. Every bucket is scattered into its rows of the transpose, buckets in parallel; a bucket's part of the transpose fits into the cache
+    // Entries stay in row order in both passes, so the rows of the transpose come out sorted
+    const std::int64_t numChunks = std::max<std::int64_t>(1, std::min<std::int64_t>(numParallelThreads() * 4, numRows / 1024));
+    const std::int64_t chunkSize = (numRows + numChunks - 1) / numChunks;
+    const std::int64_t numBuckets = std::max<std::int64_t>(1, std::min<std::int64_t>({ static_cast<std::int64_t>(numNonZeros / 65536), numRows, 4096 }));
+    const std::int64_t bucketSize = (numRows + numBuckets - 1) / numBuckets;
+
+    // Entries per chunk and bucket, scanned in bucket-major order they give the write position of every chunk in every bucket
+    std::vector<std::uint64_t> chunkBucketOffsets(numBuckets * numChunks + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::int64_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        const std::uint64_t begin = _rowOffsets[std::min(chunk * chunkSize, numRows)];
+        const std::uint64_t end = _rowOffsets[std::min((chunk + 1) * chunkSize, numRows)];
+
+        // Counted locally, neighboring chunks share cache lines in chunkBucketOffsets
+        std::vector<std::uint64_t> counts(numBuckets, 0);
+
+        for (std::uint64_t k = begin; k < end; k++)
+            counts[_columns[k] / bucketSize]++;
+
+        for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+            chunkBucketOffsets[bucket * numChunks + chunk] = counts[bucket];
+    }
+
+    exclusiveScan(chunkBucketOffsets);
+
+    std::vector<std::uint32_t> bucketRows(numNonZeros);
+    std::vector<std::uint32_t> bucketColumns(numNonZeros);
+    std::vector<float> bucketValues(numNonZeros);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::int64_t chunk = 0; chunk < numChunks; chunk++)
+    {
+        std::vector<std::uint64_t> fill(numBuckets);
+
+        for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+            fill[bucket] = chunkBucketOffsets[bucket * numChunks + chunk];
+
+        const std::int64_t rowEnd = std::min((chunk + 1) * chunkSize, numRows);
+
+        for (std::int64_t row = chunk * chunkSize; row < rowEnd; row++)
+        {
+            for (std::uint64_t k = _rowOffsets[row]; k < _rowOffsets[row + 1]; k++)
+            {
+                const auto target = fill[_columns[k] / bucketSize]++;
+                bucketRows[target] = static_cast<std::uint32_t>(row);
+                bucketColumns[target] = _columns[k];
+                bucketValues[target] = _values[k];
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> transposedOffsets(numRows + 1, 0);
+    std::vector<std::uint32_t> transposedColumns(numNonZeros);
+    std::vector<float> transposedValues(numNonZeros);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+        for (std::uint64_t k = chunkBucketOffsets[bucket * numChunks]; k < chunkBucketOffsets[(bucket + 1) * numChunks]; k++)
+            transposedOffsets[bucketColumns[k]]++;
+
+    exclusiveScan(transposedOffsets);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+    {
+        const std::int64_t columnBegin = std::min(bucket * bucketSize, numRows);
+        const std::int64_t columnEnd = std::min(columnBegin + bucketSize, numRows);
+
+        std::vector<std::uint64_t> fill(transposedOffsets.begin() + columnBegin, transposedOffsets.begin() + columnEnd);
+
+        for (std::uint64_t k = chunkBucketOffsets[bucket * numChunks]; k < chunkBucketOffsets[(bucket + 1) * numChunks]; k++)
+        {
+            const auto target = fill[bucketColumns[k] - columnBegin]++;
+            transposedColumns[target] = bucketRows[k];
+            transposedValues[target] = bucketValues[k];
+        }
+    }
+
+    std::vector<std::uint32_t>().swap(bucketRows);
+    std::vector<std::uint32_t>().swap(bucketColumns);
+    std::vector<float>().swap(bucketValues);
+
+    // Merge every row with the corresponding row of the transpose, once to count and once to write the entries
+    const auto mergeRow = [&](std::int64_t row, auto&& visit) -> void {
+        std::uint64_t a = _rowOffsets[row];
+        std::uint64_t b = transposedOffsets[row];
+        const std::uint64_t aEnd = _rowOffsets[row + 1];
+        const std::uint64_t bEnd = transposedOffsets[row + 1];
+
+        while (a < aEnd && b < bEnd)
+        {
+            if (_columns[a] < transposedColumns[b])
+            {
+                visit(_columns[a], 0.5f * _values[a]);
+                a++;
+            }
+            else if (transposedColumns[b] < _columns[a])
+            {
+                visit(transposedColumns[b], 0.5f * transposedValues[b]);
+                b++;
+            }
+            else
+            {
+                visit(_columns[a], 0.5f * (_values[a] + transposedValues[b]));
+                a++;
+                b++;
+            }
+        }
+
+        for (; a < aEnd; a++)
+            visit(_columns[a], 0.5f * _values[a]);
+
+        for (; b < bEnd; b++)
+            visit(transposedColumns[b], 0.5f * transposedValues[b]);
+    };
+
+    SparseMatrix result;
+    result._rowOffsets.resize(numRows + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t row = 0; row < numRows; row++)
+    {
+        std::uint64_t count = 0;
+        mergeRow(row, [&count](std::uint32_t, float) -> void { count++; });
+        result._rowOffsets[row] = count;
+    }
+
+    exclusiveScan(result._rowOffsets);
+
+    result._columns.resize(result._rowOffsets.back());
+    result._values.resize(result._rowOffsets.back());
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (std::int64_t row = 0; row < numRows; row++)
+    {
+        std::uint64_t offset = result._rowOffsets[row];
+
+        mergeRow(row, [&result, &offset](std::uint32_t column, float value) -> void {
+            result._columns[offset] = column;
+            result._values[offset] = value;
+            offset++;
+            });
+    }
+
+    return result;
+}
+
+SparseMatrix SparseMatrix::subMatrix(const std::vector<std::uint32_t>& indices) const
+{
+    return extractSubMatrix(getNumRows(), indices, [this](std::uint32_t row, auto&& visit) {
+        for (std::uint64_t k = _rowOffsets[row]; k < _rowOffsets[row + 1]; k++)
+            visit(_columns[k], _values[k]);
+        });
+}
+
+SparseMatrix SparseMatrix::fromMapMemEff(const MapMemEffMatrix& matrix, const std::vector<std::uint32_t>& indices)
+{
+    return extractSubMatrix(static_cast<std::uint32_t>(matrix.size()), indices, [&matrix](std::uint32_t row, auto&& visit) {
+        for (const auto& entry : matrix[row])
+            visit(entry.first, entry.second);
+        });
+}
+
+double SparseMatrix::sum() const
+{
+    const std::int64_t numValues = static_cast<std::int64_t>(_values.size());
+
+    double sum = 0;
+
+#pragma omp parallel for reduction(+:sum)
+    for (std::int64_t i = 0; i < numValues; i++)
+        sum += _values[i];
+
+    return sum;
+}
+
+std::size_t SparseMatrix::memoryUsage() const
+{
+    return _rowOffsets.capacity() * sizeof(std::uint64_t) + _columns.capacity() * sizeof(std::uint32_t) + _values.capacity() * sizeof(float);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "hdi/data/map_mem_eff.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * SparseMatrix
+ *
+ * Compressed sparse row (CSR) matrix with contiguous column and value arrays.
+ * Columns are sorted in every row.
+ */
+class SparseMatrix
+{
+public:
+    using MapMemEffMatrix = std::vector<hdi::data::MapMemEff<uint32_t, float>>;
+
+public:
+    SparseMatrix() = default;
+
+    /** Take ownership of CSR arrays, the columns of every row have to be sorted */
+    SparseMatrix(std::vector<std::uint64_t>&& rowOffsets, std::vector<std::uint32_t>&& columns, std::vector<float>&& values);
+
+    /** Convert a HDILib row-wise sparse matrix */
+    static SparseMatrix fromMapMemEff(const MapMemEffMatrix& matrix);
+
+    /** Convert only the submatrix of the given rows and columns of a HDILib row-wise sparse matrix, see subMatrix */
+    static SparseMatrix fromMapMemEff(const MapMemEffMatrix& matrix, const std::vector<std::uint32_t>& indices);
+
+    /** Convert to a HDILib row-wise sparse matrix, only needed to hand the matrix to HDILib */
+    MapMemEffMatrix toMapMemEff() const;
+
+    /** Returns (P + P^T) / 2, computed in parallel with two count and scatter passes (transpose, merge) */
+    SparseMatrix symmetrized() const;
+
+    /**
+     * Returns the submatrix of the given rows and the same columns, i.e. the subgraph induced by the indices
+     * Row and column i of the result correspond to indices[i], entries to other columns are dropped
+     */
+    SparseMatrix subMatrix(const std::vector<std::uint32_t>& indices) const;
+
+    /** Sum of all values */
+    double sum() const;
+
+    /** Heap memory of the matrix in bytes */
+    std::size_t memoryUsage() const;
+
+public: // Getter
+    std::uint32_t getNumRows() const { return _rowOffsets.empty() ? 0 : static_cast<std::uint32_t>(_rowOffsets.size() - 1); }
+    std::uint64_t getNumNonZeros() const { return _values.size(); }
+
+    const std::vector<std::uint64_t>& getRowOffsets() const { return _rowOffsets; }
+    const std::vector<std::uint32_t>& getColumns() const { return _columns; }
+    const std::vector<float>& getValues() const { return _values; }
+
+private:
+    std::vector<std::uint64_t>  _rowOffsets;    /** Start of every row in _columns and _values, numRows + 1 entries */
+    std::vector<std::uint32_t>  _columns;       /** Column index of every non-zero entry */
+    std::vector<float>          _values;        /** Value of every non-zero entry */
+};
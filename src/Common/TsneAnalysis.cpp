@@ -6,9 +6,19 @@
     #include "hdi/utils/glad/glad.h"
 #endif // __APPLE__
  
+#include "BruteForceKnn.h"
+#include "DistanceKernels.h"
+#include "KnnAutoSelection.h"
+#include "KnnGraphCache.h"
+#include "LibraryKnn.h"
 #include "OffscreenBuffer.h"
+#include "OutOfSampleEmbedding.h"
+#include "ParallelUtils.h"
+#include "PerplexityCalibration.h"
 
 #include <cassert>
+#include <chrono>
+#include <optional>
 #include <vector>
 
 #include <QCoreApplication>
@@ -24,15 +34,23 @@ TsneWorker::TsneWorker(TsneParameters tsneParameters) :
     _knnParameters(),
     _numPoints(0),
     _numDimensions(0),
-    _data(),
+    _numEmbeddedPoints(0),
+    _dataProvider(),
+    _knnGraph(),
+    _knnIndex(),
+    _projectedData(),
     _probabilityDistribution(),
+    _jointProbabilityDistribution(),
     _hasProbabilityDistribution(false),
     _GPGPU_tSNE(),
     _CPU_tSNE(),
+    _parallelCPU_tSNE(),
+    _fftCPU_tSNE(),
     _embedding(),
-    _outEmbedding(),
+    _embeddingSnapshots(),
+    _embeddingMailbox(std::make_shared<TsneDataMailbox>()),
     _offscreenBuffer(nullptr),
-    _shouldStop(false),
+    _control(),
     _parentTask(nullptr),
     _tasks(nullptr)
 {
@@ -41,55 +59,73 @@ TsneWorker::TsneWorker(TsneParameters tsneParameters) :
 }
 
 TsneWorker::TsneWorker(TsneParameters tsneParameters, KnnParameters knnParameters, const std::vector<float>& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
-    TsneWorker(tsneParameters)
+    TsneWorker(tsneParameters, knnParameters, std::vector<float>(data), numDimensions, initEmbedding)
 {
-    assert(numDimensions > 0);
+}
+
+TsneWorker::TsneWorker(TsneParameters parameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
+    TsneWorker(parameters, knnParameters, std::make_shared<const VectorDataProvider>(std::move(data), numDimensions), initEmbedding)
+{
+}
+
+TsneWorker::TsneWorker(TsneParameters parameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
+    TsneWorker(parameters)
+{
+    assert(dataProvider != nullptr && dataProvider->getNumDimensions() > 0);
 
     _knnParameters = knnParameters;
-    _numPoints     = data.size() / numDimensions;
-    _numDimensions = numDimensions;
-    _data          = data;
+    _numPoints     = dataProvider->getNumPoints();
+    _numDimensions = dataProvider->getNumDimensions();
+    _dataProvider  = std::move(dataProvider);
     _embedding     = { static_cast<uint32_t>(_tsneParameters.getNumDimensionsOutput()), _numPoints };
 
     if (initEmbedding)
         setInitEmbedding(*initEmbedding);
 }
 
-TsneWorker::TsneWorker(TsneParameters parameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
+TsneWorker::TsneWorker(TsneParameters parameters, std::shared_ptr<const KnnGraph> knnGraph, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
     TsneWorker(parameters)
 {
-    assert(numDimensions > 0);
+    assert(knnGraph != nullptr && knnGraph->getNumNeighbors() >= static_cast<std::uint32_t>(_tsneParameters.getNumNeighbors()));
 
-    _knnParameters = knnParameters;
-    _numPoints     = data.size() / numDimensions;
-    _numDimensions = numDimensions;
-    _data          = std::move(data);
-    _embedding     = { static_cast<uint32_t>(_tsneParameters.getNumDimensionsOutput()), _numPoints };
+    _numPoints = knnGraph->getNumPoints();
+    _knnGraph  = std::move(knnGraph);
+    _embedding = { static_cast<uint32_t>(_tsneParameters.getNumDimensionsOutput()), _numPoints };
 
     if (initEmbedding)
         setInitEmbedding(*initEmbedding);
 }
 
-TsneWorker::TsneWorker(TsneParameters parameters, const std::vector<hdi::data::MapMemEff<uint32_t, float>>& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
+TsneWorker::TsneWorker(TsneParameters parameters, KnnParameters knnParameters, SharedProbDistMatrix probDist, const hdi::data::Embedding<float>::scalar_vector_type& embedding, std::shared_ptr<const DataProvider> dataProvider) :
     TsneWorker(parameters)
 {
-    _probabilityDistribution    = probDist;
-    _hasProbabilityDistribution = true;
-    _numPoints                  = numPoints;
+    assert(dataProvider != nullptr && probDist.size() > 0 && probDist.size() < dataProvider->getNumPoints());
+    assert(_tsneParameters.getNumDimensionsOutput() == 2 && embedding.size() == 2 * probDist.size());
+
+    _knnParameters              = knnParameters;
+    _numEmbeddedPoints          = static_cast<uint32_t>(probDist.size());
+    _numPoints                  = dataProvider->getNumPoints();
+    _numDimensions              = dataProvider->getNumDimensions();
+    _dataProvider               = std::move(dataProvider);
+    _probabilityDistribution    = std::move(probDist);
     _embedding                  = { static_cast<uint32_t>(_tsneParameters.getNumDimensionsOutput()), _numPoints };
 
-    if (initEmbedding)
-        setInitEmbedding(*initEmbedding);
+    // The embedded points keep their positions, also when the gradient descent of all points is continued
+    std::copy(embedding.begin(), embedding.end(), _embedding.getContainer().begin());
+    _tsneParameters.setPresetEmbedding(true);
 }
 
-TsneWorker::TsneWorker(TsneParameters parameters, std::vector<hdi::data::MapMemEff<uint32_t, float>>&& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
+TsneWorker::TsneWorker(TsneParameters parameters, SharedProbDistMatrix probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding) :
     TsneWorker(parameters)
 {
+    assert(probDist.size() == numPoints);
+
     _probabilityDistribution    = std::move(probDist);
     _hasProbabilityDistribution = true;
     _numPoints                  = numPoints;
     _embedding                  = { static_cast<uint32_t>(_tsneParameters.getNumDimensionsOutput()), _numPoints };
-    _tsneParameters.setExaggerationFactor(4 + _numPoints / 60000.0);
+
+    qDebug() << "tSNE: Probability distribution of " << _numPoints << " points, " << _probabilityDistribution.memoryUsage() / (1024. * 1024.) << " MB, shared by " << _probabilityDistribution.useCount() << " holders";
 
     if (initEmbedding)
         setInitEmbedding(*initEmbedding);
@@ -156,79 +192,405 @@ void TsneWorker::setCurrentIteration(int currentIteration)
     }
 }
 
+void TsneWorker::setKnnIndex(std::shared_ptr<const KnnIndex> knnIndex)
+{
+    _knnIndex = std::move(knnIndex);
+}
+
+void TsneWorker::setProjectedData(std::shared_ptr<const ProjectedData> projectedData)
+{
+    _projectedData = std::move(projectedData);
+}
+
 void TsneWorker::createTasks()
 {
     _tasks = new TsneWorkerTasks(this, _parentTask);
 }
 
-hdi::dr::TsneParameters TsneWorker::tsneParameters()
+hdi::dr::TsneParameters toHdiTsneParameters(const TsneParameters& parameters)
 {
     hdi::dr::TsneParameters tsneParameters;
 
-    tsneParameters._embedding_dimensionality    = _tsneParameters.getNumDimensionsOutput();
-    tsneParameters._mom_switching_iter          = _tsneParameters.getExaggerationIter();
-    tsneParameters._remove_exaggeration_iter    = _tsneParameters.getExaggerationIter();
-    tsneParameters._exaggeration_factor         = _tsneParameters.getExaggerationFactor();
-    tsneParameters._exponential_decay_iter      = _tsneParameters.getExponentialDecayIter();
-    tsneParameters._presetEmbedding             = _tsneParameters.getPresetEmbedding();
+    tsneParameters._embedding_dimensionality    = parameters.getNumDimensionsOutput();
+    tsneParameters._mom_switching_iter          = parameters.getExaggerationIter();
+    tsneParameters._remove_exaggeration_iter    = parameters.getExaggerationIter();
+    tsneParameters._exaggeration_factor         = parameters.getExaggerationFactor();
+    tsneParameters._exponential_decay_iter      = parameters.getExponentialDecayIter();
+    tsneParameters._presetEmbedding             = parameters.getPresetEmbedding();
+    tsneParameters._seed                        = parameters.getSeed();
 
     return tsneParameters;
 }
 
-hdi::dr::HDJointProbabilityGenerator<float>::Parameters TsneWorker::probGenParameters()
+hdi::dr::TsneParameters TsneWorker::tsneParameters()
+{
+    return toHdiTsneParameters(_tsneParameters);
+}
+
+std::shared_ptr<const DataProvider> TsneWorker::knnInputData()
 {
-    hdi::dr::HDJointProbabilityGenerator<float>::Parameters probGenParams;
+    const auto numComponents = _knnParameters.getNumPcaComponents();
+
+    // Fewer components than dimensions are needed for the projection to reduce anything
+    if (numComponents == 0 || numComponents >= _numDimensions)
+        return _dataProvider;
+
+    const bool reuseProjection = _projectedData != nullptr && _projectedData->numComponents == numComponents &&
+                                 _projectedData->data->getNumPoints() == _numPoints && _projectedData->projection.getNumInputDimensions() == _numDimensions;
 
-    probGenParams._perplexity               = _tsneParameters.getPerplexity();
-    probGenParams._perplexity_multiplier    = 3;
-    probGenParams._num_trees                = _knnParameters.getAnnoyNumTrees();
-    probGenParams._num_checks               = _knnParameters.getAnnoyNumChecks();
-    probGenParams._aknn_algorithmP1         = _knnParameters.getHNSWm();
-    probGenParams._aknn_algorithmP2         = _knnParameters.getHNSWef();
-    probGenParams._aknn_algorithm           = _knnParameters.getKnnAlgorithm();
-    probGenParams._aknn_metric              = _knnParameters.getKnnDistanceMetric();
+    if (reuseProjection)
+    {
+        qDebug() << "tSNE: Reusing PCA projection onto " << _projectedData->projection.getNumComponents() << " components";
+        return _projectedData->data;
+    }
+
+    _tasks->getComputingSimilaritiesTask().setProgressDescription("Projecting onto principal components");
+
+    double tProjection = 0.0;
+    {
+        hdi::utils::ScopedTimer<double> timer(tProjection);
+
+        PcaProjection::Parameters parameters;
+        parameters.numComponents = numComponents;
+
+        auto projection = PcaProjection::fit(*_dataProvider, parameters);
+        auto projectedPoints = projection.project(*_dataProvider);
+        const auto numProjectedDimensions = projection.getNumComponents();
+
+        _projectedData = std::make_shared<const ProjectedData>(ProjectedData{ std::move(projection), std::make_shared<const VectorDataProvider>(std::move(projectedPoints), numProjectedDimensions), numComponents });
+    }
+
+    qDebug() << "tSNE: Projected " << _numDimensions << " dimensions onto " << _projectedData->projection.getNumComponents() << " principal components: " << tProjection / 1000 << " seconds";
 
-    return probGenParams;
+    // An index of other points in the same number of dimensions must not be mistaken for one of the new projection
+    _knnIndex.reset();
+
+    return _projectedData->data;
 }
 
-void TsneWorker::computeSimilarities()
+KnnGraph TsneWorker::computeKnnGraph(std::uint32_t numNeighbors)
 {
-    assert(_data.size() == _numDimensions * _numPoints);
+    // The key is computed from the requested parameters, so automatically selected graphs are found again without a new selection
+    std::optional<KnnGraphCache> cache;
+    std::uint64_t cacheKey = 0;
+
+    if (_knnParameters.getCacheKnnGraph())
+    {
+        cache.emplace(KnnGraphCache::defaultDirectory());
+        cacheKey = KnnGraphCache::computeKey(*_dataProvider, _knnParameters);
+
+        if (auto knnGraph = cache->load(cacheKey, _numPoints, numNeighbors))
+        {
+            qDebug() << "tSNE: kNN graph loaded from cache, key" << QString::number(cacheKey, 16);
+            return std::move(*knnGraph);
+        }
+    }
+
+    // The neighbors are searched among the projected points if a projection is requested, the cache key above stays the one of the input
+    const auto knnData = knnInputData();
+    const auto numKnnDimensions = knnData->getNumDimensions();
+
+    if (_control.isStopRequested())
+        return {};
+
+    // The selected configuration replaces the request, it is logged so that the run can be reproduced with explicit settings
+    if (_knnParameters.getKnnBackend() == KnnBackend::Auto)
+    {
+        _tasks->getComputingSimilaritiesTask().setProgressDescription("Selecting kNN backend");
+
+        auto selection = selectKnnParameters(*knnData, _knnParameters, numNeighbors);
+        selection.knnParameters.setCacheKnnGraph(_knnParameters.getCacheKnnGraph());
+        selection.knnParameters.setNumPcaComponents(_knnParameters.getNumPcaComponents());
+        _knnParameters = selection.knnParameters;
+
+        // The index the selection measured is the one the search below would build
+        if (selection.knnIndex != nullptr)
+            _knnIndex = std::move(selection.knnIndex);
+
+        qDebug() << "tSNE:" << QString::fromStdString(selection.summary);
+        _tasks->getComputingSimilaritiesTask().setProgressDescription(QString::fromStdString(selection.summary));
+    }
+
+    // The libraries index the dense 32-bit data
+    if (_knnParameters.getKnnBackend() != KnnBackend::BruteForce && _knnParameters.getKnnPrecision() != KnnPrecision::Float32)
+        qDebug() << "tSNE: The" << knnPrecisionName(_knnParameters.getKnnPrecision()) << "precision only applies to the brute-force search, it is ignored";
+
+    KnnGraph knnGraph;
+
+    if (_knnParameters.getKnnBackend() == KnnBackend::BruteForce)
+    {
+        // The projection onto principal components is dense
+        const auto precision = _knnParameters.getKnnPrecision() == KnnPrecision::Sparse && _knnParameters.getNumPcaComponents() > 0 ? KnnPrecision::Float32 : _knnParameters.getKnnPrecision();
+
+        qDebug() << "Computing exact nearest neighbors (brute force, " << distance::simdLevelName(distance::detectSimdLevel()) << ", " << knnPrecisionName(precision) << "): Num dims: " << numKnnDimensions << " Num data points: " << _numPoints;
+        knnGraph = computeBruteForceKnn(*knnData, numNeighbors, _knnParameters.getKnnDistanceMetric(), precision, &_control);
+
+        // Candidates that the reduced precision missed are not found by the re-ranking
+        if (!isFullKnnPrecision(precision) && !_control.isStopRequested())
+            qDebug() << "tSNE: Recall of the reduced precision search, estimated on 100 points: " << estimateKnnRecall(*knnData, knnGraph, _knnParameters.getKnnDistanceMetric());
+    }
+    else if (KnnIndex::supports(_knnParameters))
+    {
+        // The index is kept, so that other numbers of neighbors and new points are searched without building it again
+        const bool reuseIndex = _knnIndex != nullptr &&
+                                _knnIndex->getNumPoints() == _numPoints && _knnIndex->getNumDimensions() == numKnnDimensions &&
+                                _knnIndex->getKnnParameters().yieldsSameNeighbors(_knnParameters);
+
+        if (reuseIndex)
+            qDebug() << "Searching approximate nearest neighbors in the index of a previous computation: Num dims: " << numKnnDimensions << " Num data points: " << _numPoints;
+        else
+        {
+            qDebug() << "Building approximate nearest neighbor index: Num dims: " << numKnnDimensions << " Num data points: " << _numPoints;
+            _knnIndex = KnnIndex::build(knnData->getDenseData().data(), _numPoints, numKnnDimensions, _knnParameters);
+        }
+
+        if (_control.isStopRequested())
+            return knnGraph;
+
+        knnGraph = computeLibraryKnn(*knnData, numNeighbors, *_knnIndex, &_control);
+    }
+    else
+    {
+        // HDILib's kNN libraries need all data in one array: a view if the provider is contiguous, otherwise a copy that only lives during the search
+        qDebug() << "Computing approximate nearest neighbors: Num dims: " << numKnnDimensions << " Num data points: " << _numPoints << (knnData->getContiguousData() != nullptr ? " (zero-copy input)" : " (dense copy of the input)");
+        knnGraph = computeLibraryKnn(*knnData, numNeighbors, _knnParameters);
+    }
+
+    // The graph of an interrupted search is incomplete
+    if (_control.isStopRequested())
+        return knnGraph;
+
+    if (cache.has_value() && cache->save(cacheKey, knnGraph))
+        qDebug() << "tSNE: kNN graph stored in cache, key" << QString::number(cacheKey, 16);
+
+    return knnGraph;
+}
 
+void TsneWorker::computeSimilarities()
+{
     _tasks->getComputingSimilaritiesTask().setRunning();
 
-    double t = 0.0;
+    // Same neighborhood size as HDILib: perplexity * perplexity multiplier neighbors besides the point itself
+    const auto perplexity   = _tsneParameters.getPerplexity();
+    const auto numNeighbors = static_cast<std::uint32_t>(_tsneParameters.getNumNeighbors());
+
+    double tKnn = 0.0, tCalibration = 0.0, tSymmetrization = 0.0;
+
+    // Each stage is checked for stop requests, the gradient descent is skipped then and nothing incomplete is kept
+    const auto aborted = [this]() -> bool {
+        if (!_control.isStopRequested())
+            return false;
+
+        qDebug() << "tSNE: Computation of the probability distribution stopped";
+        _tasks->getComputingSimilaritiesTask().setAborted();
+
+        // There is no distribution to continue the gradient descent with, see canContinue
+        _currentIteration = -1;
+        return true;
+        };
+
+    // Stage 1: kNN search, skipped if the graph of a previous run has enough neighbors
+    if (_knnGraph == nullptr || _knnGraph->getNumNeighbors() < numNeighbors)
     {
-        hdi::utils::ScopedTimer<double> timer(t);
+        assert(_dataProvider != nullptr && _dataProvider->getNumPoints() == _numPoints);
+
+        hdi::utils::ScopedTimer<double> timer(tKnn);
+        auto knnGraph = computeKnnGraph(numNeighbors);
+
+        if (aborted())
+            return;
+
+        _knnGraph = std::make_shared<const KnnGraph>(std::move(knnGraph));
+    }
+    else
+        qDebug() << "tSNE: Reusing kNN graph with " << _knnGraph->getNumNeighbors() << " neighbors per point";
+
+    // Stage 2: per-point binary search over the Gaussian bandwidths, only on the neighbors a fresh search for this perplexity would find
+    SparseMatrix conditionalProbabilities;
+    {
+        hdi::utils::ScopedTimer<double> timer(tCalibration);
 
-        _probabilityDistribution.clear();
-        _probabilityDistribution.resize(_numPoints);
-        qDebug() << "Sparse matrix allocated.";
+        if (_knnGraph->getNumNeighbors() == numNeighbors)
+            conditionalProbabilities = computeConditionalProbabilities(*_knnGraph, static_cast<float>(perplexity));
+        else
+            conditionalProbabilities = computeConditionalProbabilities(_knnGraph->truncated(numNeighbors), static_cast<float>(perplexity));
+    }
 
-        hdi::dr::HDJointProbabilityGenerator<float> probabilityGenerator;
+    if (aborted())
+        return;
 
-        qDebug() << "Computing high dimensional probability distributions: Num dims: " << _numDimensions << " Num data points: " << _numPoints;
-        probabilityGenerator.computeJointProbabilityDistribution(_data.data(), _numDimensions, _numPoints, _probabilityDistribution, probGenParameters());         // The _probabilityDistribution is symmetrized here.
+    // Stage 3: joint distribution
+    {
+        hdi::utils::ScopedTimer<double> timer(tSymmetrization);
+        _probabilityDistribution = conditionalProbabilities.symmetrized();
+        _jointProbabilityDistribution = _probabilityDistribution.getSparseMatrix();
     }
     
     qDebug() << "================================================================================";
-    qDebug() << "tSNE: Computed probability distribution: " << t / 1000 << " seconds";
+    qDebug() << "tSNE: Computed probability distribution: " << (tKnn + tCalibration + tSymmetrization) / 1000 << " seconds";
+    qDebug() << "      kNN search: " << tKnn / 1000 << " s, perplexity calibration: " << tCalibration / 1000 << " s, symmetrization: " << tSymmetrization / 1000 << " s";
     qDebug() << "--------------------------------------------------------------------------------";
 
+    // The input is not needed for the gradient descent, the kNN graph and index are kept for runs with another perplexity
+    _dataProvider.reset();
+
     _tasks->getComputingSimilaritiesTask().setFinished();
 }
 
+void TsneWorker::embedNewPoints()
+{
+    const auto numNewPoints = _numPoints - _numEmbeddedPoints;
+
+    OutOfSampleParameters parameters;
+    parameters.perplexity           = static_cast<float>(_tsneParameters.getPerplexity());
+    parameters.perplexityMultiplier = _tsneParameters.getPerplexityMultiplier();
+
+    qDebug() << "tSNE: Embedding " << numNewPoints << " new points into the embedding of " << _numEmbeddedPoints << " points";
+
+    // Stage 1: neighbors among the embedded points and perplexity calibration
+    auto& similaritiesTask = _tasks->getComputingSimilaritiesTask();
+    similaritiesTask.setRunning();
+
+    double tSimilarities = 0.0;
+    std::shared_ptr<const SparseMatrix> probabilities;
+    {
+        hdi::utils::ScopedTimer<double> timer(tSimilarities);
+
+        // New points are projected onto the components of the embedded points, so that they are searched in the same space as the index
+        std::shared_ptr<const DataProvider> knnData = _dataProvider;
+        const auto numComponents = _knnParameters.getNumPcaComponents();
+
+        if (numComponents > 0 && numComponents < _numDimensions)
+        {
+            const bool reuseProjection = _projectedData != nullptr && _projectedData->numComponents == numComponents &&
+                                         _projectedData->data->getNumPoints() == _numEmbeddedPoints && _projectedData->projection.getNumInputDimensions() == _numDimensions;
+
+            if (reuseProjection)
+            {
+                const auto& projection = _projectedData->projection;
+                knnData = std::make_shared<const VectorDataProvider>(projection.project(*_dataProvider), projection.getNumComponents());
+            }
+            else
+                knnData = knnInputData();
+        }
+
+        // The approximate index of the embedded points, if there is one, replaces the exact search
+        const bool useIndex = _knnIndex != nullptr && _knnIndex->getNumPoints() == _numEmbeddedPoints && _knnIndex->getNumDimensions() == knnData->getNumDimensions() &&
+                              _knnIndex->getKnnParameters().getKnnDistanceMetric() == _knnParameters.getKnnDistanceMetric();
+
+        if (useIndex)
+            probabilities = std::make_shared<const SparseMatrix>(computeOutOfSampleProbabilities(*knnData, _numEmbeddedPoints, *_knnIndex, parameters));
+        else
+            probabilities = std::make_shared<const SparseMatrix>(computeOutOfSampleProbabilities(*knnData, _numEmbeddedPoints, _knnParameters.getKnnDistanceMetric(), parameters));
+    }
+
+    _dataProvider.reset();
+    similaritiesTask.setFinished();
+
+    qDebug() << "tSNE: Computed out-of-sample probabilities: " << tSimilarities / 1000 << " seconds";
+
+    // Stage 2: gradient descent of the new points, the embedded points are fixed
+    auto& gradientDescentTask = _tasks->getComputeGradientDescentTask();
+    gradientDescentTask.setRunning();
+    gradientDescentTask.setProgress(0.f);
+
+    constexpr int numIterations = 250;
+
+    OutOfSampleGradientDescent gradientDescent;
+    gradientDescent.initialize(probabilities, &_embedding, parameters);
+
+    const auto progressInterval = std::chrono::milliseconds(100);
+    auto lastProgressUpdate = std::chrono::steady_clock::now();
+
+    double tGradientDescent = 0.0;
+    {
+        hdi::utils::ScopedTimer<double> timer(tGradientDescent);
+
+        for (int iteration = 0; iteration < numIterations && !_control.isStopRequested(); iteration++)
+        {
+            gradientDescent.doAnIteration();
+
+            if (_control.isPauseRequested() && !_control.waitWhilePaused())
+                break;
+
+            const auto now = std::chrono::steady_clock::now();
+
+            if (now - lastProgressUpdate >= progressInterval)
+            {
+                gradientDescentTask.setProgress(static_cast<float>(iteration + 1) / numIterations, QString("Placing new points, iteration %1 of %2").arg(iteration + 1).arg(numIterations));
+
+                if (!_embeddingMailbox->isPending() && _embeddingMailbox->post(snapshotEmbedding()))
+                    emit embeddingAvailable();
+
+                lastProgressUpdate = now;
+            }
+        }
+    }
+
+    if (_embeddingMailbox->post(snapshotEmbedding()))
+        emit embeddingAvailable();
+
+    qDebug() << "tSNE: Placed new points in " << tGradientDescent / 1000 << " seconds";
+
+    // Stage 3: joint distribution of all points, so that continuing refines the whole embedding
+    _probabilityDistribution = extendJointProbabilities(*_probabilityDistribution, *probabilities);
+    _jointProbabilityDistribution = _probabilityDistribution.getSparseMatrix();
+
+    gradientDescentTask.setFinished();
+
+    emit finished();
+}
+
+void TsneWorker::computeJointProbabilityDistribution()
+{
+    // In case of HSNE, the _probabilityDistribution is a non-symmetric transition matrix, symmetrized once here for all gradient descent implementations
+    double t = 0.0;
+    {
+        hdi::utils::ScopedTimer<double> timer(t);
+        _jointProbabilityDistribution = std::make_shared<const SparseMatrix>(_probabilityDistribution->symmetrized());
+    }
+
+    qDebug() << "tSNE: Symmetrized probability distribution: " << t / 1000 << " seconds";
+}
+
 void TsneWorker::computeGradientDescent(uint32_t iterations)
 {
-    if (_shouldStop)
+    if (_control.isStopRequested())
         return;
 
-    const auto updateEmbedding = [this](const TsneData& tsneData) -> void {
-        copyEmbeddingOutput();
-        emit embeddingUpdate(tsneData);
+    auto lastEmbeddingUpdate = std::chrono::steady_clock::now();
+
+    const auto updateEmbedding = [this, &lastEmbeddingUpdate]() -> void {
+        // A snapshot that was not taken yet is replaced, its consumer is already notified
+        if (_embeddingMailbox->post(snapshotEmbedding()))
+            emit embeddingAvailable();
+
+        lastEmbeddingUpdate = std::chrono::steady_clock::now();
+        };
+
+    // Publish at most every update interval and skip while the consumer did not take the previous snapshot, so the loop never waits for the UI
+    const auto scheduleEmbeddingUpdate = [this, &lastEmbeddingUpdate, updateEmbedding]() -> void {
+        if (_currentIteration == 0 || _tsneParameters.getUpdateCore() <= 0 || _currentIteration % _tsneParameters.getUpdateCore() != 0)
+            return;
+
+        if (_embeddingMailbox->isPending())
+            return;
+
+        if (std::chrono::steady_clock::now() - lastEmbeddingUpdate < std::chrono::milliseconds(_tsneParameters.getUpdateInterval()))
+            return;
+
+        updateEmbedding();
+        };
+
+    // HDILib copies the distribution into its row-wise layout: the joint distribution is released before, so that only the converted
+    // matrix and HDILib's copy exist while initializing, unless the distribution is shared with the caller
+    const auto releaseJointProbabilityDistribution = [this]() -> SparseMatrix::MapMemEffMatrix {
+        auto jointProbabilityDistribution = _jointProbabilityDistribution->toMapMemEff();
+        _jointProbabilityDistribution.reset();
+        return jointProbabilityDistribution;
         };
 
-    auto initGPUTSNE = [this]() {
+    auto initGPUTSNE = [this, releaseJointProbabilityDistribution]() {
         // Initialize offscreen buffer
         double t_buffer = 0.0;
         {
@@ -241,18 +603,15 @@ void TsneWorker::computeGradientDescent(uint32_t iterations)
         {
             auto params = tsneParameters();
 
-            // In case of HSNE, the _probabilityDistribution is a non-summetric transition matrix and initialize() symmetrizes it here
             _GPGPU_tSNE.setType(hdi::dr::GradientDescentTSNETexture::GpgpuSneType::AUTO_DETECT);
-            if (_hasProbabilityDistribution)
-                _GPGPU_tSNE.initialize(_probabilityDistribution, &_embedding, params);
-            else
-                _GPGPU_tSNE.initializeWithJointProbabilityDistribution(_probabilityDistribution, &_embedding, params);
+
+            _GPGPU_tSNE.initializeWithJointProbabilityDistribution(releaseJointProbabilityDistribution(), &_embedding, params);
 
             qDebug() << "A-tSNE (GPU): Exaggeration factor: " << params._exaggeration_factor << ", exaggeration iterations: " << params._remove_exaggeration_iter << ", exaggeration decay iter: " << params._exponential_decay_iter;
         }
     };
 
-    auto initCPUTSNE = [this]() {
+    auto initCPUTSNE = [this, releaseJointProbabilityDistribution]() {
         if (!_CPU_tSNE.isInitialized())
         {
             auto params = tsneParameters();
@@ -260,43 +619,70 @@ void TsneWorker::computeGradientDescent(uint32_t iterations)
             double theta = std::min(0.5, std::max(0.0, (_numPoints - 1000.0) * 0.00005));
             _CPU_tSNE.setTheta(theta);
 
-            // In case of HSNE, the _probabilityDistribution is a non-summetric transition matrix and initialize() symmetrizes it here
-            if (_hasProbabilityDistribution)
-                _CPU_tSNE.initialize(_probabilityDistribution, &_embedding, params);
-            else
-                _CPU_tSNE.initializeWithJointProbabilityDistribution(_probabilityDistribution, &_embedding, params);
+            _CPU_tSNE.initializeWithJointProbabilityDistribution(releaseJointProbabilityDistribution(), &_embedding, params);
 
             qDebug() << "t-SNE (CPU, Barnes-Hut): Exaggeration factor: " << params._exaggeration_factor << ", exaggeration iterations: " << params._remove_exaggeration_iter << ", exaggeration decay iter: " << params._exponential_decay_iter << ", theta: " << theta;
         }
     };
 
-    auto initTSNE = [this, initGPUTSNE, initCPUTSNE, updateEmbedding]() {
+    auto initParallelCPUTSNE = [this]() {
+        if (!_parallelCPU_tSNE.isInitialized())
+        {
+            auto params = tsneParameters();
+
+            double theta = std::min(0.5, std::max(0.0, (_numPoints - 1000.0) * 0.00005));
+            _parallelCPU_tSNE.setTheta(theta);
+
+            _parallelCPU_tSNE.initializeWithJointProbabilityDistribution(_jointProbabilityDistribution, &_embedding, params);
+
+            qDebug() << "t-SNE (CPU, multi-threaded Barnes-Hut): Exaggeration factor: " << params._exaggeration_factor << ", exaggeration iterations: " << params._remove_exaggeration_iter << ", exaggeration decay iter: " << params._exponential_decay_iter << ", theta: " << theta << ", threads: " << numParallelThreads();
+        }
+    };
+
+    auto initFFTCPUTSNE = [this]() {
+        if (!_fftCPU_tSNE.isInitialized())
+        {
+            auto params = tsneParameters();
+
+            _fftCPU_tSNE.initializeWithJointProbabilityDistribution(_jointProbabilityDistribution, &_embedding, params);
+
+            qDebug() << "t-SNE (CPU, FFT-accelerated interpolation): Exaggeration factor: " << params._exaggeration_factor << ", exaggeration iterations: " << params._remove_exaggeration_iter << ", exaggeration decay iter: " << params._exponential_decay_iter << ", threads: " << numParallelThreads();
+        }
+    };
+
+    auto initTSNE = [this, initGPUTSNE, initCPUTSNE, initParallelCPUTSNE, initFFTCPUTSNE, updateEmbedding]() {
         double t_init = 0.0;
         {
             hdi::utils::ScopedTimer<double> timer(t_init);
 
-            if (_tsneParameters.getGradientDescentType() == GradientDescentType::GPU)
-                initGPUTSNE();
-            else
-                initCPUTSNE();
+            switch (_tsneParameters.getGradientDescentType())
+            {
+            case GradientDescentType::GPU: initGPUTSNE(); break;
+            case GradientDescentType::CPU: initCPUTSNE(); break;
+            case GradientDescentType::CPU_PARALLEL: initParallelCPUTSNE(); break;
+            case GradientDescentType::CPU_FFT: initFFTCPUTSNE(); break;
+            }
 
-            updateEmbedding(_outEmbedding);
+            updateEmbedding();
         }
         qDebug() << "tSNE: Init t-SNE " << t_init / 1000 << " seconds.";
     };
 
     auto singleTSNEIteration = [this]() {
-        if (_tsneParameters.getGradientDescentType() == GradientDescentType::GPU)
-            _GPGPU_tSNE.doAnIteration();
-        else
-            _CPU_tSNE.doAnIteration();
+        switch (_tsneParameters.getGradientDescentType())
+        {
+        case GradientDescentType::GPU: _GPGPU_tSNE.doAnIteration(); break;
+        case GradientDescentType::CPU: _CPU_tSNE.doAnIteration(); break;
+        case GradientDescentType::CPU_PARALLEL: _parallelCPU_tSNE.doAnIteration(); break;
+        case GradientDescentType::CPU_FFT: _fftCPU_tSNE.doAnIteration(); break;
+        }
     };
 
     auto gradientDescentCleanup = [this]() {
         if (_tsneParameters.getGradientDescentType() == GradientDescentType::GPU)
             _offscreenBuffer->releaseContext();
         else
-            return; // Nothing to do for CPU implementation
+            return; // Nothing to do for CPU implementations
     };
 
     _tasks->getInitializeTsneTask().setRunning();
@@ -308,85 +694,115 @@ void TsneWorker::computeGradientDescent(uint32_t iterations)
     const auto beginIteration = _currentIteration;
     const auto endIteration = beginIteration + iterations;
 
+    auto& gradientDescentTask = _tasks->getComputeGradientDescentTask();
+
     double elapsed = 0;
-    double t_grad = 0;
     {
         qDebug() << "tSNE: Computing " << endIteration - beginIteration << " gradient descent iterations...";
 
-        _tasks->getComputeGradientDescentTask().setRunning();
-        _tasks->getComputeGradientDescentTask().setSubtasks(iterations);
+        gradientDescentTask.setRunning();
+        gradientDescentTask.setProgress(0.f);
+
+        // Progress is reported in batches, per-iteration task updates would dominate small embeddings
+        const auto progressInterval = std::chrono::milliseconds(100);
+        auto lastProgressUpdate = std::chrono::steady_clock::now();
 
-        int currentStepIndex = 0;
+        {
+            hdi::utils::ScopedTimer<double> timer(elapsed);
 
-        // Performs gradient descent for every iteration
-        for (_currentIteration = beginIteration; _currentIteration < endIteration; ++_currentIteration) {
+            // Performs gradient descent for every iteration
+            for (_currentIteration = beginIteration; _currentIteration < endIteration; ++_currentIteration) {
 
-            _tasks->getComputeGradientDescentTask().setSubtaskStarted(currentStepIndex);
+                // Perform t-SNE iteration
+                singleTSNEIteration();
 
-            hdi::utils::ScopedTimer<double> timer(t_grad);
+                scheduleEmbeddingUpdate();
 
-            // Perform t-SNE iteration
-            singleTSNEIteration();
+                // React to requests to stop
+                if (_control.isStopRequested())
+                    break;
 
-            if (_currentIteration > 0 && _tsneParameters.getUpdateCore() > 0 && _currentIteration % _tsneParameters.getUpdateCore() == 0)
-                updateEmbedding(_outEmbedding);
+                // Hold while paused, the gradient descent state (and GPU context) stays as is so resuming needs no re-initialization
+                if (_control.isPauseRequested())
+                {
+                    const auto numComputed = _currentIteration + 1 - beginIteration;
 
-            if (t_grad > 1000)
-                qDebug() << "Time: " << t_grad;
+                    updateEmbedding();
+                    gradientDescentTask.setProgress(static_cast<float>(numComputed) / iterations, QString("Paused at iteration %1 of %2").arg(numComputed).arg(iterations));
 
-            elapsed += t_grad;
+                    qDebug() << "tSNE: Paused at iteration " << _currentIteration + 1;
 
-            // React to requests to stop
-            if (_shouldStop)
-                break;
-            
-            _tasks->getComputeGradientDescentTask().setSubtaskFinished(currentStepIndex);
+                    if (!_control.waitWhilePaused())
+                        break;
 
-            currentStepIndex++;
+                    qDebug() << "tSNE: Resumed at iteration " << _currentIteration + 1;
+                }
 
-            QCoreApplication::processEvents();
+                const auto now = std::chrono::steady_clock::now();
+
+                if (now - lastProgressUpdate >= progressInterval)
+                {
+                    const auto numComputed = _currentIteration + 1 - beginIteration;
+                    gradientDescentTask.setProgress(static_cast<float>(numComputed) / iterations, QString("Iteration %1 of %2").arg(numComputed).arg(iterations));
+                    lastProgressUpdate = now;
+                }
+            }
         }
 
         gradientDescentCleanup();
 
-        updateEmbedding(_outEmbedding);
+        updateEmbedding();
 
-        _tasks->getComputeGradientDescentTask().setFinished();
+        gradientDescentTask.setFinished();
     }
 
+    const auto numComputed = _currentIteration - beginIteration;
+
     qDebug() << "--------------------------------------------------------------------------------";
-    qDebug() << "tSNE: Finished embedding in: " << elapsed / 1000 << " seconds, with " << _currentIteration << " total iterations (" << endIteration - beginIteration << " new iterations)";
+    qDebug() << "tSNE: Finished embedding in: " << elapsed / 1000 << " seconds, with " << _currentIteration << " total iterations (" << numComputed << " new iterations, " << (elapsed > 0 ? 1000. * numComputed / elapsed : 0.) << " iterations per second)";
     qDebug() << "================================================================================";
 
     emit finished();
 }
 
-void TsneWorker::copyEmbeddingOutput()
+TsneData TsneWorker::snapshotEmbedding()
 {
-    _outEmbedding.assign(_numPoints, _tsneParameters.getNumDimensionsOutput(), _embedding.getContainer());
+    return _embeddingSnapshots.acquire(_numPoints, _tsneParameters.getNumDimensionsOutput(), _embedding.getContainer());
 }
 
 void TsneWorker::compute()
 {
     createTasks();
 
-    connect(_parentTask, &Task::requestAbort, this, [this]() -> void { _shouldStop = true; }, Qt::DirectConnection);
+    connect(_parentTask, &Task::requestAbort, this, [this]() -> void { _control.requestStop(); }, Qt::DirectConnection);
 
-    _shouldStop = false;
+    _control.reset();
 
     double t = 0.0;
     {
         hdi::utils::ScopedTimer<double> timer(t);
 
-        if (!_hasProbabilityDistribution)
-            computeSimilarities();
+        if (_numEmbeddedPoints > 0)
+        {
+            _tasks->getInitializeOffScreenBufferTask().setEnabled(false);
+            _tasks->getInitializeTsneTask().setEnabled(false);
+
+            embedNewPoints();
+        }
+        else
+        {
+            if (!_hasProbabilityDistribution)
+                computeSimilarities();
+            else
+                computeJointProbabilityDistribution();
 
-        computeGradientDescent(_tsneParameters.getNumIterations());
+            computeGradientDescent(_tsneParameters.getNumIterations());
+        }
     }
  
     qDebug() << "t-SNE total compute time: " << t / 1000 << " seconds.";
 
-    if (_shouldStop)
+    if (_control.isStopRequested())
         _tasks->getComputeGradientDescentTask().setAborted();
     else
         _tasks->getComputeGradientDescentTask().setFinished();
@@ -402,9 +818,9 @@ void TsneWorker::continueComputation(uint32_t iterations)
     _tasks->getComputingSimilaritiesTask().setEnabled(false);
     _tasks->getInitializeTsneTask().setEnabled(false);
     
-    connect(_parentTask, &Task::requestAbort, this, [this]() -> void { _shouldStop = true; }, Qt::DirectConnection);
+    connect(_parentTask, &Task::requestAbort, this, [this]() -> void { _control.requestStop(); }, Qt::DirectConnection);
 
-    _shouldStop = false;
+    _control.reset();
 
     computeGradientDescent(iterations);
 
@@ -415,7 +831,17 @@ void TsneWorker::continueComputation(uint32_t iterations)
 
 void TsneWorker::stop()
 {
-    _shouldStop = true;
+    _control.requestStop();
+}
+
+void TsneWorker::pause()
+{
+    _control.requestPause();
+}
+
+void TsneWorker::resume()
+{
+    _control.resume();
 }
 
 TsneAnalysis::TsneAnalysis() :
@@ -427,9 +853,20 @@ TsneAnalysis::TsneAnalysis() :
 
 TsneAnalysis::~TsneAnalysis()
 {
-    _workerThread.quit();           // Signal the thread to quit gracefully
-    if (!_workerThread.wait(500))   // Wait for the thread to actually finish
-        _workerThread.terminate();  // Terminate thread after 0.5 seconds
+    // The stop request also wakes up a paused worker, the gradient descent then returns after its current iteration
+    if (_tsneWorker)
+        _tsneWorker->stop();
+
+    _workerThread.quit();
+
+    // Never terminate the thread, that could leave the GPU context or locks in an undefined state.
+    // All stages check for stop requests, only a single call into a kNN library or HDILib's initialization
+    // can hold the thread. The worker reports to tasks of the owner, so it is joined like in the HSNE plugin
+    if (!_workerThread.wait(5000))
+    {
+        qWarning() << "tSNE: Waiting for the worker thread to finish its current step...";
+        _workerThread.wait();
+    }
 
     deleteWorker();
 }
@@ -443,11 +880,11 @@ void TsneAnalysis::deleteWorker()
     }
 }
 
-void TsneAnalysis::startComputation(TsneParameters parameters, const std::vector<hdi::data::MapMemEff<uint32_t, float>>& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding, int previousIterations)
+void TsneAnalysis::startComputation(TsneParameters parameters, SharedProbDistMatrix probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding, int previousIterations)
 {
     deleteWorker();
 
-    _tsneWorker = new TsneWorker(parameters, probDist, numPoints, initEmbedding);
+    _tsneWorker = new TsneWorker(parameters, std::move(probDist), numPoints, initEmbedding);
 
     if (previousIterations >= 0)
         _tsneWorker->setCurrentIteration(previousIterations);
@@ -455,33 +892,64 @@ void TsneAnalysis::startComputation(TsneParameters parameters, const std::vector
     startComputation();
 }
 
-void TsneAnalysis::startComputation(TsneParameters parameters, std::vector<hdi::data::MapMemEff<uint32_t, float>>&& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding, int previousIterations)
+void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, const std::vector<float>& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
 {
     deleteWorker();
 
-    _tsneWorker = new TsneWorker(parameters, std::move(probDist), numPoints, initEmbedding);
+    _tsneWorker = new TsneWorker(parameters, knnParameters, data, numDimensions, initEmbedding);
+    
+    startComputation();
+}
 
-    if (previousIterations >= 0)
-        _tsneWorker->setCurrentIteration(previousIterations);
+void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
+{
+    deleteWorker();
 
+    _tsneWorker = new TsneWorker(parameters, knnParameters, std::move(data), numDimensions, initEmbedding);
+    
     startComputation();
 }
 
-void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, const std::vector<float>& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
+void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
 {
     deleteWorker();
 
-    _tsneWorker = new TsneWorker(parameters, knnParameters, data, numDimensions, initEmbedding);
-    
+    _tsneWorker = new TsneWorker(parameters, knnParameters, std::move(dataProvider), initEmbedding);
+
     startComputation();
 }
 
-void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
+void TsneAnalysis::startComputation(TsneParameters parameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, std::shared_ptr<const ProjectedData> projectedData, std::shared_ptr<const KnnIndex> knnIndex, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
 {
     deleteWorker();
 
-    _tsneWorker = new TsneWorker(parameters, knnParameters, std::move(data), numDimensions, initEmbedding);
-    
+    _tsneWorker = new TsneWorker(parameters, knnParameters, std::move(dataProvider), initEmbedding);
+    _tsneWorker->setProjectedData(std::move(projectedData));
+    _tsneWorker->setKnnIndex(std::move(knnIndex));
+
+    startComputation();
+}
+
+void TsneAnalysis::startComputation(TsneParameters parameters, std::shared_ptr<const KnnGraph> knnGraph, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding)
+{
+    deleteWorker();
+
+    _tsneWorker = new TsneWorker(parameters, std::move(knnGraph), initEmbedding);
+
+    startComputation();
+}
+
+void TsneAnalysis::embedNewPoints(TsneParameters parameters, KnnParameters knnParameters, SharedProbDistMatrix probDist, const hdi::data::Embedding<float>::scalar_vector_type& embedding, std::shared_ptr<const DataProvider> dataProvider, std::shared_ptr<const ProjectedData> projectedData, std::shared_ptr<const KnnIndex> knnIndex, int previousIterations)
+{
+    deleteWorker();
+
+    _tsneWorker = new TsneWorker(parameters, knnParameters, std::move(probDist), embedding, std::move(dataProvider));
+    _tsneWorker->setProjectedData(std::move(projectedData));
+    _tsneWorker->setKnnIndex(std::move(knnIndex));
+
+    if (previousIterations >= 0)
+        _tsneWorker->setCurrentIteration(previousIterations);
+
     startComputation();
 }
 
@@ -495,6 +963,18 @@ void TsneAnalysis::continueComputation(int iterations)
     emit continueWorker(iterations);
 }
 
+void TsneAnalysis::pauseComputation()
+{
+    if (_tsneWorker)
+        _tsneWorker->pause();
+}
+
+void TsneAnalysis::resumeComputation()
+{
+    if (_tsneWorker)
+        _tsneWorker->resume();
+}
+
 void TsneAnalysis::stopComputation()
 {
     emit stopWorker();  // to _workerThread in Thread
@@ -527,7 +1007,10 @@ void TsneAnalysis::startComputation()
     connect(this, &TsneAnalysis::stopWorker, _tsneWorker, &TsneWorker::stop, Qt::DirectConnection);
 
     // From-Worker signals
-    connect(_tsneWorker, &TsneWorker::embeddingUpdate, this, &TsneAnalysis::embeddingUpdate);
+    connect(_tsneWorker, &TsneWorker::embeddingAvailable, this, [this, embeddingMailbox = _tsneWorker->getEmbeddingMailbox()]() -> void {
+        if (auto tsneData = embeddingMailbox->take())
+            emit embeddingUpdate(*tsneData);
+        });
     connect(_tsneWorker, &TsneWorker::finished, this, &TsneAnalysis::finished);
 
     _workerThread.start();
@@ -549,7 +1032,7 @@ TsneWorkerTasks::TsneWorkerTasks(QObject* parent, mv::Task* parentTask) :
     _computeGradientDescentTask.setParentTask(parentTask);
 
     _computeGradientDescentTask.setWeight(20.f);
-    _computeGradientDescentTask.setSubtaskNamePrefix("Compute gradient descent step");
+    _computeGradientDescentTask.setProgressMode(Task::ProgressMode::Manual);
 
     /*
     _initializeOffScreenBufferTask.moveToThread(targetThread);
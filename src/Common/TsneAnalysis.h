@@ -1,11 +1,18 @@
 #pragma once
 
+#include "BarnesHutGradientDescent.h"
+#include "DataProvider.h"
+#include "FftGradientDescent.h"
+#include "KnnGraph.h"
+#include "KnnIndex.h"
 #include "KnnParameters.h"
+#include "PcaProjection.h"
+#include "SharedProbDistMatrix.h"
 #include "TsneData.h"
 #include "TsneParameters.h"
+#include "WorkerControl.h"
 
 #include "hdi/dimensionality_reduction/gradient_descent_tsne_texture.h"
-#include "hdi/dimensionality_reduction/hd_joint_probability_generator.h"
 #include "hdi/dimensionality_reduction/sparse_tsne_user_def_probabilities.h"
 #include "hdi/dimensionality_reduction/tsne_parameters.h"
 
@@ -13,13 +20,15 @@
 
 #include <QThread>
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
 class OffscreenBuffer;
 
-using ProbDistMatrix = hdi::dr::HDJointProbabilityGenerator<float>::sparse_scalar_matrix_type;
+/** Gradient descent parameters in HDILib's format */
+hdi::dr::TsneParameters toHdiTsneParameters(const TsneParameters& parameters);
 
 class TsneWorkerTasks : public QObject
 {
@@ -44,6 +53,8 @@ class TsneWorker : public QObject
 
     using GradientDescentGPU = hdi::dr::GradientDescentTSNETexture;
     using GradientDescentCPU = hdi::dr::SparseTSNEUserDefProbabilities<float>;
+    using GradientDescentCPUParallel = BarnesHutGradientDescent;
+    using GradientDescentCPUFFT = FftGradientDescent;
 
 private:
     // default construction is inaccessible to outsiders
@@ -53,10 +64,14 @@ public:
     TsneWorker(TsneParameters tsneParameters, KnnParameters knnParameters, const std::vector<float>& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
     // The tsne object will compute knn and a probablility distribution before starting the embedding, moving the input data
     TsneWorker(TsneParameters tsneParameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
-    // The tsne object expects a probDist that is not symmetrized, no knn are computed
-    TsneWorker(TsneParameters tsneParameters, const std::vector<hdi::data::MapMemEff<uint32_t, float>>& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
-    // The tsne object expects a probDist that is not symmetrized, no knn are computed, moving the probDist
-    TsneWorker(TsneParameters tsneParameters, std::vector<hdi::data::MapMemEff<uint32_t, float>>&& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
+    // The tsne object will compute knn and a probablility distribution before starting the embedding, reading the input from the provider
+    TsneWorker(TsneParameters tsneParameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
+    // The tsne object will calibrate the perplexity on the kNN graph of a previous run, which has to have at least perplexity * multiplier neighbors
+    TsneWorker(TsneParameters tsneParameters, std::shared_ptr<const KnnGraph> knnGraph, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
+    // The tsne object will place the points of dataProvider after the probDist.size() embedded ones into their fixed 2D embedding, probDist has to be the joint distribution of the embedded points
+    TsneWorker(TsneParameters tsneParameters, KnnParameters knnParameters, SharedProbDistMatrix probDist, const hdi::data::Embedding<float>::scalar_vector_type& embedding, std::shared_ptr<const DataProvider> dataProvider);
+    // The tsne object expects a probDist that is not symmetrized, no knn are computed, the probDist is shared and not copied
+    TsneWorker(TsneParameters tsneParameters, SharedProbDistMatrix probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding);
     ~TsneWorker();
 
     void createTasks();
@@ -65,31 +80,56 @@ public: // Setter
     void setParentTask(mv::Task* parentTask);
     void setInitEmbedding(const hdi::data::Embedding<float>::scalar_vector_type& initEmbedding);
     void setCurrentIteration(int currentIteration);
+    /** Index of the input (or of the embedded points when embedding new points) that is searched instead of building one, if it was built with the kNN parameters */
+    void setKnnIndex(std::shared_ptr<const KnnIndex> knnIndex);
+    /** PCA projection of the input of a previous computation that is used instead of projecting again, if it has the requested number of components */
+    void setProjectedData(std::shared_ptr<const ProjectedData> projectedData);
     void changeThread(QThread* targetThread);
 
 public: // Getter
-    ProbDistMatrix* getProbabilityDistribution() { return &_probabilityDistribution; };
+    const SharedProbDistMatrix& getProbabilityDistribution() const { return _probabilityDistribution; };
+    std::shared_ptr<const KnnGraph> getKnnGraph() const { return _knnGraph; }
+    std::shared_ptr<const KnnIndex> getKnnIndex() const { return _knnIndex; }
+    std::shared_ptr<const ProjectedData> getProjectedData() const { return _projectedData; }
     int getNumIterations() const;
     OffscreenBuffer& getOffscreenBuffer() { return *_offscreenBuffer; }
+    std::shared_ptr<TsneDataMailbox> getEmbeddingMailbox() const { return _embeddingMailbox; }
+
+public: // Control
+    /** Hold the gradient descent after the current iteration, thread-safe */
+    void pause();
+    /** Continue a paused gradient descent, thread-safe */
+    void resume();
+    bool isPaused() const { return _control.isPauseRequested(); }
 
 public slots:
     void compute();
     void continueComputation(uint32_t iterations);
+    /** Stop after the current iteration (also when paused), thread-safe */
     void stop();
 
 signals:
-    void embeddingUpdate(TsneData tsneData);
+    /** A new snapshot was posted to the (previously empty) embedding mailbox */
+    void embeddingAvailable();
     void finished();
     void aborted();
 
 private:
+    /** kNN graph of the input with the configured backend, from the disk cache if enabled and available */
+    KnnGraph computeKnnGraph(std::uint32_t numNeighbors);
+    /** Data the neighbors are searched in: the input, or its PCA projection if the kNN parameters ask for one */
+    std::shared_ptr<const DataProvider> knnInputData();
     void computeSimilarities();
+    /** Out-of-sample embedding of the points after _numEmbeddedPoints, extends the joint distribution by them, see OutOfSampleEmbedding.h */
+    void embedNewPoints();
+    /** Symmetrize a probability distribution that was handed in, see SparseMatrix::symmetrized */
+    void computeJointProbabilityDistribution();
     void computeGradientDescent(uint32_t iterations);
     
-    void copyEmbeddingOutput();
+    /** Copy the current embedding into a recycled snapshot buffer, the snapshot is shared with all receivers */
+    TsneData snapshotEmbedding();
 
     hdi::dr::TsneParameters tsneParameters();
-    hdi::dr::HDJointProbabilityGenerator<float>::Parameters probGenParameters();
 
     void resetThread();
 
@@ -99,15 +139,23 @@ private:
     int                                     _currentIteration;              /** Current iteration in the embedding / gradient descent process */
     uint32_t                                _numPoints;                     /** Data variable */
     uint32_t                                _numDimensions;                 /** Data variable */
-    std::vector<float>                      _data;                          /** High-dimensional input data */
-    ProbDistMatrix                          _probabilityDistribution;       /** High-dimensional probability distribution encoding point similarities */
+    uint32_t                                _numEmbeddedPoints;             /** Points with a fixed position when embedding new points, 0 otherwise */
+    std::shared_ptr<const DataProvider>     _dataProvider;                  /** High-dimensional input data, released once the similarities are computed */
+    std::shared_ptr<const KnnGraph>         _knnGraph;                      /** kNN graph of the input, kept so that another perplexity only needs the calibration */
+    std::shared_ptr<const KnnIndex>         _knnIndex;                      /** Approximate index of the input, kept for other numbers of neighbors and new points */
+    std::shared_ptr<const ProjectedData>    _projectedData;                 /** PCA projection of the input, kept for other kNN searches */
+    SharedProbDistMatrix                    _probabilityDistribution;       /** High-dimensional probability distribution encoding point similarities, shared with the caller */
+    std::shared_ptr<const SparseMatrix>     _jointProbabilityDistribution;  /** Symmetric joint distribution for the gradient descent, shares _probabilityDistribution unless that was handed in */
     bool                                    _hasProbabilityDistribution;    /** Check if the worker was initialized with a probability distribution or data */
     GradientDescentGPU                       _GPGPU_tSNE;                   /** GPGPU t-SNE gradient descent implementation */
     GradientDescentCPU                       _CPU_tSNE;                     /** CPU t-SNE gradient descent implementation */
+    GradientDescentCPUParallel               _parallelCPU_tSNE;             /** Multi-threaded CPU t-SNE gradient descent implementation */
+    GradientDescentCPUFFT                    _fftCPU_tSNE;                  /** FFT-accelerated CPU t-SNE gradient descent implementation */
     hdi::data::Embedding<float>             _embedding;                     /** Storage of current embedding */
-    TsneData                                _outEmbedding;                  /** Transfer embedding data array */
+    TsneDataPool                            _embeddingSnapshots;            /** Recycled buffers of the embedding snapshots handed to the UI */
+    std::shared_ptr<TsneDataMailbox>        _embeddingMailbox;              /** Coalescing hand-off of embedding snapshots to the UI */
     OffscreenBuffer*                        _offscreenBuffer;               /** Offscreen OpenGL buffer required to run the gradient descent */
-    bool                                    _shouldStop;                    /** Termination flags */
+    WorkerControl                           _control;                       /** Stop and pause requests, set from other threads */
 
 private: 
     mv::Task*                               _parentTask;                    /** Task: parent */
@@ -123,16 +171,25 @@ public:
 
 public: // Interactions
     
-    // Compute embedding based on pre-computed similarites
-    void startComputation(TsneParameters parameters, const std::vector<hdi::data::MapMemEff<uint32_t, float>>& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr, int iterations = -1);
-    // Compute embedding based on pre-computed similarites, moves the input probDist
-    void startComputation(TsneParameters parameters, std::vector<hdi::data::MapMemEff<uint32_t, float>>&& probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr, int iterations = -1);
+    // Compute embedding based on pre-computed similarites, the probDist is shared with the worker and never copied
+    void startComputation(TsneParameters parameters, SharedProbDistMatrix probDist, uint32_t numPoints, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr, int iterations = -1);
+    // Compute similarities from the kNN graph of a previous computation (no aknn search) and embedding
+    void startComputation(TsneParameters parameters, std::shared_ptr<const KnnGraph> knnGraph, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr);
     // Compute similarities (aknn search) and embedding
     void startComputation(TsneParameters parameters, KnnParameters knnParameters, const std::vector<float>& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr);
     // Compute similarities (aknn search) and embedding, moves the input data
     void startComputation(TsneParameters parameters, KnnParameters knnParameters, std::vector<float>&& data, uint32_t numDimensions, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr);
+    // Compute similarities (aknn search) and embedding, reads the input data from the provider in the worker thread
+    void startComputation(TsneParameters parameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr);
+    // Compute similarities and embedding, using the PCA projection and index of a previous computation instead of computing them again if they match the kNN parameters
+    void startComputation(TsneParameters parameters, KnnParameters knnParameters, std::shared_ptr<const DataProvider> dataProvider, std::shared_ptr<const ProjectedData> projectedData, std::shared_ptr<const KnnIndex> knnIndex, const hdi::data::Embedding<float>::scalar_vector_type* initEmbedding = nullptr);
     
+    // Place points that were appended to the data into the fixed embedding of the first probDist.size() points, continuing afterwards refines all points
+    void embedNewPoints(TsneParameters parameters, KnnParameters knnParameters, SharedProbDistMatrix probDist, const hdi::data::Embedding<float>::scalar_vector_type& embedding, std::shared_ptr<const DataProvider> dataProvider, std::shared_ptr<const ProjectedData> projectedData, std::shared_ptr<const KnnIndex> knnIndex, int previousIterations);
+
     void continueComputation(int previousIterations);
+    void pauseComputation();
+    void resumeComputation();
     void stopComputation();
 
 public: // Setter
@@ -141,9 +198,16 @@ public: // Setter
 
 public: // Getter
     int getNumIterations() const { return (_tsneWorker) ? _tsneWorker->getNumIterations() : -1; };
+    bool isPaused() const { return (_tsneWorker) ? _tsneWorker->isPaused() : false; };
     bool canContinue() const { return (_tsneWorker) ? _tsneWorker->getNumIterations() >= 1 : false; };
-    std::optional<ProbDistMatrix*> getProbabilityDistribution() { return (_tsneWorker) ? std::optional<ProbDistMatrix*>(_tsneWorker->getProbabilityDistribution()) : std::nullopt; };
-    const std::optional<ProbDistMatrix*> getProbabilityDistribution() const { return (_tsneWorker) ? std::optional<ProbDistMatrix*>(_tsneWorker->getProbabilityDistribution()) : std::nullopt; };
+    /** Shared handle to the probability distribution of the current worker, null if there is none */
+    SharedProbDistMatrix getProbabilityDistribution() const { return (_tsneWorker) ? _tsneWorker->getProbabilityDistribution() : SharedProbDistMatrix(); };
+    /** kNN graph computed by the current worker, null if there is none */
+    std::shared_ptr<const KnnGraph> getKnnGraph() const { return (_tsneWorker) ? _tsneWorker->getKnnGraph() : nullptr; };
+    /** Approximate index built or used by the current worker, null if there is none */
+    std::shared_ptr<const KnnIndex> getKnnIndex() const { return (_tsneWorker) ? _tsneWorker->getKnnIndex() : nullptr; };
+    /** PCA projection of the input computed or used by the current worker, null if there is none */
+    std::shared_ptr<const ProjectedData> getProjectedData() const { return (_tsneWorker) ? _tsneWorker->getProjectedData() : nullptr; };
 
 private: // Internal
     void startComputation();
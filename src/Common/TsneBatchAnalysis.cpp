@@ -0,0 +1,243 @@
+#include "TsneBatchAnalysis.h"
+
+#include "BarnesHutGradientDescent.h"
+#include "FftGradientDescent.h"
+#include "ParallelUtils.h"
+#include "TsneAnalysis.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include <QDebug>
+#include <QMetaObject>
+#include <QThread>
+
+#include "hdi/utils/scoped_timers.h"
+
+struct TsneBatchAnalysis::Run
+{
+    TsneParameters                          parameters;             /** Parameters of this run */
+    std::unique_ptr<CpuGradientDescent>     gradientDescent;        /** Gradient descent implementation */
+    CpuGradientDescent::Embedding           embedding;              /** Embedding that is optimized */
+    TsneDataPool                            embeddingSnapshots;     /** Recycled buffers of the embedding snapshots */
+    std::shared_ptr<TsneDataMailbox>        embeddingMailbox = std::make_shared<TsneDataMailbox>();    /** Coalescing hand-off of snapshots to the UI */
+    std::atomic<int>                        numIterations = 0;      /** Computed iterations */
+};
+
+TsneBatchAnalysis::TsneBatchAnalysis() :
+    _jointProbabilities(),
+    _runs(),
+    _control(),
+    _numActiveRuns(0),
+    _threadPool()
+{
+    qRegisterMetaType<TsneData>();
+}
+
+TsneBatchAnalysis::~TsneBatchAnalysis()
+{
+    _control.requestStop();
+    _threadPool.waitForDone();
+}
+
+bool TsneBatchAnalysis::supportsGradientDescentType(GradientDescentType type)
+{
+    return type == GradientDescentType::CPU_PARALLEL || type == GradientDescentType::CPU_FFT;
+}
+
+bool TsneBatchAnalysis::startComputation(const std::vector<TsneParameters>& runParameters, const SparseMatrix::MapMemEffMatrix& probDist, uint32_t numPoints, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding)
+{
+    assert(probDist.size() == numPoints);
+
+    return startComputation(runParameters, std::make_shared<const SparseMatrix>(SparseMatrix::fromMapMemEff(probDist).symmetrized()), initEmbedding);
+}
+
+bool TsneBatchAnalysis::startComputation(const std::vector<TsneParameters>& runParameters, const SharedProbDistMatrix& probDist, uint32_t numPoints, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding)
+{
+    assert(probDist.size() == numPoints);
+
+    return startComputation(runParameters, std::make_shared<const SparseMatrix>(probDist->symmetrized()), initEmbedding);
+}
+
+bool TsneBatchAnalysis::startComputation(const std::vector<TsneParameters>& runParameters, std::shared_ptr<const SparseMatrix> jointProbabilities, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding)
+{
+    assert(jointProbabilities != nullptr);
+
+    // GPU and single-threaded CPU runs would each need their own thread, context or copy of the distribution
+    for (const auto& parameters : runParameters)
+    {
+        if (!supportsGradientDescentType(parameters.getGradientDescentType()))
+        {
+            qWarning() << "tSNE batch: Only the multi-threaded CPU gradient descents (Barnes-Hut or FFT) can be computed concurrently, no run is started.";
+            return false;
+        }
+    }
+
+    // The runs of a previous batch use _runs until they returned, also after a stop request
+    if (isRunning())
+    {
+        qWarning() << "tSNE batch: The previous batch is still running, no run is started.";
+        return false;
+    }
+
+    _jointProbabilities = std::move(jointProbabilities);
+    _runs.clear();
+
+    if (runParameters.empty())
+        return true;
+
+    const auto numPoints = _jointProbabilities->getNumRows();
+
+    for (const auto& parameters : runParameters)
+    {
+        auto run = std::make_unique<Run>();
+
+        run->parameters = parameters;
+        run->embedding  = { 2, numPoints };
+
+        if (initEmbedding)
+        {
+            assert(initEmbedding->size() == 2ull * numPoints);
+            run->embedding.getContainer() = *initEmbedding;
+            run->parameters.setPresetEmbedding(true);
+        }
+
+        if (parameters.getNumDimensionsOutput() != 2)
+        {
+            qWarning() << "tSNE batch: Only 2D embeddings are supported, computing a 2D embedding instead.";
+            run->parameters.setNumDimensionsOutput(2);
+        }
+
+        if (parameters.getGradientDescentType() == GradientDescentType::CPU_FFT)
+        {
+            run->gradientDescent = std::make_unique<FftGradientDescent>();
+        }
+        else
+        {
+            auto barnesHut = std::make_unique<BarnesHutGradientDescent>();
+            barnesHut->setTheta(std::min(0.5, std::max(0.0, (numPoints - 1000.0) * 0.00005)));
+            run->gradientDescent = std::move(barnesHut);
+        }
+
+        _runs.push_back(std::move(run));
+    }
+
+    // Run as many embeddings at once as there are threads, and split the threads among them
+    const int numRuns           = static_cast<int>(_runs.size());
+    const int numThreads        = std::max(1, QThread::idealThreadCount());
+    const int numConcurrentRuns = std::min(numRuns, numThreads);
+    const int numThreadsPerRun  = std::max(1, numThreads / numConcurrentRuns);
+
+    _threadPool.setMaxThreadCount(numConcurrentRuns);
+
+    _control.reset();
+    _numActiveRuns.store(numRuns, std::memory_order_release);
+
+    qDebug() << "tSNE batch: Computing " << numRuns << " embeddings of " << numPoints << " points, " << numConcurrentRuns << " at once with " << numThreadsPerRun << " threads each."
+             << " Shared joint probabilities: " << _jointProbabilities->getNumNonZeros() << " non-zeros";
+
+    emit started();
+
+    for (int runIndex = 0; runIndex < numRuns; runIndex++)
+        _threadPool.start([this, runIndex, numThreadsPerRun]() { computeRun(runIndex, numThreadsPerRun); });
+
+    return true;
+}
+
+void TsneBatchAnalysis::stopComputation()
+{
+    // Does not wait, the runs return after their current iteration and the last one reports aborted()
+    if (isRunning())
+        _control.requestStop();
+}
+
+int TsneBatchAnalysis::getNumIterations(int run) const
+{
+    assert(run >= 0 && run < getNumRuns());
+    return _runs[run]->numIterations.load(std::memory_order_relaxed);
+}
+
+void TsneBatchAnalysis::computeRun(int runIndex, int numThreads)
+{
+    auto& run = *_runs[runIndex];
+
+    setNumParallelThreads(numThreads);
+
+    double elapsed = 0;
+    {
+        hdi::utils::ScopedTimer<double> timer(elapsed);
+
+        // A run that is stopped before its initialization has no embedding to publish
+        const bool initialized = !_control.isStopRequested();
+
+        if (initialized)
+        {
+            run.gradientDescent->initializeWithJointProbabilityDistribution(_jointProbabilities, &run.embedding, toHdiTsneParameters(run.parameters));
+
+            publishEmbedding(runIndex);
+        }
+
+        const int numIterations = run.parameters.getNumIterations();
+        const int updateCore    = run.parameters.getUpdateCore();
+        const auto interval     = std::chrono::milliseconds(run.parameters.getUpdateInterval());
+
+        auto lastEmbeddingUpdate = std::chrono::steady_clock::now();
+
+        for (int iteration = 0; initialized && iteration < numIterations; iteration++)
+        {
+            if (_control.isStopRequested())
+                break;
+
+            run.gradientDescent->doAnIteration();
+            run.numIterations.store(iteration + 1, std::memory_order_relaxed);
+
+            // Same throttling as the single analysis: every updateCore iterations, at most once per interval, never while the UI is behind
+            if (updateCore > 0 && (iteration + 1) % updateCore == 0 && !run.embeddingMailbox->isPending())
+            {
+                const auto now = std::chrono::steady_clock::now();
+
+                if (now - lastEmbeddingUpdate >= interval)
+                {
+                    publishEmbedding(runIndex);
+                    lastEmbeddingUpdate = now;
+                }
+            }
+        }
+
+        if (initialized)
+            publishEmbedding(runIndex);
+    }
+
+    qDebug() << "tSNE batch: Run " << runIndex << " computed " << run.numIterations.load() << " iterations in " << elapsed / 1000 << " seconds";
+
+    // Read before this run is counted as finished, a new batch may reset the control afterwards
+    const bool stopped = _control.isStopRequested();
+    const bool isLastRun = _numActiveRuns.fetch_sub(1, std::memory_order_acq_rel) == 1;
+
+    QMetaObject::invokeMethod(this, [this, runIndex, isLastRun, stopped]() {
+        emit runFinished(runIndex);
+
+        if (!isLastRun)
+            return;
+
+        if (stopped)
+            emit aborted();
+        else
+            emit finished();
+        }, Qt::QueuedConnection);
+}
+
+void TsneBatchAnalysis::publishEmbedding(int runIndex)
+{
+    auto& run = *_runs[runIndex];
+
+    // A snapshot that was not taken yet is replaced, the UI thread is already notified
+    if (!run.embeddingMailbox->post(run.embeddingSnapshots.acquire(run.embedding.numDataPoints(), 2, run.embedding.getContainer())))
+        return;
+
+    QMetaObject::invokeMethod(this, [this, runIndex, embeddingMailbox = run.embeddingMailbox]() {
+        if (auto tsneData = embeddingMailbox->take())
+            emit embeddingUpdate(runIndex, *tsneData);
+        }, Qt::QueuedConnection);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CpuGradientDescent.h"
+#include "SharedProbDistMatrix.h"
+#include "SparseMatrix.h"
+#include "TsneData.h"
+#include "TsneParameters.h"
+#include "WorkerControl.h"
+
+#include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * TsneBatchAnalysis
+ *
+ * Runs several t-SNE gradient descents of the same data concurrently on a thread pool,
+ * e.g. with different seeds or exaggeration schedules. The joint probability distribution
+ * is converted once and all runs share this single immutable copy.
+ *
+ * The runs use the multi-threaded CPU gradient descents (CPU_PARALLEL or CPU_FFT), a batch with other
+ * gradient descent types is rejected. The available threads are divided between the concurrent runs.
+ */
+class TsneBatchAnalysis : public QObject
+{
+    Q_OBJECT
+
+public:
+    TsneBatchAnalysis();
+    ~TsneBatchAnalysis() override;
+
+public: // Interactions
+
+    // Whether runs with this gradient descent type can be computed in a batch
+    static bool supportsGradientDescentType(GradientDescentType type);
+
+    // All start functions return false without starting anything if a run asks for an unsupported gradient descent type
+    // or if the runs of a previous batch did not return yet
+
+    // Compute one embedding per parameter set based on pre-computed, not symmetrized similarities, e.g. an HSNE transition matrix
+    bool startComputation(const std::vector<TsneParameters>& runParameters, const SparseMatrix::MapMemEffMatrix& probDist, uint32_t numPoints, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding = nullptr);
+    // Compute one embedding per parameter set based on the distribution of a t-SNE analysis, symmetrized like TsneAnalysis does
+    bool startComputation(const std::vector<TsneParameters>& runParameters, const SharedProbDistMatrix& probDist, uint32_t numPoints, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding = nullptr);
+    // Compute one embedding per parameter set based on a symmetric joint probability distribution, which is shared as is
+    bool startComputation(const std::vector<TsneParameters>& runParameters, std::shared_ptr<const SparseMatrix> jointProbabilities, const CpuGradientDescent::Embedding::scalar_vector_type* initEmbedding = nullptr);
+
+    /** Request all runs to stop after their current iteration, returns immediately, aborted() follows once the last run returned */
+    void stopComputation();
+
+public: // Getter
+    int getNumRuns() const { return static_cast<int>(_runs.size()); }
+    bool isRunning() const { return _numActiveRuns.load(std::memory_order_acquire) > 0; }
+    /** Number of computed iterations of a run, safe to call while running */
+    int getNumIterations(int run) const;
+    std::shared_ptr<const SparseMatrix> getJointProbabilities() const { return _jointProbabilities; }
+
+signals:
+    void embeddingUpdate(int run, const TsneData tsneData);
+    void runFinished(int run);
+    void started();
+    void finished();
+    void aborted();
+
+private:
+    struct Run;
+
+    /** Gradient descent of a single run, executed in a pool thread */
+    void computeRun(int runIndex, int numThreads);
+
+    /** Hand a snapshot of the run's embedding to the UI thread */
+    void publishEmbedding(int runIndex);
+
+private:
+    std::shared_ptr<const SparseMatrix>     _jointProbabilities;    /** Symmetric joint probabilities, shared by all runs */
+    std::vector<std::unique_ptr<Run>>       _runs;                  /** Per-run state */
+    WorkerControl                           _control;               /** Stop requests for all runs */
+    std::atomic<int>                        _numActiveRuns;         /** Runs that did not finish yet */
+    QThreadPool                             _threadPool;            /** Executes the runs, destroyed (and joined) first */
+};
@@ -12,26 +12,44 @@ TsneComputationAction::TsneComputationAction(GroupAction* parent, TsneParameters
     WidgetAction(parent, "TsneComputationAction"),
     _numIterationsAction(this, "New iterations", 0, 10000, 1000),
     _numberOfComputatedIterationsAction(this, "Computed iterations", 0, std::numeric_limits<int>::max(), 0),
-    _updateIterationsAction(this, "Core update every", 0, 10000, 10),
+    _updateIterationsAction(this, "Core update every", 0, 10000, 1),
+    _updateIntervalAction(this, "Core update interval", 0, 10000, 50),
     _startComputationAction(this, "Start"),
     _continueComputationAction(this, "Continue"),
+    _embedNewPointsAction(this, "Embed new points"),
+    _numSeedVariantsAction(this, "Seed variants", 2, 16, 4),
+    _computeSeedVariantsAction(this, "Compute seed variants"),
     _stopComputationAction(this, "Stop"),
+    _pauseComputationAction(this, "Pause"),
     _runningAction(this, "Running"),
     _tsneParameters(tsneParameters)
 {
     _numIterationsAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _numberOfComputatedIterationsAction.setDefaultWidgetFlags(IntegralAction::LineEdit);
     _updateIterationsAction.setDefaultWidgetFlags(IntegralAction::SpinBox | IntegralAction::Slider);
+    _updateIntervalAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
+    _updateIntervalAction.setSuffix(" ms");
+    _numSeedVariantsAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
 
     _updateIterationsAction.setToolTip("Update the dataset every x iterations. If set to 0, there will be no intermediate result.");
+    _updateIntervalAction.setToolTip("Minimum time between two updates of the dataset in milliseconds.\nUpdates are skipped while the previous one is still being processed.");
     _numIterationsAction.setToolTip("Number of new iterations that will be computed when pressing start or continue.");
     _numberOfComputatedIterationsAction.setToolTip("Number of iterations that have already been computed.");
     _startComputationAction.setToolTip("Start the tSNE computation");
     _continueComputationAction.setToolTip("Continue with the tSNE computation");
+    _embedNewPointsAction.setToolTip("Place the points that were added to the input data since the computation into the current embedding.\nThe embedded points keep their positions, continuing afterwards refines all points.");
+    _numSeedVariantsAction.setToolTip("Number of embeddings that are computed when pressing compute seed variants.");
+    _computeSeedVariantsAction.setToolTip("Compute embeddings with the next random seeds concurrently, each in its own derived dataset.\nAll of them share the probability distribution of the current computation.\nOnly available for the multi-threaded CPU gradient descents (Barnes-Hut and FFT).");
     _stopComputationAction.setToolTip("Stop the current tSNE computation");
+    _pauseComputationAction.setToolTip("Pause the current tSNE computation, uncheck to resume it where it was paused");
 
     _numberOfComputatedIterationsAction.setEnabled(false);
 
+    // Only the t-SNE analysis can embed new points and compute seed variants, it shows the actions
+    _embedNewPointsAction.setVisible(false);
+    _numSeedVariantsAction.setVisible(false);
+    _computeSeedVariantsAction.setVisible(false);
+
     if (_tsneParameters)
     {
         const auto updateNumIterations = [this]() -> void {
@@ -50,8 +68,17 @@ TsneComputationAction::TsneComputationAction(GroupAction* parent, TsneParameters
             updateUpdateIterations();
             });
 
+        const auto updateUpdateInterval = [this]() -> void {
+            _tsneParameters->setUpdateInterval(_updateIntervalAction.getValue());
+            };
+
+        connect(&_updateIntervalAction, &IntegralAction::valueChanged, this, [this, updateUpdateInterval](int32_t val) {
+            updateUpdateInterval();
+            });
+
         updateNumIterations();
         updateUpdateIterations();
+        updateUpdateInterval();
     }
 }
 
@@ -59,9 +86,14 @@ void TsneComputationAction::setReadOnly(bool readonly)
 {
     _numIterationsAction.setEnabled(readonly);
     _updateIterationsAction.setEnabled(readonly);
+    _updateIntervalAction.setEnabled(readonly);
     _startComputationAction.setEnabled(readonly);
     _continueComputationAction.setEnabled(readonly);
+    _embedNewPointsAction.setEnabled(readonly);
+    _numSeedVariantsAction.setEnabled(readonly);
+    _computeSeedVariantsAction.setEnabled(readonly);
     _stopComputationAction.setEnabled(readonly);
+    _pauseComputationAction.setEnabled(readonly);
 }
 
 void TsneComputationAction::addActions() 
@@ -74,9 +106,14 @@ void TsneComputationAction::addActions()
 
     parentAction->addAction(&_numIterationsAction);
     parentAction->addAction(&_numberOfComputatedIterationsAction);
+    parentAction->addAction(&_updateIntervalAction);
+    parentAction->addAction(&_numSeedVariantsAction);
 
     buttonGroup->addAction(&_startComputationAction);
     buttonGroup->addAction(&_continueComputationAction);
+    buttonGroup->addAction(&_embedNewPointsAction);
+    buttonGroup->addAction(&_computeSeedVariantsAction);
+    buttonGroup->addAction(&_pauseComputationAction);
     buttonGroup->addAction(&_stopComputationAction);
 
     parentAction->addAction(buttonGroup);
@@ -88,6 +125,9 @@ QMenu* TsneComputationAction::getContextMenu(QWidget* parent /*= nullptr*/)
 
     menu->addAction(&_startComputationAction);
     menu->addAction(&_continueComputationAction);
+    menu->addAction(&_embedNewPointsAction);
+    menu->addAction(&_computeSeedVariantsAction);
+    menu->addAction(&_pauseComputationAction);
     menu->addAction(&_stopComputationAction);
 
     return menu;
@@ -100,9 +140,14 @@ void TsneComputationAction::fromVariantMap(const QVariantMap& variantMap)
     _numIterationsAction.fromParentVariantMap(variantMap);
     _numberOfComputatedIterationsAction.fromParentVariantMap(variantMap);
     _updateIterationsAction.fromParentVariantMap(variantMap);
+    _updateIntervalAction.fromParentVariantMap(variantMap);
     _startComputationAction.fromParentVariantMap(variantMap);
     _continueComputationAction.fromParentVariantMap(variantMap);
+    _embedNewPointsAction.fromParentVariantMap(variantMap);
+    _numSeedVariantsAction.fromParentVariantMap(variantMap);
+    _computeSeedVariantsAction.fromParentVariantMap(variantMap);
     _stopComputationAction.fromParentVariantMap(variantMap);
+    _pauseComputationAction.fromParentVariantMap(variantMap);
     _runningAction.fromParentVariantMap(variantMap);
 }
 
@@ -113,9 +158,14 @@ QVariantMap TsneComputationAction::toVariantMap() const
     _numIterationsAction.insertIntoVariantMap(variantMap);
     _numberOfComputatedIterationsAction.insertIntoVariantMap(variantMap);
     _updateIterationsAction.insertIntoVariantMap(variantMap);
+    _updateIntervalAction.insertIntoVariantMap(variantMap);
     _startComputationAction.insertIntoVariantMap(variantMap);
     _continueComputationAction.insertIntoVariantMap(variantMap);
+    _embedNewPointsAction.insertIntoVariantMap(variantMap);
+    _numSeedVariantsAction.insertIntoVariantMap(variantMap);
+    _computeSeedVariantsAction.insertIntoVariantMap(variantMap);
     _stopComputationAction.insertIntoVariantMap(variantMap);
+    _pauseComputationAction.insertIntoVariantMap(variantMap);
     _runningAction.insertIntoVariantMap(variantMap);
 
     return variantMap;
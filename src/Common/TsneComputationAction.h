@@ -46,9 +46,14 @@ public: // Action getters
     IntegralAction& getNumIterationsAction() { return _numIterationsAction; };
     IntegralAction& getNumberOfComputedIterationsAction() { return _numberOfComputatedIterationsAction; };
     IntegralAction& getUpdateIterationsAction() { return _updateIterationsAction; };
+    IntegralAction& getUpdateIntervalAction() { return _updateIntervalAction; };
     TriggerAction& getStartComputationAction() { return _startComputationAction; }
     TriggerAction& getContinueComputationAction() { return _continueComputationAction; }
+    TriggerAction& getEmbedNewPointsAction() { return _embedNewPointsAction; }
+    IntegralAction& getNumSeedVariantsAction() { return _numSeedVariantsAction; }
+    TriggerAction& getComputeSeedVariantsAction() { return _computeSeedVariantsAction; }
     TriggerAction& getStopComputationAction() { return _stopComputationAction; }
+    ToggleAction& getPauseComputationAction() { return _pauseComputationAction; }
     ToggleAction& getRunningAction() { return _runningAction; }
 
 public: // Serialization
@@ -69,10 +74,15 @@ private:
     IntegralAction          _numIterationsAction;                   /** Number of iterations action */
     IntegralAction          _numberOfComputatedIterationsAction;    /** Number of computed iterations action */
     IntegralAction          _updateIterationsAction;                /** Number of update iterations (copying embedding to ManiVault core) */
+    IntegralAction          _updateIntervalAction;                  /** Minimum time in ms between updates (copying embedding to ManiVault core) */
 
     TriggerAction           _startComputationAction;                /** Start computation action */
     TriggerAction           _continueComputationAction;             /** Continue computation action */
+    TriggerAction           _embedNewPointsAction;                  /** Place points that were added to the input into the current embedding */
+    IntegralAction          _numSeedVariantsAction;                 /** Number of embeddings computed by the seed variants action */
+    TriggerAction           _computeSeedVariantsAction;             /** Compute embeddings with other seeds concurrently, from the current distribution */
     TriggerAction           _stopComputationAction;                 /** Stop computation action */
+    ToggleAction            _pauseComputationAction;                /** Pause/resume computation action */
 
     ToggleAction            _runningAction;                         /** Running action */
 
@@ -1,30 +1,38 @@
 #pragma once
 
-#include <QObject>
+#include <PointData/PointData.h>
+
 #include <QMetaType>
 
-#include <vector>
+#include <atomic>
 #include <cassert>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
-class TsneData : public QObject
+/**
+ * TsneData
+ *
+ * Immutable, reference-counted snapshot of an embedding.
+ * Copies share the underlying data, so passing it through queued signals does not copy the embedding.
+ */
+class TsneData
 {
-    Q_OBJECT
 public:
     TsneData() :
         _numPoints(0),
-        _numDimensions(0)
+        _numDimensions(0),
+        _data()
     {
     }
 
-    TsneData(const TsneData& other)
-    {
-        _numPoints = other._numPoints;
-        _numDimensions = other._numDimensions;
-        _data = other._data;
-    }
-
-    ~TsneData()
+    TsneData(unsigned int numPoints, unsigned int numDimensions, std::shared_ptr<const std::vector<float>> data) :
+        _numPoints(numPoints),
+        _numDimensions(numDimensions),
+        _data(std::move(data))
     {
+        assert(_data == nullptr || _data->size() == static_cast<std::size_t>(numPoints) * numDimensions);
     }
 
     unsigned int getNumPoints() const
@@ -39,29 +47,134 @@ public:
 
     const std::vector<float>& getData() const
     {
-        return _data;
+        static const std::vector<float> empty;
+        return _data ? *_data : empty;
     }
 
-    // Just here because computeJointProbabilityDistribution doesn't take a const vector
-    std::vector<float>& getDataNonConst()
+    /** Shared handle to the snapshot, keeps it alive independently of this object */
+    const std::shared_ptr<const std::vector<float>>& getSharedData() const
     {
         return _data;
     }
 
     void assign(unsigned int numPoints, unsigned int numDimensions, const std::vector<float>& inputData)
     {
-        assert(inputData.size() == numPoints * numDimensions);
-        
+        assert(inputData.size() == static_cast<std::size_t>(numPoints) * numDimensions);
+
         _numPoints = numPoints;
         _numDimensions = numDimensions;
-        _data = inputData;
+        _data = std::make_shared<const std::vector<float>>(inputData);
     }
 
-private:
-    unsigned int _numPoints;
-    unsigned int _numDimensions;
+    /** Publish the snapshot into a points dataset, this is the only copy of the data on the consumer side */
+    void publishTo(Points* points) const
+    {
+        assert(points != nullptr);
+        points->setData(getData().data(), _numPoints, _numDimensions);
+    }
 
-    std::vector<float> _data;
+private:
+    unsigned int                                _numPoints;
+    unsigned int                                _numDimensions;
+    std::shared_ptr<const std::vector<float>>   _data;
 };
 
 Q_DECLARE_METATYPE(TsneData);
+
+/**
+ * TsneDataPool
+ *
+ * Recycles the buffers of embedding snapshots (triple buffering by default).
+ * A buffer is only reused once all consumers released their snapshot of it, so a snapshot
+ * is never modified after it was handed out. If all buffers are still in use a new one is allocated.
+ */
+class TsneDataPool
+{
+public:
+    explicit TsneDataPool(std::size_t numBuffers = 3) :
+        _buffers(numBuffers)
+    {
+    }
+
+    /** Copy the embedding into a free buffer and return a snapshot of it */
+    TsneData acquire(unsigned int numPoints, unsigned int numDimensions, const std::vector<float>& embedding)
+    {
+        assert(embedding.size() == static_cast<std::size_t>(numPoints) * numDimensions);
+
+        for (auto& buffer : _buffers)
+        {
+            // Only the pool holds this buffer, the acquire fence orders the consumers' last reads before our writes
+            if (buffer == nullptr || buffer.use_count() == 1)
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (buffer == nullptr)
+                    buffer = std::make_shared<std::vector<float>>();
+
+                buffer->assign(embedding.begin(), embedding.end());
+
+                return TsneData(numPoints, numDimensions, buffer);
+            }
+        }
+
+        return TsneData(numPoints, numDimensions, std::make_shared<const std::vector<float>>(embedding));
+    }
+
+    /** Drop the pool's buffers, snapshots still held by consumers stay valid */
+    void clear()
+    {
+        for (auto& buffer : _buffers)
+            buffer.reset();
+    }
+
+private:
+    std::vector<std::shared_ptr<std::vector<float>>> _buffers;     /** Recycled snapshot buffers */
+};
+
+/**
+ * TsneDataMailbox
+ *
+ * Single-slot hand-off of embedding snapshots from the worker to the UI thread.
+ * Posting while the previous snapshot was not yet taken replaces it, so at most one
+ * snapshot and one notification are ever in flight.
+ */
+class TsneDataMailbox
+{
+public:
+    /** Store the snapshot, returns true if the slot was empty and the consumer needs to be notified */
+    bool post(TsneData tsneData)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const bool wasEmpty = !_pending.load(std::memory_order_relaxed);
+
+        _tsneData = std::move(tsneData);
+        _pending.store(true, std::memory_order_release);
+
+        return wasEmpty;
+    }
+
+    /** Take the latest snapshot, empty if it was already taken */
+    std::optional<TsneData> take()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_pending.load(std::memory_order_relaxed))
+            return std::nullopt;
+
+        _pending.store(false, std::memory_order_release);
+
+        return std::move(_tsneData);
+    }
+
+    /** Whether a posted snapshot was not yet taken by the consumer */
+    bool isPending() const
+    {
+        return _pending.load(std::memory_order_acquire);
+    }
+
+private:
+    std::mutex          _mutex;             /** Guards _tsneData */
+    TsneData            _tsneData;          /** Latest posted snapshot */
+    std::atomic<bool>   _pending = false;   /** Whether _tsneData was posted but not taken */
+};
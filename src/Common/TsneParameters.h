@@ -4,6 +4,8 @@ enum class GradientDescentType
 {
     GPU,
     CPU,
+    CPU_PARALLEL,
+    CPU_FFT,
 };
 
 
@@ -13,19 +15,23 @@ public:
     TsneParameters() :
         _numIterations(1000),
         _perplexity(30),
+        _perplexityMultiplier(3),
         _exaggerationIter(250),
         _exponentialDecayIter(150),
         _numDimensionsOutput(2),
         _presetEmbedding(false),
         _exaggerationFactor(4),
-        _updateCore(10),
-        _gradientDescentType(GradientDescentType::GPU)
+        _updateCore(1),
+        _updateInterval(50),
+        _gradientDescentType(GradientDescentType::GPU),
+        _seed(-1)
     {
 
     }
 
     void setNumIterations(int numIterations) { _numIterations = numIterations; }
     void setPerplexity(int perplexity) { _perplexity = perplexity; }
+    void setPerplexityMultiplier(int perplexityMultiplier) { _perplexityMultiplier = perplexityMultiplier; }
     void setExaggerationIter(int exaggerationIter) { _exaggerationIter = exaggerationIter; }
     void setExponentialDecayIter(int exponentialDecayIter) { _exponentialDecayIter = exponentialDecayIter; }
     void setNumDimensionsOutput(int numDimensionsOutput) { _numDimensionsOutput = numDimensionsOutput; }
@@ -33,9 +39,13 @@ public:
     void setExaggerationFactor(double exaggerationFactor) { _exaggerationFactor = exaggerationFactor; }
     void setGradientDescentType(GradientDescentType gradientDescentType) { _gradientDescentType = gradientDescentType; }
     void setUpdateCore(int updateCore) { _updateCore = updateCore; }
+    void setUpdateInterval(int updateInterval) { _updateInterval = updateInterval; }
+    void setSeed(int seed) { _seed = seed; }
 
     int getNumIterations() const { return _numIterations; }
     int getPerplexity() const { return _perplexity; }
+    int getPerplexityMultiplier() const { return _perplexityMultiplier; }
+    int getNumNeighbors() const { return _perplexity * _perplexityMultiplier; }
     int getExaggerationIter() const { return _exaggerationIter; }
     int getExponentialDecayIter() const { return _exponentialDecayIter; }
     int getNumDimensionsOutput() const { return _numDimensionsOutput; }
@@ -43,16 +53,21 @@ public:
     int getExaggerationFactor() const { return _exaggerationFactor; }
     GradientDescentType getGradientDescentType() const { return _gradientDescentType; }
     int getUpdateCore() const { return _updateCore; }
+    int getUpdateInterval() const { return _updateInterval; }
+    int getSeed() const { return _seed; }
 
 private:
     int _numIterations;
     int _perplexity;
+    int _perplexityMultiplier;                    // Number of nearest neighbors per point in multiples of the perplexity, 3 as in HDILib
     int _exaggerationIter;
     int _exponentialDecayIter;
     int _numDimensionsOutput;
     double _exaggerationFactor;
     bool _presetEmbedding;
     GradientDescentType _gradientDescentType;     // Whether to use CPU or GPU gradient descent
+    int _seed;                                    // Seed of the random initial embedding, negative for a random seed
 
     int _updateCore;        // Gradient descent iterations after which the embedding data set in ManiVault's core will be updated
+    int _updateInterval;    // Minimum time in milliseconds between two updates of the embedding data set in ManiVault's core
 };
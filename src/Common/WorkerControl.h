@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * WorkerControl
+ *
+ * Stop/pause/resume requests for a worker loop running in another thread.
+ * The flags are atomics with acquire/release semantics, so polling them every iteration is lock-free.
+ * Only a paused worker blocks, on a condition variable that resume and stop requests wake up.
+ */
+class WorkerControl
+{
+public:
+    /** Ask the worker to stop as soon as possible, also wakes it up if paused */
+    void requestStop()
+    {
+        _stop.store(true, std::memory_order_release);
+        wakeUp();
+    }
+
+    /** Ask the worker to pause at the next checkpoint, its state is kept */
+    void requestPause()
+    {
+        _pause.store(true, std::memory_order_release);
+    }
+
+    /** Let a paused worker continue */
+    void resume()
+    {
+        _pause.store(false, std::memory_order_release);
+        wakeUp();
+    }
+
+    /** Clear all requests before (re)starting the worker */
+    void reset()
+    {
+        _stop.store(false, std::memory_order_release);
+        _pause.store(false, std::memory_order_release);
+    }
+
+    bool isStopRequested() const
+    {
+        return _stop.load(std::memory_order_acquire);
+    }
+
+    bool isPauseRequested() const
+    {
+        return _pause.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Block the calling (worker) thread while a pause is requested
+     * @return False if a stop was requested
+     */
+    bool waitWhilePaused()
+    {
+        if (isPauseRequested() && !isStopRequested())
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeUp.wait(lock, [this]() { return !isPauseRequested() || isStopRequested(); });
+        }
+
+        return !isStopRequested();
+    }
+
+private:
+    void wakeUp()
+    {
+        // Taking the lock orders the flag change before a waiter re-checks its predicate, so no wake-up is lost
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+
+        _wakeUp.notify_all();
+    }
+
+private:
+    std::atomic<bool>           _stop = false;      /** Stop requested */
+    std::atomic<bool>           _pause = false;     /** Pause requested */
+    std::mutex                  _mutex;             /** Guards waiting on _wakeUp */
+    std::condition_variable     _wakeUp;            /** Signals resume and stop requests to a paused worker */
+};
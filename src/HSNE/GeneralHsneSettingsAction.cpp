@@ -27,10 +27,11 @@ GeneralHsneSettingsAction::GeneralHsneSettingsAction(HsneSettingsAction& hsneSet
     _numKnnAction.setDefaultWidgetFlags(IntegralAction::SpinBox | IntegralAction::Slider);
 
     _numScalesAction.initialize(1, 10, hsneSettingsAction.getHsneParameters().getNumScales());
-    _knnAlgorithmAction.initialize(QStringList({ "FLANN", "HNSW", "ANNOY" }), "HNSW");
+    _knnAlgorithmAction.initialize(QStringList({ "FLANN", "HNSW", "ANNOY", "Exact (brute force)", "Auto" }), "HNSW");
     _distanceMetricAction.initialize(QStringList({ "Euclidean", "Cosine", "Inner Product", "Manhattan", "Hamming", "Dot" }), "Euclidean");
     _numKnnAction.initialize(3, 300, 90);
 
+    _knnAlgorithmAction.setToolTip("FLANN, HNSW and ANNOY compute approximate neighbors.\nExact (brute force) compares all points, which is fast for up to a few hundred thousand low-dimensional points.\nAuto measures the options on a sample of the data and picks the fastest accurate one, the choice is logged.");
     _publishLandmarkWeightAction.setToolTip("Create a second output dataset that stores the landmark weight\n(propotional to how many data points each landmark represents).");
     _numScalesAction.setToolTip("Number of hierarchy scales: e.g. 2 scales indicates one abstraction scale \nabove the data level, which is a scale itself.");
     _startAction.setToolTip("Initialize the HSNE hierarchy and create an embedding");
@@ -40,6 +41,13 @@ GeneralHsneSettingsAction::GeneralHsneSettingsAction(HsneSettingsAction& hsneSet
         };
 
     const auto updateKnnAlgorithm = [this]() -> void {
+        if (_knnAlgorithmAction.getCurrentText() == "Exact (brute force)")
+            _hsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::BruteForce);
+        else if (_knnAlgorithmAction.getCurrentText() == "Auto")
+            _hsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::Auto);
+        else
+            _hsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::Library);
+
         if (_knnAlgorithmAction.getCurrentText() == "FLANN")
             _hsneSettingsAction.getKnnParameters().setKnnAlgorithm(hdi::dr::knn_library::KNN_FLANN);
 
@@ -12,7 +12,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     _randomWalkLengthAction(this, "Random walk length"),
     _numWalksForAreaOfInfluenceAction(this, "#walks for aoi"),
     _minWalksRequiredAction(this, "Minimum #walks required"),
-    _useOutOfCoreComputationAction(this, "Out-of-core computation"),
     _useMonteCarloSamplingAction(this, "Use Monte Carlo sampling"),
     _seedAction(this, "Random seed"),
     _saveHierarchyToDiskAction(this, "Save hierarchy to disk"),
@@ -24,7 +23,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     addAction(&_numWalksForAreaOfInfluenceAction);
     addAction(&_minWalksRequiredAction);
     addAction(&_seedAction);
-    addAction(&_useOutOfCoreComputationAction);
     addAction(&_useMonteCarloSamplingAction);
     addAction(&_saveHierarchyToDiskAction);
     addAction(&_saveHierarchyToProjectAction);
@@ -34,7 +32,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     _randomWalkLengthAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _numWalksForAreaOfInfluenceAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _minWalksRequiredAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
-    _useOutOfCoreComputationAction.setDefaultWidgetFlags(ToggleAction::CheckBox);
     _useMonteCarloSamplingAction.setDefaultWidgetFlags(ToggleAction::CheckBox);
     _seedAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
     _saveHierarchyToDiskAction.setDefaultWidgetFlags(ToggleAction::CheckBox);
@@ -45,7 +42,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     _randomWalkLengthAction.setToolTip("Number of walks for landmark selection threshold");
     _numWalksForAreaOfInfluenceAction.setToolTip("Number of walks for area of influence");
     _minWalksRequiredAction.setToolTip("Minimum number of walks required");
-    _useOutOfCoreComputationAction.setToolTip("Use out-of-core computation");
     _useMonteCarloSamplingAction.setToolTip("Use Monte Carlo Sampling");
     _seedAction.setToolTip("Random seed for initialization");
     _saveHierarchyToDiskAction.setToolTip("Save (load) computed hierarchy to (from) disk. \nWhen computing HSNE again with the same settings, \nthe hierarchy is loaded instead of recomputed");
@@ -58,7 +54,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     _randomWalkLengthAction.initialize(1, 100, hsneParameters.getRandomWalkLength());
     _numWalksForAreaOfInfluenceAction.initialize(1, 500, hsneParameters.getNumWalksForAreaOfInfluence());
     _minWalksRequiredAction.initialize(0, 100, hsneParameters.getMinWalksRequired());
-    _useOutOfCoreComputationAction.setChecked(hsneParameters.useOutOfCoreComputation());
     _useMonteCarloSamplingAction.setChecked(hsneParameters.useMonteCarloSampling());
     _seedAction.initialize(-1000, 1000, hsneParameters.getSeed());
     _saveHierarchyToDiskAction.setChecked(hsneParameters.getSaveHierarchyToDisk());
@@ -94,10 +89,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
         _hsneSettingsAction.getHsneParameters().useMonteCarloSampling(_useMonteCarloSamplingAction.isChecked());
         };
 
-    const auto updateUseOutOfCoreComputation = [this]() -> void {
-        _hsneSettingsAction.getHsneParameters().useOutOfCoreComputation(_useOutOfCoreComputationAction.isChecked());
-    };
-
     const auto updateSaveHierarchyToDiskAction = [this]() -> void {
         _hsneSettingsAction.getHsneParameters().setSaveHierarchyToDisk(_saveHierarchyToDiskAction.isChecked());
     };
@@ -110,7 +101,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
         _randomWalkLengthAction.setEnabled(enabled);
         _numWalksForAreaOfInfluenceAction.setEnabled(enabled);
         _minWalksRequiredAction.setEnabled(enabled);
-        _useOutOfCoreComputationAction.setEnabled(enabled);
         _useMonteCarloSamplingAction.setEnabled(enabled);
         _seedAction.setEnabled(enabled);
     };
@@ -135,10 +125,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
         updateMinWalksRequired();
     });
 
-    connect(&_useOutOfCoreComputationAction, &ToggleAction::toggled, this, [this, updateUseOutOfCoreComputation]() {
-        updateUseOutOfCoreComputation();
-    });
-
     connect(&_useMonteCarloSamplingAction, &ToggleAction::toggled, this, [this, updateUseMonteCarloSampling]() {
         updateUseMonteCarloSampling();
     });
@@ -160,7 +146,6 @@ HierarchyConstructionSettingsAction::HierarchyConstructionSettingsAction(HsneSet
     updateRandomWalkLength();
     updateNumWalksForAreaOfInfluence();
     updateMinWalksRequired();
-    updateUseOutOfCoreComputation();
     updateUseMonteCarloSampling();
     updateSeed();
     updateSaveHierarchyToDiskAction();
@@ -177,7 +162,6 @@ void HierarchyConstructionSettingsAction::fromVariantMap(const QVariantMap& vari
     _numWalksForAreaOfInfluenceAction.fromParentVariantMap(variantMap);
     _minWalksRequiredAction.fromParentVariantMap(variantMap);
     _useMonteCarloSamplingAction.fromParentVariantMap(variantMap);
-    _useOutOfCoreComputationAction.fromParentVariantMap(variantMap);
     _seedAction.fromParentVariantMap(variantMap);
     _saveHierarchyToDiskAction.fromParentVariantMap(variantMap);
     _saveHierarchyToProjectAction.fromParentVariantMap(variantMap);
@@ -193,7 +177,6 @@ QVariantMap HierarchyConstructionSettingsAction::toVariantMap() const
     _numWalksForAreaOfInfluenceAction.insertIntoVariantMap(variantMap);
     _minWalksRequiredAction.insertIntoVariantMap(variantMap);
     _useMonteCarloSamplingAction.insertIntoVariantMap(variantMap);
-    _useOutOfCoreComputationAction.insertIntoVariantMap(variantMap);
     _seedAction.insertIntoVariantMap(variantMap);
     _saveHierarchyToDiskAction.insertIntoVariantMap(variantMap);
     _saveHierarchyToProjectAction.insertIntoVariantMap(variantMap);
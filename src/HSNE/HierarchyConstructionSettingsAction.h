@@ -35,7 +35,6 @@ public: // Action getters
     IntegralAction& getRandomWalkLengthAction() { return _randomWalkLengthAction; }
     IntegralAction& getNumWalksForAreaOfInfluenceAction() { return _numWalksForAreaOfInfluenceAction; }
     IntegralAction& getMinWalksRequiredAction() { return _minWalksRequiredAction; }
-    ToggleAction& getUseOutOfCoreComputationAction() { return _useOutOfCoreComputationAction; }
     ToggleAction& getUseMonteCarloSamplingAction() { return _useMonteCarloSamplingAction; }
     IntegralAction& getSeedAction() { return _seedAction; }
     ToggleAction& getSaveHierarchyToDiskAction() { return _saveHierarchyToDiskAction; }
@@ -62,7 +61,6 @@ protected:
     IntegralAction          _randomWalkLengthAction;                            /** Random walk length action */
     IntegralAction          _numWalksForAreaOfInfluenceAction;                  /** Number of walks for area of influence action */
     IntegralAction          _minWalksRequiredAction;                            /** Minimum number of walks required action */
-    ToggleAction            _useOutOfCoreComputationAction;                     /** Use out of core computation action */
     ToggleAction            _useMonteCarloSamplingAction;                       /** Use Monte Carlo sampling on/off action */
     IntegralAction          _seedAction;                                        /** Random seed action */
     ToggleAction            _saveHierarchyToDiskAction;                         /** Save computed hierarchy to disk action */
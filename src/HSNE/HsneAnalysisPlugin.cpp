@@ -44,9 +44,9 @@ HsneAnalysisPlugin::HsneAnalysisPlugin(const PluginFactory* factory) :
 
 HsneAnalysisPlugin::~HsneAnalysisPlugin()
 {
-    _hierarchyThread.quit();           // Signal the thread to quit gracefully
-    if (!_hierarchyThread.wait(500))   // Wait for the thread to actually finish
-        _hierarchyThread.terminate();  // Terminate thread after 0.5 seconds
+    _hierarchy->stop();                // Let a running hierarchy initialization stop at its next checkpoint
+    _hierarchyThread.quit();           // Signal the thread to quit once the initialization returned
+    _hierarchyThread.wait();           // Join the thread, its memory is released by then
 }
 
 void HsneAnalysisPlugin::init()
@@ -108,6 +108,10 @@ void HsneAnalysisPlugin::init()
         computationAction.getStartComputationAction().setEnabled(!isRunning);
         computationAction.getContinueComputationAction().setEnabled(!isRunning && _tsneAnalysis.canContinue());
         computationAction.getStopComputationAction().setEnabled(isRunning);
+        computationAction.getPauseComputationAction().setEnabled(isRunning);
+
+        if (!isRunning)
+            computationAction.getPauseComputationAction().setChecked(false);
     };
 
     connect(&_tsneAnalysis, &TsneAnalysis::finished, this, [this, &computationAction, updateComputationAction]() {
@@ -131,8 +135,12 @@ void HsneAnalysisPlugin::init()
 
         const int topScaleIndex       = _hierarchy->getTopScale();
         const int numLandmarks        = _hierarchy->getScale(topScaleIndex).size();
-        const TsneParameters& tParams = _hsneSettingsAction->getTsneParameters();
+        TsneParameters tParams        = _hsneSettingsAction->getTsneParameters();
+
+        // The top scale embedding uses the exaggeration default for its number of landmarks
+        tParams.setExaggerationFactor(4 + numLandmarks / 60000.0);
 
+        // Shares the hierarchy's transition matrix with the worker, no copy is made
         _tsneAnalysis.startComputation(tParams, _hierarchy->getTransitionMatrixAtScale(topScaleIndex), numLandmarks);
     });
 
@@ -142,6 +150,13 @@ void HsneAnalysisPlugin::init()
         continueComputation();
     });
 
+    connect(&computationAction.getPauseComputationAction(), &ToggleAction::toggled, this, [this](bool toggled) {
+        if (toggled)
+            _tsneAnalysis.pauseComputation();
+        else
+            _tsneAnalysis.resumeComputation();
+    });
+
     connect(&computationAction.getStopComputationAction(), &TriggerAction::triggered, this, [this]() {
         qApp->processEvents();
 
@@ -172,6 +187,15 @@ void HsneAnalysisPlugin::init()
         computeTopLevelEmbedding();
     });
 
+    // The initialization was aborted through the output dataset task, the settings can be changed for another attempt
+    connect(_hierarchy.get(), &HsneHierarchy::aborted, this, [this]() {
+        _hsneSettingsAction->getGeneralHsneSettingsAction().setReadOnly(false);
+        _hsneSettingsAction->getHierarchyConstructionSettingsAction().setReadOnly(false);
+        _hsneSettingsAction->getTopLevelScaleAction().setReadOnly(false);
+        _hsneSettingsAction->getGradientDescentSettingsAction().setReadOnly(false);
+        _hsneSettingsAction->getKnnSettingsAction().setReadOnly(false);
+    });
+
     connect(&_hsneSettingsAction->getGeneralHsneSettingsAction().getStartAction(), &TriggerAction::triggered, this, [this](bool toggled) {
 
         // Create a warning dialog if there are already refined scales
@@ -214,7 +238,7 @@ void HsneAnalysisPlugin::init()
     connect(&_tsneAnalysis, &TsneAnalysis::embeddingUpdate, this, [this](const TsneData& tsneData) {
         auto embedding = getOutputDataset<Points>();
 
-        embedding->setData(tsneData.getData().data(), tsneData.getNumPoints(), 2);
+        tsneData.publishTo(embedding.get());
 
         _hsneSettingsAction->getTopLevelScaleAction().getNumberOfComputedIterationsAction().setValue(_tsneAnalysis.getNumIterations() - 1);
 
@@ -313,7 +337,7 @@ void HsneAnalysisPlugin::computeTopLevelEmbedding()
 
         // Add linked selection between the upper embedding and the bottom layer
         {
-            LandmarkMap& landmarkMap = _hierarchy->getInfluenceHierarchy().getMap()[topScaleIndex];
+            const LandmarkMap& landmarkMap = _hierarchy->getInfluenceHierarchy().getMap()[topScaleIndex];
 
             mv::SelectionMap mapping = {};
             auto& selectionMap = mapping.getMap();
@@ -325,7 +349,8 @@ void HsneAnalysisPlugin::computeTopLevelEmbedding()
 
                 for (unsigned int i = 0; i < landmarkMap.size(); i++)
                 {
-                    selectionMap[globalIndices[i]] = landmarkMap[i];
+                    const auto bottomMap = landmarkMap[i];
+                    selectionMap[globalIndices[i]].assign(bottomMap.begin(), bottomMap.end());
                 }
             }
             else
@@ -334,13 +359,16 @@ void HsneAnalysisPlugin::computeTopLevelEmbedding()
                 inputDataset->getGlobalIndices(globalIndices);
                 for (unsigned int i = 0; i < landmarkMap.size(); i++)
                 {
-                    std::vector<unsigned int> bottomMap = landmarkMap[i];
+                    // The bottom level indices are transformed to global indices while they are copied out of the map
+                    const auto bottomMap = landmarkMap[i];
+                    auto bottomLevelIdx = _hierarchy->getScale(topScaleIndex)._landmark_to_original_data_idx[i];
+                    auto& selection = selectionMap[globalIndices[bottomLevelIdx]];
+
+                    selection.resize(bottomMap.size());
                     for (unsigned int j = 0; j < bottomMap.size(); j++)
                     {
-                        bottomMap[j] = globalIndices[bottomMap[j]];
+                        selection[j] = globalIndices[bottomMap[j]];
                     }
-                    auto bottomLevelIdx = _hierarchy->getScale(topScaleIndex)._landmark_to_original_data_idx[i];
-                    selectionMap[globalIndices[bottomLevelIdx]] = bottomMap;
                 }
             }
 
@@ -353,10 +381,11 @@ void HsneAnalysisPlugin::computeTopLevelEmbedding()
     publishLandmarkWeightsData(_hierarchy.get(), topScaleIndex, embeddingDataset);
     embeddingDataset->getDataHierarchyItem().select();
 
-    // Set t-SNE parameters
+    // Set t-SNE parameters, the top scale embedding uses the exaggeration default for its number of landmarks
     TsneParameters tsneParameters = _hsneSettingsAction->getTsneParameters();
+    tsneParameters.setExaggerationFactor(4 + numLandmarks / 60000.0);
 
-    // Embed data
+    // Embed data, the hierarchy's transition matrix is shared with the worker
     _tsneAnalysis.stopComputation();
     _tsneAnalysis.startComputation(tsneParameters, _hierarchy->getTransitionMatrixAtScale(topScaleIndex), numLandmarks);
 }
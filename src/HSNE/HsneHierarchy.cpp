@@ -1,15 +1,27 @@
 #include "HsneHierarchy.h"
 
+#include "BruteForceKnn.h"
 #include "HsneParameters.h"
+#include "HsneScaleBuilder.h"
+#include "KnnAutoSelection.h"
 #include "KnnParameters.h"
+#include "ParallelUtils.h"
+#include "PcaProjection.h"
+#include "PerplexityCalibration.h"
+#include "PointsDataProvider.h"
 
 #include "DataHierarchyItem.h"
 #include "ImageData/Images.h"
 
 #include "hdi/utils/cout_log.h"
 
+#include <algorithm>
+#include <cassert>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <utility>
 
 #include "json/nlohmann/json.hpp"
 
@@ -23,17 +35,242 @@ constexpr auto _INFLUENCE_TOPDOWN_CACHE_EXTENSION_ = "_influence-tp-hierarchy.hs
 constexpr auto _PARAMETERS_CACHE_EXTENSION_ = "_parameters.hsne";
 constexpr auto _PARAMETERS_CACHE_VERSION_ = "1.0";
 
+// Leading value of influence hierarchy files with an offset array per scale, older files start with the number of scales
+constexpr size_t _INFLUENCE_CACHE_OFFSETS_FORMAT_ = std::numeric_limits<size_t>::max();
+
 namespace
 {
-    Hsne::Parameters setParameters(HsneParameters parameters, KnnParameters knnParameters)
+    /** Marks points without a top influencing landmark at a scale */
+    constexpr std::uint32_t noLandmark = std::numeric_limits<std::uint32_t>::max();
+
+    /**
+     * Top influencing landmarks of bottom scale points, with the unnormalized influences and the retries of Hsne::getInfluenceOnDataPoint:
+     * the influences on a scale are propagated through its area of influence from the influences on the previous scale
+     * that reach a threshold, and if a scale has no influenced landmark, the threshold is divided by 10 for all scales.
+     * The top landmark of a scale has the largest influence, also if it is below the threshold.
+     *
+     * Lowering the threshold only adds influences, so a retry does not start over: every scale keeps its full list of
+     * influences, which is filtered with the lower threshold, and only the influences that were not propagated before
+     * (the increase of the ones that were) are pushed to the next scale. Scale 1 is never recomputed.
+     *
+     * Keeps dense accumulators over the landmarks of every scale, one instance per thread.
+     */
+    class InfluencePropagation
+    {
+    public:
+        /** @param numRetries Number of times the threshold is divided by 10 if a scale has no influenced landmark */
+        InfluencePropagation(const HsneHierarchy& hierarchy, float threshold, int numRetries) :
+            _hierarchy(hierarchy),
+            _threshold(threshold),
+            _numRetries(numRetries),
+            _influence(hierarchy.getNumScales()),
+            _propagated(hierarchy.getNumScales()),
+            _influenced(hierarchy.getNumScales()),
+            _delta(),
+            _nextDelta()
+        {
+            for (int scale = 1; scale < hierarchy.getNumScales(); scale++)
+            {
+                _influence[scale].assign(hierarchy.getScale(scale).size(), 0.f);
+                _propagated[scale].assign(hierarchy.getScale(scale).size(), 0.f);
+            }
+        }
+
+        /**
+         * Top landmark of the point at every scale except the data scale into topLandmarks[scale][point],
+         * noLandmark is left at scales without an influenced landmark after all retries
+         * @return Number of retries with a lower threshold
+         */
+        int findTopLandmarks(std::uint32_t point, std::vector<std::vector<std::uint32_t>>& topLandmarks)
+        {
+            float threshold = _threshold;
+            int numRetries = 0;
+
+            _delta.assign(1, { point, 1.f });
+
+            while (!propagate(threshold) && numRetries < _numRetries)
+            {
+                threshold *= 0.1f;
+                numRetries++;
+                _delta.clear();
+            }
+
+            for (int scale = 1; scale < _hierarchy.getNumScales(); scale++)
+            {
+                // Ties go to the lower landmark index, so that the result does not depend on the order of the area of influence
+                std::uint32_t topLandmark = noLandmark;
+                float maxInfluence = 0.f;
+
+                for (const auto landmark : _influenced[scale])
+                {
+                    const float influence = _influence[scale][landmark];
+
+                    if (influence > 0.f && (influence > maxInfluence || (influence == maxInfluence && landmark < topLandmark)))
+                    {
+                        maxInfluence = influence;
+                        topLandmark = landmark;
+                    }
+
+                    _influence[scale][landmark] = 0.f;
+                    _propagated[scale][landmark] = 0.f;
+                }
+
+                topLandmarks[scale][point] = topLandmark;
+                _influenced[scale].clear();
+            }
+
+            return numRetries;
+        }
+
+    private:
+        /** Push _delta through the scales and filter them with the threshold, returns whether every scale has an influenced landmark */
+        bool propagate(float threshold)
+        {
+            bool complete = true;
+
+            for (int scale = 1; scale < _hierarchy.getNumScales(); scale++)
+            {
+                const auto& areaOfInfluence = _hierarchy.getScale(scale)._area_of_influence;
+                auto& influence = _influence[scale];
+                auto& propagated = _propagated[scale];
+                auto& influenced = _influenced[scale];
+
+                for (const auto& [previous, previousInfluence] : _delta)
+                {
+                    for (const auto& [landmark, weight] : areaOfInfluence[previous])
+                    {
+                        const float added = weight * previousInfluence;
+
+                        if (added <= 0.f)
+                            continue;
+
+                        if (influence[landmark] == 0.f)
+                            influenced.push_back(landmark);
+
+                        influence[landmark] += added;
+                    }
+                }
+
+                _nextDelta.clear();
+
+                for (const auto landmark : influenced)
+                {
+                    if (influence[landmark] < threshold)
+                        continue;
+
+                    if (influence[landmark] != propagated[landmark])
+                    {
+                        _nextDelta.emplace_back(landmark, influence[landmark] - propagated[landmark]);
+                        propagated[landmark] = influence[landmark];
+                    }
+                }
+
+                // Like HDILib, a scale is complete if any landmark has an influence, also one below the threshold
+                complete = complete && !influenced.empty();
+                std::swap(_delta, _nextDelta);
+            }
+
+            return complete;
+        }
+
+    private:
+        const HsneHierarchy&                            _hierarchy;     /** Scales and their areas of influence */
+        float                                           _threshold;     /** Minimum influence that is propagated to the next scale */
+        int                                             _numRetries;    /** Number of lower thresholds */
+        std::vector<std::vector<float>>                 _influence;     /** Influence on every landmark of every scale, zero between points */
+        std::vector<std::vector<float>>                 _propagated;    /** Influence of every landmark that was propagated to the next scale */
+        std::vector<std::vector<std::uint32_t>>         _influenced;    /** Landmarks of every scale with an influence */
+        std::vector<std::pair<std::uint32_t, float>>    _delta;         /** Influences on the previous scale that are propagated */
+        std::vector<std::pair<std::uint32_t, float>>    _nextDelta;     /** Influences on the current scale that are propagated */
+    };
+
+    /**
+     * Group the points by their landmark with a stable counting sort in two parallel passes, like SparseMatrix::symmetrized:
+     * 1. The points are partitioned into buckets of consecutive landmarks, chunks of points in parallel
+     * 2. Every bucket is scattered into its landmarks, buckets in parallel
+     * The points of every landmark are in increasing order, points without a landmark (noLandmark) are left out.
+     */
+    LandmarkMap groupPointsByLandmark(const std::vector<std::uint32_t>& landmarks, std::uint32_t numLandmarks)
+    {
+        const std::int64_t numPoints = static_cast<std::int64_t>(landmarks.size());
+        const std::int64_t numChunks = std::max<std::int64_t>(1, std::min<std::int64_t>(numParallelThreads() * 4, numPoints / 4096));
+        const std::int64_t chunkSize = (numPoints + numChunks - 1) / numChunks;
+        const std::int64_t numBuckets = std::max<std::int64_t>(1, std::min<std::int64_t>({ numPoints / 65536, static_cast<std::int64_t>(numLandmarks), 4096 }));
+        const std::int64_t bucketSize = std::max<std::int64_t>(1, (static_cast<std::int64_t>(numLandmarks) + numBuckets - 1) / numBuckets);
+
+        // Points per chunk and bucket, scanned in bucket-major order they give the write position of every chunk in every bucket
+        std::vector<std::uint64_t> chunkBucketOffsets(numBuckets * numChunks + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            std::vector<std::uint64_t> counts(numBuckets, 0);
+
+            for (std::int64_t i = chunk * chunkSize; i < std::min((chunk + 1) * chunkSize, numPoints); i++)
+                if (landmarks[i] != noLandmark)
+                    counts[landmarks[i] / bucketSize]++;
+
+            for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+                chunkBucketOffsets[bucket * numChunks + chunk] = counts[bucket];
+        }
+
+        const std::uint64_t numGrouped = exclusiveScan(chunkBucketOffsets);
+
+        std::vector<std::uint32_t> bucketPoints(numGrouped);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            std::vector<std::uint64_t> fill(numBuckets);
+
+            for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+                fill[bucket] = chunkBucketOffsets[bucket * numChunks + chunk];
+
+            for (std::int64_t i = chunk * chunkSize; i < std::min((chunk + 1) * chunkSize, numPoints); i++)
+                if (landmarks[i] != noLandmark)
+                    bucketPoints[fill[landmarks[i] / bucketSize]++] = static_cast<std::uint32_t>(i);
+        }
+
+        std::vector<std::uint64_t> offsets(static_cast<std::size_t>(numLandmarks) + 1, 0);
+        std::vector<std::uint32_t> points(numGrouped);
+
+        // Buckets cover disjoint landmarks, so they count and scatter in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+            for (std::uint64_t k = chunkBucketOffsets[bucket * numChunks]; k < chunkBucketOffsets[(bucket + 1) * numChunks]; k++)
+                offsets[landmarks[bucketPoints[k]]]++;
+
+        exclusiveScan(offsets);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t bucket = 0; bucket < numBuckets; bucket++)
+        {
+            const std::int64_t landmarkBegin = std::min<std::int64_t>(bucket * bucketSize, numLandmarks);
+            const std::int64_t landmarkEnd = std::min<std::int64_t>(landmarkBegin + bucketSize, numLandmarks);
+
+            std::vector<std::uint64_t> fill(offsets.begin() + landmarkBegin, offsets.begin() + landmarkEnd);
+
+            for (std::uint64_t k = chunkBucketOffsets[bucket * numChunks]; k < chunkBucketOffsets[(bucket + 1) * numChunks]; k++)
+                points[fill[landmarks[bucketPoints[k]] - landmarkBegin]++] = bucketPoints[k];
+        }
+
+        return LandmarkMap(std::move(offsets), std::move(points));
+    }
+
+    void setKnnParameters(Hsne::Parameters& params, const KnnParameters& knnParameters)
     {
-        Hsne::Parameters params;
         params._aknn_algorithm = knnParameters.getKnnAlgorithm();
         params._aknn_metric = knnParameters.getKnnDistanceMetric();
         params._aknn_num_checks = static_cast<uint32_t>(knnParameters.getAnnoyNumChecks());
         params._aknn_num_trees = static_cast<uint32_t>(knnParameters.getAnnoyNumTrees());
         params._aknn_algorithmP1 = static_cast<double>(knnParameters.getHNSWm());
         params._aknn_algorithmP2 = static_cast<double>(knnParameters.getHNSWef());
+    }
+
+    Hsne::Parameters setParameters(HsneParameters parameters, KnnParameters knnParameters)
+    {
+        Hsne::Parameters params;
+        setKnnParameters(params, knnParameters);
 
         params._seed = parameters.getSeed();
         params._num_walks_per_landmark = parameters.getNumWalksForAreaOfInfluence();
@@ -42,7 +279,6 @@ namespace
         params._mcmcs_landmark_thresh = parameters.getNumWalksForLandmarkSelectionThreshold();
         params._mcmcs_walk_length = parameters.getRandomWalkLength();
         params._transition_matrix_prune_thresh = parameters.getMinWalksRequired();
-        params._out_of_core_computation = parameters.useOutOfCoreComputation();
         params._num_neighbors = parameters.getNumNearestNeighbors();
         return params;
     }
@@ -50,82 +286,91 @@ namespace
 
 /**
  * Compute for every scale except the bottom scale, which landmark influences which bottom scale point
+ *
+ * Built in two phases, so that the threads never write to shared lists:
+ * 1. The top influencing landmark of every point at every scale, points in parallel, see InfluencePropagation
+ * 2. The points grouped by their landmark with a parallel counting sort, see groupPointsByLandmark
  */
-void InfluenceHierarchy::initialize(HsneHierarchy& hierarchy)
+bool InfluenceHierarchy::initialize(HsneHierarchy& hierarchy, const WorkerControl* control)
 {
-    _influenceMap.resize(hierarchy.getNumScales());
+    const int numScales = hierarchy.getNumScales();
+    const std::int64_t numDataPoints = hierarchy.getScale(0).size();
+
+    _influenceMap.clear();
+    _influenceMap.resize(numScales);
+
+    // Top influencing landmark per scale and point, noLandmark if the point has none at the scale
+    std::vector<std::vector<std::uint32_t>> topLandmarks(numScales);
+
+    for (int scale = 1; scale < numScales; scale++)
+        topLandmarks[scale].assign(numDataPoints, noLandmark);
 
-    // For every scale except the bottom scale resize the landmark map to the number of landmarks
-    for (int scale = 1; scale < hierarchy.getNumScales(); scale++)
+    std::int64_t numRetryPoints = 0;
+
+#pragma omp parallel reduction(+:numRetryPoints)
     {
-        int numLandmarks = hierarchy.getScale(scale).size();
+        InfluencePropagation propagation(hierarchy, 0.01f, 3);
+
+#pragma omp for schedule(dynamic, 256)
+        for (std::int64_t i = 0; i < numDataPoints; i++)
+        {
+            if (control != nullptr && control->isStopRequested())
+                continue;
 
-        _influenceMap[scale].resize(numLandmarks);
+            if (propagation.findTopLandmarks(static_cast<std::uint32_t>(i), topLandmarks) > 0)
+                numRetryPoints++;
+        }
     }
 
-    auto& bottomScale = hierarchy.getScale(0);
+    if (control != nullptr && control->isStopRequested())
+    {
+        _influenceMap.clear();
+        return false;
+    }
 
-    int numDataPoints = bottomScale.size();
+    std::cout << "HSNE: Influence hierarchy: " << numRetryPoints << " of " << numDataPoints << " points needed a lower influence threshold" << std::endl;
 
-#pragma omp parallel for
-    for (int i = 0; i < numDataPoints; i++)
+    for (int scale = 1; scale < numScales; scale++)
     {
-        std::vector<std::unordered_map<unsigned int, float>> influence;
+        // Points without a landmark are left out of the influence map of the scale
+        const auto numFailedPoints = std::count(topLandmarks[scale].begin(), topLandmarks[scale].end(), noLandmark);
 
-        float thresh = 0.01f;
+        if (numFailedPoints > 0)
+            std::cerr << "HSNE: Influence hierarchy: failed to find a landmark for " << numFailedPoints << " of " << numDataPoints << " points at scale " << scale << std::endl;
 
-        hierarchy.getInfluenceOnDataPoint(i, influence, thresh, false);
-        ///////
-        int redo = 1;
-        int tries = 0;
-        while (redo)
-        {
-            redo = 0;
-            if (tries++ < 3)
-            {
-                for (int scale = 1; scale < hierarchy.getNumScales(); scale++)
-                {
-                    if (influence[scale].size() < 1)
-                    {
-                        redo = scale;
-                    }
-                }
-            }
-            if (redo > 0)
-            {
-                //if(thresh < 0.0005) std::cout << "Couldn't find landmark for point " << i << " at scale " << redo << " num possible landmarks " << influence[redo].size() << "\nSetting new threshold to " << thresh * 0.1 << std::endl;
-                thresh *= 0.1;
-                hierarchy.getInfluenceOnDataPoint(i, influence, thresh, false);
-            }
-        }
-        //////
+        _influenceMap[scale] = groupPointsByLandmark(topLandmarks[scale], static_cast<std::uint32_t>(hierarchy.getScale(scale).size()));
 
-        for (int scale = 1; scale < hierarchy.getNumScales(); scale++)
-        {
-            float maxInfluence = 0;
-            int topInfluencingLandmark = -1;
+        std::vector<std::uint32_t>().swap(topLandmarks[scale]);
+    }
 
-            for (auto& landmark : influence[scale])
-            {
-                if (landmark.second >= maxInfluence)
-                {
-                    maxInfluence = landmark.second;
-                    topInfluencingLandmark = landmark.first;
-                }
-            }
+    return true;
+}
 
-            if (topInfluencingLandmark == -1)
-            {
-                std::cerr << "Failed to find landmark for point " << i << " at scale " << scale << " num possible landmarks " << influence[scale].size() << std::endl;
-                continue;
-            }
+std::shared_ptr<SparseMatrix> HsneHierarchy::getSparseTransitionMatrix(int scale)
+{
+    assert(scale >= 0 && scale < _numScales);
 
-            #pragma omp critical
-            {
-                _influenceMap[scale][topInfluencingLandmark].push_back(i);
-            }
-        }
+    if (_sparseTransitionMatrices.size() != static_cast<std::size_t>(_numScales))
+        _sparseTransitionMatrices.resize(_numScales);
+
+    // HDILib keeps its own copy of every scale, so the CSR copy is not kept once the embeddings using it are gone
+    auto sparseTransitionMatrix = _sparseTransitionMatrices[scale].lock();
+
+    if (sparseTransitionMatrix == nullptr)
+    {
+        sparseTransitionMatrix = std::make_shared<SparseMatrix>(SparseMatrix::fromMapMemEff(_hsne->scale(scale)._transition_matrix));
+        _sparseTransitionMatrices[scale] = sparseTransitionMatrix;
     }
+
+    return sparseTransitionMatrix;
+}
+
+SharedProbDistMatrix HsneHierarchy::getTransitionMatrixForSelection(int currentScale, const std::vector<uint32_t>& landmarkIdxs)
+{
+    assert(currentScale >= 1 && currentScale <= _numScales);
+
+    // Subgraph of the selected landmarks in the transition matrix of the previous scale, only the selected rows are converted
+    return SparseMatrix::fromMapMemEff(_hsne->scale(currentScale - 1)._transition_matrix, landmarkIdxs);
 }
 
 void HsneHierarchy::printScaleInfo() const
@@ -140,6 +385,7 @@ void HsneHierarchy::setDataAndParameters(const mv::Dataset<Points>& inputData, c
 {
     // Convert our own HSNE parameters to the HDI parameters
     _params = setParameters(parameters, knnParameters);
+    _knnParameters = knnParameters;
 
     _saveHierarchyToDisk = parameters.getSaveHierarchyToDisk();
 
@@ -186,10 +432,14 @@ void HsneHierarchy::setDataAndParameters(const mv::Dataset<Points>& inputData, c
     _cachePathFileName = _cachePath / _inputDataName;
 
     _hsne = std::make_unique<Hsne>();
+    _sparseTransitionMatrices.clear();
 }
 
 void HsneHierarchy::initParentTask()
 {
+    // Cleared here and not in initialize(), so that a stop request before the worker starts is not lost
+    _control.reset();
+
     if (!_outputData.isValid())
         return;
 
@@ -198,6 +448,9 @@ void HsneHierarchy::initParentTask()
     _parentTask->setProgressMode(mv::Task::ProgressMode::Manual);
     _parentTask->setRunning();
     _parentTask->setProgress(.0f);
+
+    // The abort request is emitted in the GUI thread while initialize() runs in the hierarchy thread
+    connect(_parentTask, &mv::Task::requestAbort, this, &HsneHierarchy::stop, static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
 }
 
 void HsneHierarchy::initialize()
@@ -214,37 +467,115 @@ void HsneHierarchy::initialize()
         // Set up a logger
         _hsne->setLogger(&log);
 
+        const PointsDataProvider pointsDataProvider(_inputData, _enabledDimensions);
+
+        // The neighbors are searched among the projections onto the principal components if requested, the cache holds the resulting hierarchy
+        std::optional<VectorDataProvider> projectedDataProvider;
+        const auto numPcaComponents = _knnParameters.getNumPcaComponents();
+
+        if (numPcaComponents > 0 && numPcaComponents < _numDimensions)
+        {
+            _parentTask->setProgress(.05f, "Projecting onto principal components");
+
+            PcaProjection::Parameters pcaParameters;
+            pcaParameters.numComponents = numPcaComponents;
+
+            const auto projection = PcaProjection::fit(pointsDataProvider, pcaParameters);
+            projectedDataProvider.emplace(projection.project(pointsDataProvider), projection.getNumComponents());
+
+            if (_control.isStopRequested())
+                return abortInitialization();
+
+            std::cout << "HSNE: Projected " << _numDimensions << " dimensions onto " << projection.getNumComponents() << " principal components" << std::endl;
+        }
+
+        const DataProvider& dataProvider = projectedDataProvider.has_value() ? static_cast<const DataProvider&>(*projectedDataProvider) : pointsDataProvider;
+
         // Set the dimensionality of the data in the HSNE object
-        _hsne->setDimensionality(_numDimensions);
+        _hsne->setDimensionality(dataProvider.getNumDimensions());
 
         _parentTask->setProgress(.1f, "Data similarities");
 
-        // Load data and enabled dimensions
-        std::vector<float> data;
-        std::vector<unsigned int> dimensionIndices;
-        data.resize((_inputData->isFull() ? _inputData->getNumPoints() : _inputData->indices.size()) * _numDimensions);
-        for (int i = 0; i < _inputData->getNumDimensions(); i++)
-            if (_enabledDimensions[i]) dimensionIndices.push_back(i);
+        // The cache is keyed by the requested parameters, an automatic selection only applies to this computation
+        auto params = _params;
+        auto knnBackend = _knnParameters.getKnnBackend();
+
+        if (knnBackend == KnnBackend::Auto)
+        {
+            _parentTask->setProgress(.1f, "Selecting kNN backend");
+
+            const auto selection = selectKnnParameters(dataProvider, _knnParameters, static_cast<std::uint32_t>(_params._num_neighbors));
+            setKnnParameters(params, selection.knnParameters);
+            knnBackend = selection.knnParameters.getKnnBackend();
+
+            std::cout << "HSNE: " << selection.summary << std::endl;
+            _parentTask->setProgress(.1f, QString::fromStdString(selection.summary));
+        }
+
+        if (_control.isStopRequested())
+            return abortInitialization();
+
+        // HDILib indexes the dense 32-bit data
+        if (knnBackend != KnnBackend::BruteForce && _knnParameters.getKnnPrecision() != KnnPrecision::Float32)
+            std::cout << "HSNE: The " << knnPrecisionName(_knnParameters.getKnnPrecision()) << " precision only applies to the brute-force search, it is ignored" << std::endl;
+
+        if (knnBackend == KnnBackend::BruteForce)
+        {
+            // HSNE is initialized with the transition matrix of the data scale instead of the data,
+            // computed from exact neighbors with HDILib's neighborhood size and perplexity
+            const auto precision = _knnParameters.getKnnPrecision() == KnnPrecision::Sparse && projectedDataProvider.has_value() ? KnnPrecision::Float32 : _knnParameters.getKnnPrecision();
+
+            // HDILib copies the matrix into the data scale, the kNN graph and CSR matrix are released before that, so at most two copies exist at a time
+            HsneMatrix transitionMatrix;
+            {
+                const auto knnGraph = computeBruteForceKnn(dataProvider, static_cast<std::uint32_t>(params._num_neighbors), params._aknn_metric, precision, &_control);
 
-        _inputData->populateDataForDimensions<std::vector<float>, std::vector<unsigned int>>(data, dimensionIndices);
+                if (_control.isStopRequested())
+                    return abortInitialization();
 
-        // Initialize HSNE with the input data and the given parameters
-        _hsne->initialize((Hsne::scalar_type*)data.data(), _numPoints, _params);
+                if (!isFullKnnPrecision(precision))
+                    std::cout << "HSNE: Recall of the " << knnPrecisionName(precision) << " search, estimated on 100 points: " << estimateKnnRecall(dataProvider, knnGraph, params._aknn_metric) << std::endl;
+
+                transitionMatrix = computeConditionalProbabilities(knnGraph, params._num_neighbors / 3.f).toMapMemEff();
+            }
+
+            _hsne->initialize(transitionMatrix, params);
+        }
+        else
+        {
+            // Enabled dimensions of the data, HDILib needs them in one array: the dataset's storage if possible, otherwise a copy
+            const auto data = dataProvider.getDenseData();
+
+            // Initialize HSNE with the input data and the given parameters, HDILib's neighbor search itself cannot be stopped
+            _hsne->initialize(const_cast<Hsne::scalar_type*>(data.data()), _numPoints, params);
+        }
+
+        if (_control.isStopRequested())
+            return abortInitialization();
 
         _parentTask->setProgress(.33f, "Adding scales");
 
         float progressStep = .33f / _numScales;
 
-        // Add a number of scales as indicated by the user
+        // Add a number of scales as indicated by the user, the random walks of every scale run in parallel
+        const HsneScaleBuilder scaleBuilder(params);
+
         for (int s = 0; s < _numScales - 1; ++s) {
-            _hsne->addScale();
+            const auto added = scaleBuilder.addScale(*_hsne, [this, s, progressStep](float progress, const std::string& step) {
+                _parentTask->setProgress(.33f + (s + progress) * progressStep, QString("Adding scale %1: %2").arg(s + 1).arg(QString::fromStdString(step)));
+                }, &_control);
+
+            if (!added)
+                return abortInitialization();
+
             _parentTask->setProgress(.33f + (s + 1) * progressStep, "Adding scales");
         }
 
         _parentTask->setProgress(.66f, "Selection mapping");
 
         std::cout << "Initializing influence hierarchy... " << std::endl;
-        _influenceHierarchy.initialize(*this);
+        if (!_influenceHierarchy.initialize(*this, &_control))
+            return abortInitialization();
 
         // Write HSNE hierarchy to disk
         if(_saveHierarchyToDisk)
@@ -261,6 +592,22 @@ void HsneHierarchy::initialize()
     this->moveToThread(QCoreApplication::instance()->thread());
 }
 
+void HsneHierarchy::abortInitialization()
+{
+    std::cout << "HSNE: Hierarchy initialization aborted" << std::endl;
+
+    // Drop the partial hierarchy, a new initialization starts from setDataAndParameters
+    _hsne = std::make_unique<Hsne>();
+    _influenceHierarchy.getMap().clear();
+    _sparseTransitionMatrices.clear();
+    _isInit = false;
+
+    _parentTask->setAborted();
+
+    emit aborted();
+    this->moveToThread(QCoreApplication::instance()->thread());
+}
+
 
 void HsneHierarchy::saveCacheHsne(const Hsne::Parameters& internalParams) const {
     if (!_hsne) return; // only save if initialize() has been called
@@ -303,22 +650,21 @@ void HsneHierarchy::saveCacheHsneInfluenceHierarchy(std::string fileName, const
         return;
     }
 
-    size_t iSize = influenceHierarchy.size();
+    // Marker, number of scales, then per scale the sizes and contents of the offsets and the points
+    const size_t format = _INFLUENCE_CACHE_OFFSETS_FORMAT_;
+    const size_t iSize = influenceHierarchy.size();
 
+    saveFile.write((const char*)&format, sizeof(decltype(format)));
     saveFile.write((const char*)&iSize, sizeof(decltype(iSize)));
-    for (size_t i = 0; i < iSize; i++)
+    for (const auto& landmarkMap : influenceHierarchy)
     {
-        size_t jSize = influenceHierarchy[i].size();
-        saveFile.write((const char*)&jSize, sizeof(decltype(jSize)));
-        for (size_t j = 0; j < jSize; j++)
-        {
-            size_t kSize = influenceHierarchy[i][j].size();
-            saveFile.write((const char*)&kSize, sizeof(decltype(kSize)));
-            if (kSize > 0)
-            {
-                saveFile.write((const char*)&influenceHierarchy[i][j].front(), kSize * sizeof(uint32_t));
-            }
-        }
+        const size_t numOffsets = landmarkMap.getOffsets().size();
+        const size_t numPoints = landmarkMap.getPoints().size();
+
+        saveFile.write((const char*)&numOffsets, sizeof(decltype(numOffsets)));
+        saveFile.write((const char*)&numPoints, sizeof(decltype(numPoints)));
+        saveFile.write((const char*)landmarkMap.getOffsets().data(), numOffsets * sizeof(uint64_t));
+        saveFile.write((const char*)landmarkMap.getPoints().data(), numPoints * sizeof(uint32_t));
     }
 
     saveFile.close();
@@ -346,16 +692,21 @@ void HsneHierarchy::saveCacheParameters(std::string fileName, const Hsne::Parame
 
     parameters["Number of Scales"] = _numScales;
 
+    parameters["Knn backend"] = static_cast<int>(_knnParameters.getKnnBackend());
     parameters["Knn library"] = internalParams._aknn_algorithm;
     parameters["Knn distance metric"] = internalParams._aknn_metric;
     parameters["Knn number of neighbors"] = internalParams._num_neighbors;
+    parameters["PCA components"] = _knnParameters.getNumPcaComponents();
+
+    // The precision only applies to the brute-force search, which the automatic selection may choose
+    if (_knnParameters.getKnnBackend() != KnnBackend::Library)
+        parameters["Knn precision"] = static_cast<int>(_knnParameters.getKnnPrecision());
 
     parameters["Nr. Checks in AKNN"] = internalParams._aknn_num_checks;
     parameters["Nr. Trees for AKNN"] = internalParams._aknn_num_trees;
     parameters["HNSW Param 1"] = internalParams._aknn_algorithmP1;
     parameters["HNSW Param 2"] = internalParams._aknn_algorithmP2;
 
-    parameters["Memory preserving computation"] = internalParams._out_of_core_computation;
     parameters["Nr. RW for influence"] = internalParams._num_walks_per_landmark;
     parameters["Nr. RW for Monte Carlo"] = internalParams._mcmcs_num_walks;
     parameters["Random walks threshold"] = internalParams._mcmcs_landmark_thresh;
@@ -426,6 +777,8 @@ bool HsneHierarchy::loadCacheHsneHierarchy(std::string fileName, hdi::utils::Cou
         _hsne.reset(new Hsne());
     }
 
+    _sparseTransitionMatrices.clear();
+
     _hsne->setLogger(&log);
 
     hdi::dr::IO::loadHSNE(*_hsne, loadFile, &log);
@@ -449,25 +802,68 @@ bool HsneHierarchy::loadCacheHsneInfluenceHierarchy(std::string fileName, std::v
     size_t iSize = 0;
     loadFile.read((char*)&iSize, sizeof(decltype(iSize)));
 
+    // Files without the marker, e.g. in older projects, start with the number of scales and store every landmark separately
+    const bool offsetsFormat = iSize == _INFLUENCE_CACHE_OFFSETS_FORMAT_;
+
+    if (offsetsFormat)
+        loadFile.read((char*)&iSize, sizeof(decltype(iSize)));
+
     influenceHierarchy.resize(iSize);
 
     for (size_t i = 0; i < influenceHierarchy.size(); i++)
     {
-        size_t jSize = 0;
-        loadFile.read((char*)&jSize, sizeof(decltype(jSize)));
-        influenceHierarchy[i].resize(jSize);
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> points;
+
+        if (offsetsFormat)
+        {
+            size_t numOffsets = 0, numPoints = 0;
+            loadFile.read((char*)&numOffsets, sizeof(decltype(numOffsets)));
+            loadFile.read((char*)&numPoints, sizeof(decltype(numPoints)));
 
-        for (size_t j = 0; j < influenceHierarchy[i].size(); j++)
+            if (!loadFile)
+                return false;
+
+            offsets.resize(numOffsets);
+            points.resize(numPoints);
+            loadFile.read((char*)offsets.data(), numOffsets * sizeof(uint64_t));
+            loadFile.read((char*)points.data(), numPoints * sizeof(uint32_t));
+        }
+        else
         {
-            size_t kSize = 0;
-            loadFile.read((char*)&kSize, sizeof(decltype(kSize)));
+            size_t jSize = 0;
+            loadFile.read((char*)&jSize, sizeof(decltype(jSize)));
 
-            influenceHierarchy[i][j].resize(kSize);
-            if (kSize > 0)
+            if (!loadFile)
+                return false;
+
+            offsets.assign(jSize + 1, 0);
+
+            for (size_t j = 0; j < jSize; j++)
             {
-                loadFile.read((char*)&influenceHierarchy[i][j].front(), kSize * sizeof(uint32_t));
+                size_t kSize = 0;
+                loadFile.read((char*)&kSize, sizeof(decltype(kSize)));
+
+                if (!loadFile)
+                    return false;
+
+                points.resize(points.size() + kSize);
+                if (kSize > 0)
+                {
+                    loadFile.read((char*)(points.data() + offsets[j]), kSize * sizeof(uint32_t));
+                }
+                offsets[j + 1] = points.size();
             }
+
+            // Scales without landmarks, i.e. the data scale, have no offsets
+            if (jSize == 0)
+                offsets.clear();
         }
+
+        if (!loadFile || (!offsets.empty() && offsets.back() != points.size()))
+            return false;
+
+        influenceHierarchy[i] = LandmarkMap(std::move(offsets), std::move(points));
     }
 
     loadFile.close();
@@ -509,22 +905,31 @@ bool HsneHierarchy::checkCacheParameters(const std::string fileName, const Hsne:
         return true;
     };
 
+    // Caches that were written before the kNN backend and the PCA projection were options used HDILib's search of the data
+    if (!parameters.contains("Knn backend"))
+        parameters["Knn backend"] = static_cast<int>(KnnBackend::Library);
+
+    if (!parameters.contains("PCA components"))
+        parameters["PCA components"] = 0;
+
     if (!checkParam("Input data name", _inputDataName)) return false;
     if (!checkParam("Number of points", _numPoints)) return false;
     if (!checkParam("Number of dimensions", _numDimensions)) return false;
 
     if (!checkParam("Number of Scales", _numScales)) return false;
 
+    if (!checkParam("Knn backend", static_cast<int>(_knnParameters.getKnnBackend()))) return false;
     if (!checkParam("Knn library", params._aknn_algorithm)) return false;
     if (!checkParam("Knn distance metric", params._aknn_metric)) return false;
     if (!checkParam("Knn number of neighbors", params._num_neighbors)) return false;
+    if (!checkParam("PCA components", _knnParameters.getNumPcaComponents())) return false;
+    if (_knnParameters.getKnnBackend() != KnnBackend::Library && !checkParam("Knn precision", static_cast<int>(_knnParameters.getKnnPrecision()))) return false;
 
     if (!checkParam("Nr. Checks in AKNN", params._aknn_num_checks)) return false;
     if (!checkParam("Nr. Trees for AKNN", params._aknn_num_trees)) return false;
     if (!checkParam("HNSW Param 1", params._aknn_algorithmP1)) return false;
     if (!checkParam("HNSW Param 2", params._aknn_algorithmP2)) return false;
 
-    if (!checkParam("Memory preserving computation", params._out_of_core_computation)) return false;
     if (!checkParam("Nr. RW for influence", params._num_walks_per_landmark)) return false;
     if (!checkParam("Nr. RW for Monte Carlo", params._mcmcs_num_walks)) return false;
     if (!checkParam("Random walks threshold", params._mcmcs_landmark_thresh)) return false;
@@ -6,8 +6,15 @@
 
 #include "PointData/PointData.h"
 
+#include "KnnParameters.h"
+#include "SharedProbDistMatrix.h"
+#include "WorkerControl.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -18,7 +25,6 @@ using HsneMatrix = std::vector<hdi::data::MapMemEff<uint32_t, float>>;
 using Hsne = hdi::dr::HierarchicalSNE<float, HsneMatrix>;
 
 class HsneParameters;
-class KnnParameters;
 class HsneHierarchy;
 
 namespace mv {
@@ -29,9 +35,43 @@ namespace mv {
     }
 }
 
-using LandmarkMap = std::vector<std::vector<unsigned int>>;
 using Path = std::filesystem::path;
 
+/**
+ * LandmarkMap
+ *
+ * Bottom scale points that the landmarks of one scale influence most, in compressed sparse row form:
+ * offsets of every landmark into one array of points instead of a heap allocation per landmark
+ */
+class LandmarkMap
+{
+public:
+    LandmarkMap() = default;
+
+    /** The points of landmark l are points[offsets[l], offsets[l + 1]) */
+    LandmarkMap(std::vector<std::uint64_t>&& offsets, std::vector<std::uint32_t>&& points) :
+        _offsets(std::move(offsets)),
+        _points(std::move(points))
+    {
+    }
+
+    /** Number of landmarks */
+    std::size_t size() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+    /** Points of a landmark, a view into the map */
+    std::span<const std::uint32_t> operator[](std::size_t landmark) const
+    {
+        return { _points.data() + _offsets[landmark], static_cast<std::size_t>(_offsets[landmark + 1] - _offsets[landmark]) };
+    }
+
+    const std::vector<std::uint64_t>& getOffsets() const { return _offsets; }
+    const std::vector<std::uint32_t>& getPoints() const { return _points; }
+
+private:
+    std::vector<std::uint64_t>  _offsets;   /** First point of every landmark and the number of points at the end */
+    std::vector<std::uint32_t>  _points;    /** Bottom scale points of all landmarks */
+};
+
 /**
  * InfluenceHierarchy
  *
@@ -44,7 +84,12 @@ class InfluenceHierarchy : public QObject
     Q_OBJECT
 
 public:
-    void initialize(HsneHierarchy& hierarchy);
+    /**
+     * Compute the bottom scale points that the landmarks of every scale influence most
+     * @param control Polled per point, the map is left empty if a stop is requested
+     * @return Whether the map was computed
+     */
+    bool initialize(HsneHierarchy& hierarchy, const WorkerControl* control = nullptr);
 
     std::vector<LandmarkMap>& getMap() { return _influenceMap; }
     const std::vector<LandmarkMap>& getMap() const { return _influenceMap; }
@@ -73,13 +118,20 @@ public slots:
 signals:
     void finished();
 
+    /** Emitted instead of finished() when the initialization stopped on an abort request of the parent task */
+    void aborted();
+
 public:
     void setDataAndParameters(const mv::Dataset<Points>& inputData, const mv::Dataset<Points>& outputData, const HsneParameters& parameters, const KnnParameters& knnParameters, std::vector<bool>&& enabledDimensions);
 
     // Call before moving this object to another thread
     void initParentTask();
 
-    HsneMatrix getTransitionMatrixAtScale(int scale) { return _hsne->scale(scale)._transition_matrix; }
+    /** Ask a running initialize() to stop at its next checkpoint, safe to call from any thread */
+    void stop() { _control.requestStop(); }
+
+    /** Shared handle to the CSR transition matrix of a scale, repeated calls do not copy the matrix */
+    SharedProbDistMatrix getTransitionMatrixAtScale(int scale) { return SharedProbDistMatrix(getSparseTransitionMatrix(scale)); }
 
     void printScaleInfo() const;
 
@@ -109,18 +161,10 @@ public:
     }
 
     /**
-     * Extract a subgraph with the selected indexes and the vertices connected to them by an edge with a weight higher then thresh
-     * 
+     * Extract the subgraph of the selected landmarks of the previous scale from its transition matrix
+     * Row i of the result corresponds to landmarkIdxs[i]
      */
-    void getTransitionMatrixForSelection(int currentScale, HsneMatrix& transitionMatrix, std::vector<uint32_t>& landmarkIdxs)
-    {
-        // Get full transition matrix of the previous scale
-        HsneMatrix& fullTransitionMatrix = _hsne->scale(currentScale-1)._transition_matrix;
-
-        // Extract the selected subportion of the transition matrix
-        std::vector<unsigned int> dummy;
-        hdi::utils::extractSubGraph(fullTransitionMatrix, landmarkIdxs, transitionMatrix, dummy, 1);
-    }
+    SharedProbDistMatrix getTransitionMatrixForSelection(int currentScale, const std::vector<uint32_t>& landmarkIdxs);
 
     int getNumScales() const { return _numScales; }
     int getTopScale() const { return _numScales - 1; }
@@ -154,20 +198,30 @@ protected:
 
     void setIsInitialized(bool init) { _isInit = true; }
 
+    /** CSR copy of the transition matrix of a scale, shared with the holders of a previous copy or converted again if there are none */
+    std::shared_ptr<SparseMatrix> getSparseTransitionMatrix(int scale);
+
+    /** Release the partial hierarchy after a stop request, mark the parent task as aborted and emit aborted() */
+    void abortInitialization();
+
 private:
     std::unique_ptr<Hsne>   _hsne;
     InfluenceHierarchy      _influenceHierarchy;
 
+    std::vector<std::weak_ptr<SparseMatrix>>    _sparseTransitionMatrices;   /** CSR transition matrices per scale, only alive while an embedding holds them */
+
     std::vector<bool>       _enabledDimensions;
     mv::Dataset<Points>     _inputData;
     mv::Dataset<Points>     _outputData;
     std::string             _inputDataName;
     mv::Task*               _parentTask = nullptr;
+    WorkerControl           _control;                              /** Stop requests for initialize(), from the parent task or the plugin */
 
     int                     _numScales = 1;
     unsigned int            _numPoints = 0;
     unsigned int            _numDimensions = 0;
     Hsne::Parameters        _params;
+    KnnParameters           _knnParameters;                        /** Requested kNN backend, HDILib's kNN inside HSNE, our exact search or automatic selection */
     bool                    _isInit = false;
 
     Path                    _cachePath;                            /** Path for saving and loading cache */
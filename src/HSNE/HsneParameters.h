@@ -19,7 +19,6 @@ public:
         _randomWalkLength(15),
         _numWalksForAreaOfInfluence(100),
         _minWalksRequired(0),
-        _useOutOfCoreComputation(true),
         _saveHierarchyToDisk(false),
         _numNeighbors(90)
     {
@@ -41,7 +40,6 @@ public:
     void setMinWalksRequired(int minWalks) { _minWalksRequired = minWalks; }
     void setNumNearestNeighbors(int numNeighbors) { _numNeighbors = numNeighbors; }
     void useMonteCarloSampling(bool useMonteCarloSampling) { _useMonteCarloSampling = useMonteCarloSampling; }
-    void useOutOfCoreComputation(bool useOutOfCoreComputation) { _useOutOfCoreComputation = useOutOfCoreComputation; }
 
     int getNumWalksForLandmarkSelection() const { return _numWalksForLandmarkSelection; }
     float getNumWalksForLandmarkSelectionThreshold() const { return _numWalksForLandmarkSelectionThreshold; }
@@ -49,8 +47,7 @@ public:
     int getNumNearestNeighbors() const { return _numNeighbors; }
     int getNumWalksForAreaOfInfluence() const { return _numWalksForAreaOfInfluence; }
     int getMinWalksRequired() const { return _minWalksRequired; }
-    bool useMonteCarloSampling() const { return _useOutOfCoreComputation; }
-    bool useOutOfCoreComputation() const { return _useOutOfCoreComputation; }
+    bool useMonteCarloSampling() const { return _useMonteCarloSampling; }
 
     // Plugin specific
 
@@ -71,7 +68,6 @@ private:
     int _randomWalkLength;                          /** How long each random walk should be */
     int _numWalksForAreaOfInfluence;                /** How many random walks to use for computing the area of influence */
     int _minWalksRequired;                          /** Minimum number of walks to be considered in the computation of the transition matrix */
-    bool _useOutOfCoreComputation;                  /** Preserve memory while computing the hierarchy */
     int _numNeighbors;                              /** Number nearest neighbors. In HDI internally it'll use nn = _numNeighbors + 1 and perplexity = _numNeighbors / 3 */
 
     // Plugin specific
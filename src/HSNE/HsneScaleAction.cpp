@@ -110,6 +110,10 @@ void HsneScaleAction::initLayoutAndConnection()
             _computationAction.getStartComputationAction().setEnabled(!isRunning);
             _computationAction.getContinueComputationAction().setEnabled(!isRunning && _tsneAnalysis.canContinue());
             _computationAction.getStopComputationAction().setEnabled(isRunning);
+            _computationAction.getPauseComputationAction().setEnabled(isRunning);
+
+            if (!isRunning)
+                _computationAction.getPauseComputationAction().setChecked(false);
         };
 
         auto cleanupUpdateEmbedding = [this, updateComputationAction]() -> void {
@@ -141,7 +145,7 @@ void HsneScaleAction::initLayoutAndConnection()
             datasetTask.setRunning();
 
             connect(&_tsneAnalysis, &TsneAnalysis::embeddingUpdate, this, [this](const TsneData& tsneData) {
-                _embedding->setData(tsneData.getData().data(), tsneData.getNumPoints(), 2);
+                tsneData.publishTo(_embedding.get());
                 getNumberOfComputedIterationsAction().setValue(_tsneAnalysis.getNumIterations() - 1);
                 events().notifyDatasetDataChanged(_embedding);
                 });
@@ -150,12 +154,11 @@ void HsneScaleAction::initLayoutAndConnection()
         connect(&_computationAction.getStartComputationAction(), &TriggerAction::triggered, this, [this, initUpdateEmbedding]() {
             initUpdateEmbedding();
             
-            HsneMatrix refinedTransitionMatrix;
             assert(_currentScaleLevel + 1 <= _hsneHierarchy.getTopScale());
-            _hsneHierarchy.getTransitionMatrixForSelection(_currentScaleLevel + 1, refinedTransitionMatrix, _drillIndices);
+            auto refinedTransitionMatrix = _hsneHierarchy.getTransitionMatrixForSelection(_currentScaleLevel + 1, _drillIndices);
 
             assert(_drillIndices.size() == refinedTransitionMatrix.size());
-            _tsneAnalysis.startComputation(_tsneParameters, refinedTransitionMatrix, _drillIndices.size());
+            _tsneAnalysis.startComputation(_tsneParameters, std::move(refinedTransitionMatrix), _drillIndices.size());
         });
 
         connect(&_computationAction.getContinueComputationAction(), &TriggerAction::triggered, this, [this, initUpdateEmbedding]() {
@@ -164,6 +167,13 @@ void HsneScaleAction::initLayoutAndConnection()
             _tsneAnalysis.continueComputation(_tsneParameters.getNumIterations());
         });
 
+        connect(&_computationAction.getPauseComputationAction(), &ToggleAction::toggled, this, [this](bool toggled) {
+            if (toggled)
+                _tsneAnalysis.pauseComputation();
+            else
+                _tsneAnalysis.resumeComputation();
+        });
+
         connect(&_computationAction.getStopComputationAction(), &TriggerAction::triggered, this, [this]() {
             qApp->processEvents();
             _tsneAnalysis.stopComputation();
@@ -286,8 +296,7 @@ void HsneScaleAction::refine()
     ////////////////////////////
     
     // Compute the transition matrix for the landmarks above the threshold
-    HsneMatrix refinedTransitionMatrix;
-    _hsneHierarchy.getTransitionMatrixForSelection(_currentScaleLevel, refinedTransitionMatrix, refinedLandmarks);
+    auto refinedTransitionMatrix = _hsneHierarchy.getTransitionMatrixForSelection(_currentScaleLevel, refinedLandmarks);
 
     // Create a new data set for the embedding
     {
@@ -359,7 +368,7 @@ void HsneScaleAction::refine()
     // Add linked selection between the refined embedding and the bottom level points
     if (refinedScaleLevel > 0) // Only add a linked selection if it's not the bottom level already
     {
-        LandmarkMap& landmarkMap = _hsneHierarchy.getInfluenceHierarchy().getMap()[refinedScaleLevel];
+        const LandmarkMap& landmarkMap = _hsneHierarchy.getInfluenceHierarchy().getMap()[refinedScaleLevel];
 
         mv::SelectionMap mapping;
         auto& selectionMap = mapping.getMap();
@@ -369,7 +378,8 @@ void HsneScaleAction::refine()
             for (const unsigned int& scaleIndex : refinedLandmarks)
             {
                 int bottomLevelIdx = _hsneHierarchy.getScale(refinedScaleLevel)._landmark_to_original_data_idx[scaleIndex];
-                selectionMap[bottomLevelIdx] = landmarkMap[scaleIndex];
+                const auto bottomMap = landmarkMap[scaleIndex];
+                selectionMap[bottomLevelIdx].assign(bottomMap.begin(), bottomMap.end());
             }
         }
         else
@@ -379,14 +389,16 @@ void HsneScaleAction::refine()
             _input->getGlobalIndices(globalIndices);
             for (const unsigned int& scaleIndex : refinedLandmarks)
             {
-                std::vector<unsigned int> bottomMap = landmarkMap[scaleIndex];
+                const auto bottomMap = landmarkMap[scaleIndex];
+                const int bottomLevelIdx = _hsneHierarchy.getScale(refinedScaleLevel)._landmark_to_original_data_idx[scaleIndex];
+                auto& selection = selectionMap[globalIndices[bottomLevelIdx]];
+
                 // Transform bottom level indices to the global full set indices
+                selection.resize(bottomMap.size());
                 for (int j = 0; j < bottomMap.size(); j++)
                 {
-                    bottomMap[j] = globalIndices[bottomMap[j]];
+                    selection[j] = globalIndices[bottomMap[j]];
                 }
-                const int bottomLevelIdx = _hsneHierarchy.getScale(refinedScaleLevel)._landmark_to_original_data_idx[scaleIndex];
-                selectionMap[globalIndices[bottomLevelIdx]] = bottomMap;
             }
         }
 
@@ -399,7 +411,7 @@ void HsneScaleAction::refine()
         auto& refineEmbedding = _refineEmbeddings.back();
 
         // Update the refine embedding with new data
-        refineEmbedding->setData(tsneData.getData(), 2);
+        tsneData.publishTo(refineEmbedding.get());
 
         _refinedScaledActions.back()->getNumberOfComputedIterationsAction().setValue(_tsneAnalysis.getNumIterations() - 1);
 
@@ -425,7 +437,7 @@ void HsneScaleAction::refine()
     }
 
     // Start the embedding process
-    _tsneAnalysis.startComputation(_tsneParameters, refinedTransitionMatrix, numRefinedLandmarks);
+    _tsneAnalysis.startComputation(_tsneParameters, std::move(refinedTransitionMatrix), numRefinedLandmarks);
 }
 
 void HsneScaleAction::fromVariantMap(const QVariantMap& variantMap)
@@ -460,6 +472,7 @@ void HsneScaleAction::fromVariantMap(const QVariantMap& variantMap)
     _tsneParameters.setExponentialDecayIter(variantMap["ExponentialDecayIter"].toInt());
     _tsneParameters.setNumDimensionsOutput(variantMap["NumDimensionsOutput"].toInt());
     _tsneParameters.setUpdateCore(variantMap["UpdateCore"].toInt());
+    _tsneParameters.setUpdateInterval(variantMap.value("UpdateInterval", _tsneParameters.getUpdateInterval()).toInt());
 
     // Handle refined datasets and corresponding actions
     for (const auto& refinedEmbeddingMapVar : variantMap["refinedEmbeddingsMap"].toMap())
@@ -515,6 +528,7 @@ QVariantMap HsneScaleAction::toVariantMap() const
     variantMap["ExponentialDecayIter"]  = QVariant::fromValue(_tsneParameters.getExponentialDecayIter());
     variantMap["NumDimensionsOutput"]   = QVariant::fromValue(_tsneParameters.getNumDimensionsOutput());
     variantMap["UpdateCore"]            = QVariant::fromValue(_tsneParameters.getUpdateCore());
+    variantMap["UpdateInterval"]        = QVariant::fromValue(_tsneParameters.getUpdateInterval());
 
     // Handle refined datasets and corresponding actions
     QVariantMap refinedEmbeddingsMap;
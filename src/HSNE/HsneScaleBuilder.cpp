@@ -0,0 +1,401 @@
+#include "HsneScaleBuilder.h"
+
+#include "ParallelUtils.h"
+#include "WorkerControl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::int64_t walkChunkSize = 1024;    /** Points whose walks share a random stream */
+
+    /** Random streams of the steps of a scale */
+    enum class WalkStage : std::uint64_t
+    {
+        LandmarkSelection = 1,
+        AreaOfInfluence = 2
+    };
+
+    /** Finalizer of splitmix64, spreads the seeds of neighboring chunks over the state space */
+    std::uint64_t mixSeed(std::uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    std::mt19937_64 chunkGenerator(std::uint64_t seed, std::size_t scale, WalkStage stage, std::int64_t chunk)
+    {
+        return std::mt19937_64(mixSeed(mixSeed(mixSeed(seed ^ scale) ^ static_cast<std::uint64_t>(stage)) ^ static_cast<std::uint64_t>(chunk)));
+    }
+
+    /** Uniform number in [0, 1) from 53 random bits, the same on all platforms unlike std::uniform_real_distribution */
+    double uniform(std::mt19937_64& generator)
+    {
+        return static_cast<double>(generator() >> 11) * 0x1.0p-53;
+    }
+
+    /** Next point of a random walk, drawn from the row of the transition matrix, the walk stays if the draw exceeds the sum of the row */
+    std::uint32_t step(const HsneMatrix& transitionMatrix, std::uint32_t point, double random)
+    {
+        double cumulative = 0.;
+
+        for (const auto& [next, probability] : transitionMatrix[point])
+        {
+            cumulative += probability;
+
+            if (random < cumulative)
+                return next;
+        }
+
+        return point;
+    }
+
+    /** Rows of a sparse matrix with rows sorted by column, in compressed sparse row form */
+    struct TransposedMatrix
+    {
+        std::vector<std::uint64_t>                      offsets;
+        std::vector<std::pair<std::uint32_t, float>>    entries;
+    };
+
+    /** Counting sort of the entries by column, the entries of every column stay in row order */
+    TransposedMatrix transpose(const HsneMatrix& matrix, std::size_t numColumns)
+    {
+        TransposedMatrix result;
+        result.offsets.assign(numColumns + 1, 0);
+
+        for (const auto& row : matrix)
+            for (const auto& [column, value] : row)
+                result.offsets[column + 1]++;
+
+        for (std::size_t column = 0; column < numColumns; column++)
+            result.offsets[column + 1] += result.offsets[column];
+
+        result.entries.resize(result.offsets.back());
+
+        std::vector<std::uint64_t> fill(result.offsets.begin(), result.offsets.end() - 1);
+
+        for (std::size_t row = 0; row < matrix.size(); row++)
+            for (const auto& [column, value] : matrix[row])
+                result.entries[fill[column]++] = { static_cast<std::uint32_t>(row), value };
+
+        return result;
+    }
+
+    /**
+     * Process the chunks of the points [0, numPoints) in parallel, processChunk(chunk, begin, end)
+     * Progress in [0, 1] is reported by the calling thread, it keeps processing chunks as well
+     * @return False if a stop was requested, the remaining chunks are skipped
+     */
+    template <typename ProcessChunk>
+    bool forEachChunk(std::int64_t numPoints, const WorkerControl* control, const std::function<void(float)>& reportProgress, ProcessChunk processChunk)
+    {
+        const std::int64_t numChunks = (numPoints + walkChunkSize - 1) / walkChunkSize;
+
+        std::atomic<std::int64_t> numProcessed = 0;
+        std::atomic<bool> stopped = false;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (std::int64_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            if (stopped.load(std::memory_order_relaxed))
+                continue;
+
+            if (control != nullptr && control->isStopRequested())
+            {
+                stopped.store(true, std::memory_order_relaxed);
+                continue;
+            }
+
+            processChunk(chunk, chunk * walkChunkSize, std::min(numPoints, (chunk + 1) * walkChunkSize));
+
+            const auto processed = ++numProcessed;
+
+            if (parallelThreadIndex() == 0)
+                reportProgress(static_cast<float>(processed) / numChunks);
+        }
+
+        return !stopped.load();
+    }
+}
+
+HsneScaleBuilder::HsneScaleBuilder(const Hsne::Parameters& parameters) :
+    _parameters(parameters),
+    _seed(parameters._seed < 0 ? std::random_device()() : static_cast<std::uint64_t>(parameters._seed))
+{
+}
+
+bool HsneScaleBuilder::addScale(Hsne& hsne, const ProgressCallback& progress, const WorkerControl* control) const
+{
+    auto& hierarchy = hsne.hierarchy();
+
+    assert(!hierarchy.empty());
+
+    const std::size_t scaleIndex = hierarchy.size();
+    const auto& previousScale = hierarchy.back();
+    const auto& transitionMatrix = previousScale._transition_matrix;
+    const std::int64_t numPrevious = previousScale.size();
+
+    const auto walkLength = static_cast<std::uint32_t>(_parameters._mcmcs_walk_length);
+
+    // Progress of a step is mapped to its part of the scale, reported in whole percents
+    int reportedPercent = -1;
+
+    const auto stepProgress = [&progress, &reportedPercent](float begin, float end, std::string step) -> std::function<void(float)> {
+        return [&progress, &reportedPercent, begin, end, step = std::move(step)](float fraction) -> void {
+            const float value = begin + fraction * (end - begin);
+            const int percent = static_cast<int>(100.f * value);
+
+            if (!progress || percent == reportedPercent)
+                return;
+
+            reportedPercent = percent;
+            progress(value, step);
+        };
+    };
+
+    const auto isStopRequested = [control]() -> bool {
+        return control != nullptr && control->isStopRequested();
+    };
+
+    // 1. Landmark selection, from the number of walks that end at every point
+    std::vector<double> numWalkEnds(numPrevious, 0.);
+
+    if (_parameters._monte_carlo_sampling)
+    {
+        std::vector<std::uint32_t> walkEnds(numPrevious, 0);
+
+        const auto completed = forEachChunk(numPrevious, control, stepProgress(0.f, .3f, "Landmark selection"), [&](std::int64_t chunk, std::int64_t begin, std::int64_t end) {
+            auto generator = chunkGenerator(_seed, scaleIndex, WalkStage::LandmarkSelection, chunk);
+
+            for (std::int64_t i = begin; i < end; i++)
+            {
+                for (unsigned int walk = 0; walk < _parameters._mcmcs_num_walks; walk++)
+                {
+                    auto point = static_cast<std::uint32_t>(i);
+
+                    for (std::uint32_t s = 0; s < walkLength; s++)
+                        point = step(transitionMatrix, point, uniform(generator));
+
+#pragma omp atomic
+                    walkEnds[point]++;
+                }
+            }
+            });
+
+        if (!completed)
+            return false;
+
+        std::copy(walkEnds.begin(), walkEnds.end(), numWalkEnds.begin());
+    }
+    else
+    {
+        // Expected numbers of walks, propagated step by step through the transposed transition matrix
+        const auto transposed = transpose(transitionMatrix, numPrevious);
+
+        std::vector<double> stay(numPrevious);
+
+#pragma omp parallel for
+        for (std::int64_t i = 0; i < numPrevious; i++)
+        {
+            double rowSum = 0.;
+
+            for (const auto& [next, probability] : transitionMatrix[i])
+                rowSum += probability;
+
+            stay[i] = std::max(0., 1. - rowSum);
+        }
+
+        std::fill(numWalkEnds.begin(), numWalkEnds.end(), static_cast<double>(_parameters._mcmcs_num_walks));
+
+        std::vector<double> next(numPrevious);
+        const auto reportProgress = stepProgress(0.f, .3f, "Landmark selection");
+
+        for (std::uint32_t s = 0; s < walkLength; s++)
+        {
+            if (isStopRequested())
+                return false;
+
+#pragma omp parallel for schedule(dynamic, 1024)
+            for (std::int64_t j = 0; j < numPrevious; j++)
+            {
+                double sum = numWalkEnds[j] * stay[j];
+
+                for (std::uint64_t k = transposed.offsets[j]; k < transposed.offsets[j + 1]; k++)
+                    sum += numWalkEnds[transposed.entries[k].first] * transposed.entries[k].second;
+
+                next[j] = sum;
+            }
+
+            std::swap(numWalkEnds, next);
+            reportProgress(static_cast<float>(s + 1) / walkLength);
+        }
+    }
+
+    Hsne::scale_type scale;
+
+    const double landmarkThreshold = _parameters._mcmcs_num_walks * _parameters._mcmcs_landmark_thresh;
+
+    scale._previous_scale_to_landmark_idx.assign(numPrevious, -1);
+
+    for (std::int64_t i = 0; i < numPrevious; i++)
+    {
+        if (numWalkEnds[i] <= landmarkThreshold)
+            continue;
+
+        scale._previous_scale_to_landmark_idx[i] = static_cast<int>(scale._landmark_to_previous_scale_idx.size());
+        scale._landmark_to_previous_scale_idx.push_back(static_cast<std::uint32_t>(i));
+        scale._landmark_to_original_data_idx.push_back(previousScale._landmark_to_original_data_idx[i]);
+    }
+
+    std::vector<double>().swap(numWalkEnds);
+
+    const std::int64_t numLandmarks = scale._landmark_to_previous_scale_idx.size();
+    const auto& landmarkOfPoint = scale._previous_scale_to_landmark_idx;
+
+    std::cout << "HSNE: Scale " << scaleIndex << ": " << numLandmarks << " landmarks among " << numPrevious << " points" << std::endl;
+
+    // 2. Area of influence, from the landmarks that the walks from every point reach first
+    const auto numAreaWalks = static_cast<std::uint32_t>(_parameters._num_walks_per_landmark);
+
+    std::vector<std::uint32_t> numReached(numPrevious, 0);
+
+    scale._area_of_influence.resize(numPrevious);
+
+    const auto completed = forEachChunk(numPrevious, control, stepProgress(.3f, .7f, "Area of influence"), [&](std::int64_t chunk, std::int64_t begin, std::int64_t end) {
+        auto generator = chunkGenerator(_seed, scaleIndex, WalkStage::AreaOfInfluence, chunk);
+
+        std::vector<std::uint32_t> reached;
+
+        for (std::int64_t i = begin; i < end; i++)
+        {
+            auto& row = scale._area_of_influence[i].memory();
+
+            if (landmarkOfPoint[i] >= 0)
+            {
+                row.emplace_back(static_cast<std::uint32_t>(landmarkOfPoint[i]), 1.f);
+                numReached[i] = numAreaWalks;
+                continue;
+            }
+
+            reached.clear();
+
+            for (std::uint32_t walk = 0; walk < numAreaWalks; walk++)
+            {
+                auto point = static_cast<std::uint32_t>(i);
+
+                for (std::uint32_t s = 0; s < walkLength; s++)
+                {
+                    point = step(transitionMatrix, point, uniform(generator));
+
+                    if (landmarkOfPoint[point] >= 0)
+                    {
+                        reached.push_back(static_cast<std::uint32_t>(landmarkOfPoint[point]));
+                        break;
+                    }
+                }
+            }
+
+            std::sort(reached.begin(), reached.end());
+
+            numReached[i] = static_cast<std::uint32_t>(reached.size());
+
+            for (std::size_t first = 0, last = 0; first < reached.size(); first = last)
+            {
+                while (last < reached.size() && reached[last] == reached[first])
+                    last++;
+
+                row.emplace_back(reached[first], static_cast<float>(last - first) / reached.size());
+            }
+        }
+        });
+
+    if (!completed)
+        return false;
+
+    // 3. Landmark weights and transition matrix from the overlaps of the areas of influence
+    const auto influencedPoints = transpose(scale._area_of_influence, numLandmarks);
+    const double minWalks = _parameters._transition_matrix_prune_thresh;
+
+    // Whether enough walks from the point reached the landmark for the influence to count in the overlaps
+    const auto countsForOverlap = [&numReached, minWalks](std::uint32_t point, float influence) -> bool {
+        return std::round(influence * numReached[point]) >= minWalks;
+    };
+
+    const auto previousWeight = [&previousScale](std::uint32_t point) -> double {
+        return previousScale._landmark_weight.empty() ? 1. : previousScale._landmark_weight[point];
+    };
+
+    scale._landmark_weight.assign(numLandmarks, 0.f);
+    scale._transition_matrix.resize(numLandmarks);
+
+    // Landmarks are processed in chunks as well, every thread accumulates a row in its own dense buffer
+    std::vector<std::vector<double>> overlaps(numParallelThreads());
+
+    const auto completedTransitions = forEachChunk(numLandmarks, control, stepProgress(.7f, 1.f, "Landmark similarities"), [&](std::int64_t, std::int64_t begin, std::int64_t end) {
+        auto& overlap = overlaps[parallelThreadIndex()];
+        overlap.resize(numLandmarks, 0.);
+
+        std::vector<std::uint32_t> overlapping;
+
+        for (std::int64_t landmark = begin; landmark < end; landmark++)
+        {
+            double weight = 0.;
+            double sum = 0.;
+
+            overlapping.clear();
+
+            for (std::uint64_t k = influencedPoints.offsets[landmark]; k < influencedPoints.offsets[landmark + 1]; k++)
+            {
+                const auto [point, influence] = influencedPoints.entries[k];
+
+                weight += previousWeight(point) * influence;
+
+                if (!countsForOverlap(point, influence))
+                    continue;
+
+                for (const auto& [other, otherInfluence] : scale._area_of_influence[point])
+                {
+                    if (!countsForOverlap(point, otherInfluence))
+                        continue;
+
+                    if (overlap[other] == 0.)
+                        overlapping.push_back(other);
+
+                    const double value = previousWeight(point) * influence * otherInfluence;
+
+                    overlap[other] += value;
+                    sum += value;
+                }
+            }
+
+            scale._landmark_weight[landmark] = static_cast<float>(weight);
+
+            std::sort(overlapping.begin(), overlapping.end());
+
+            auto& row = scale._transition_matrix[landmark].memory();
+            row.reserve(overlapping.size());
+
+            for (const auto other : overlapping)
+            {
+                row.emplace_back(other, static_cast<float>(overlap[other] / sum));
+                overlap[other] = 0.;
+            }
+        }
+        });
+
+    if (!completedTransitions)
+        return false;
+
+    hierarchy.push_back(std::move(scale));
+
+    return true;
+}
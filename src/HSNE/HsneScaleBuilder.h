@@ -0,0 +1,47 @@
+#pragma once
+
+#include "HsneHierarchy.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class WorkerControl;
+
+/**
+ * HsneScaleBuilder
+ *
+ * Adds scales to an HSNE hierarchy, like Hsne::addScale, with all random walks distributed over the OpenMP threads:
+ *  1. Landmarks: the points of the previous scale at which more than _mcmcs_landmark_thresh times the average number of
+ *     walks end, with _mcmcs_num_walks walks of _mcmcs_walk_length steps from every point. Without Monte Carlo sampling
+ *     the expected numbers of walks are computed instead.
+ *  2. Area of influence: the landmarks that _num_walks_per_landmark walks from every point of the previous scale reach first,
+ *     landmarks only influence themselves
+ *  3. Landmark weights and transition matrix from the overlap of the areas of influence, weighted by the previous scale.
+ *     Landmarks that fewer than _transition_matrix_prune_thresh walks of a point reached do not count for its overlaps.
+ *
+ * The points are walked in chunks with their own random streams, derived from the seed, the scale and the chunk,
+ * so that the hierarchy only depends on the seed and not on the number of threads.
+ * Rows of the transition matrix are accumulated one landmark at a time, so there is no separate memory preserving
+ * computation like HDILib's _out_of_core_computation, which is ignored.
+ */
+class HsneScaleBuilder
+{
+public:
+    /** Progress of the scale in [0, 1] and its current step, called from the thread that calls addScale */
+    using ProgressCallback = std::function<void(float progress, const std::string& step)>;
+
+    /** @param parameters HSNE parameters, a negative seed draws a random one */
+    explicit HsneScaleBuilder(const Hsne::Parameters& parameters);
+
+    /**
+     * Add a scale on top of the hierarchy
+     * @param control Polled between chunks of walks, nothing is added if a stop is requested
+     * @return Whether the scale was added
+     */
+    bool addScale(Hsne& hsne, const ProgressCallback& progress = {}, const WorkerControl* control = nullptr) const;
+
+private:
+    Hsne::Parameters    _parameters;    /** Walk parameters */
+    std::uint64_t       _seed;          /** Seed of all random streams */
+};
@@ -18,6 +18,10 @@ HsneSettingsAction::HsneSettingsAction(HsneAnalysisPlugin* hsneAnalysisPlugin) :
     _knnSettingsAction(this, _knnParameters),
     _topLevelScaleAction(this, hsneAnalysisPlugin->getHierarchy(), hsneAnalysisPlugin->getInputDataset<Points>(), hsneAnalysisPlugin->getOutputDataset<Points>(), &_tsneParameters)
 {
+    // The hierarchy does not use the kNN graph cache, it can be cached as a whole instead
+    _knnSettingsAction.getCacheKnnGraphAction().setVisible(false);
+    _knnSettingsAction.getClearKnnGraphCacheAction().setVisible(false);
+
     const auto updateReadOnly = [this]() -> void {
         _generalHsneSettingsAction.setReadOnly(isReadOnly());
         _hierarchyConstructionSettingsAction.setReadOnly(isReadOnly());
@@ -49,6 +53,7 @@ void HsneSettingsAction::fromVariantMap(const QVariantMap& variantMap)
     _knnSettingsAction.fromVariantMap(variantMap["Knn Settings"].toMap());
     _topLevelScaleAction.fromVariantMap(variantMap["HSNE Scale"].toMap());
     
+    _knnParameters.setKnnBackend(static_cast<KnnBackend>(variantMap.value("KnnBackend", static_cast<int>(KnnBackend::Library)).toInt()));
     _knnParameters.setKnnAlgorithm(static_cast<hdi::dr::knn_library>(variantMap["KnnLibrary"].toInt()));
     _knnParameters.setKnnDistanceMetric(static_cast<hdi::dr::knn_distance_metric>(variantMap["KnnMetric"].toInt()));
     _knnParameters.setAnnoyNumChecks(variantMap["NumChecksAKNN"].toInt());
@@ -65,7 +70,6 @@ void HsneSettingsAction::fromVariantMap(const QVariantMap& variantMap)
     _hsneParameters.setNumWalksForAreaOfInfluence(variantMap["NumWalksForAreaOfInfluence"].toInt());
     _hsneParameters.setMinWalksRequired(variantMap["MinWalksRequired"].toInt());
     _hsneParameters.useMonteCarloSampling(variantMap["MonteCarloSampling"].toBool());
-    _hsneParameters.useOutOfCoreComputation(variantMap["OutOfCoreComputation"].toBool());
     _hsneParameters.setSaveHierarchyToDisk(variantMap["SaveHierarchyToDisk"].toBool());
 
     _tsneParameters.setNumIterations(variantMap["NumIterations"].toInt());
@@ -73,6 +77,7 @@ void HsneSettingsAction::fromVariantMap(const QVariantMap& variantMap)
     _tsneParameters.setExponentialDecayIter(variantMap["ExponentialDecayIter"].toInt());
     _tsneParameters.setNumDimensionsOutput(variantMap["NumDimensionsOutput"].toInt());
     _tsneParameters.setUpdateCore(variantMap["UpdateCore"].toInt());
+    _tsneParameters.setUpdateInterval(variantMap.value("UpdateInterval", _tsneParameters.getUpdateInterval()).toInt());
 }
 
 QVariantMap HsneSettingsAction::toVariantMap() const
@@ -85,6 +90,7 @@ QVariantMap HsneSettingsAction::toVariantMap() const
     _knnSettingsAction.insertIntoVariantMap(variantMap);
     _topLevelScaleAction.insertIntoVariantMap(variantMap);
 
+    variantMap.insert({ { "KnnBackend", QVariant::fromValue(static_cast<int>(_knnParameters.getKnnBackend())) } });
     variantMap.insert({ { "KnnLibrary", QVariant::fromValue(static_cast<int>(_knnParameters.getKnnAlgorithm())) } });
     variantMap.insert({ { "KnnMetric", QVariant::fromValue(static_cast<int>(_knnParameters.getKnnDistanceMetric())) } });
     variantMap.insert({ { "AnnoyNumChecks", QVariant::fromValue(_knnParameters.getAnnoyNumChecks()) } });
@@ -101,7 +107,6 @@ QVariantMap HsneSettingsAction::toVariantMap() const
     variantMap.insert({ { "NumWalksForAreaOfInfluence", QVariant::fromValue(_hsneParameters.getNumWalksForAreaOfInfluence()) } });
     variantMap.insert({ { "MinWalksRequired", QVariant::fromValue(_hsneParameters.getMinWalksRequired()) } });
     variantMap.insert({ { "MonteCarloSampling", QVariant::fromValue(_hsneParameters.useMonteCarloSampling()) } });
-    variantMap.insert({ { "OutOfCoreComputation", QVariant::fromValue(_hsneParameters.useOutOfCoreComputation()) } });
     variantMap.insert({ { "SaveHierarchyToDisk", QVariant::fromValue(_hsneParameters.getSaveHierarchyToDisk()) } });
 
     variantMap.insert({ { "NumIterations", QVariant::fromValue(_tsneParameters.getNumIterations()) } });
@@ -109,6 +114,7 @@ QVariantMap HsneSettingsAction::toVariantMap() const
     variantMap.insert({ { "ExponentialDecayIter", QVariant::fromValue(_tsneParameters.getExponentialDecayIter()) } });
     variantMap.insert({ { "NumDimensionsOutput", QVariant::fromValue(_tsneParameters.getNumDimensionsOutput()) } });
     variantMap.insert({ { "UpdateCore", QVariant::fromValue(_tsneParameters.getUpdateCore()) } });
+    variantMap.insert({ { "UpdateInterval", QVariant::fromValue(_tsneParameters.getUpdateInterval()) } });
 
     return variantMap;
 }
@@ -26,14 +26,22 @@ GeneralTsneSettingsAction::GeneralTsneSettingsAction(TsneSettingsAction& tsneSet
     _distanceMetricAction.setDefaultWidgetFlags(OptionAction::ComboBox);
     _perplexityAction.setDefaultWidgetFlags(IntegralAction::SpinBox | IntegralAction::Slider);
 
-    _knnAlgorithmAction.initialize(QStringList({ "FLANN", "HNSW", "ANNOY" }), "HNSW");
+    _knnAlgorithmAction.initialize(QStringList({ "FLANN", "HNSW", "ANNOY", "Exact (brute force)", "Auto" }), "HNSW");
     _distanceMetricAction.initialize(QStringList({ "Euclidean", "Cosine", "Inner Product", "Manhattan", "Hamming", "Dot" }), "Euclidean");
     _perplexityAction.initialize(2, 50, 30);
 
+    _knnAlgorithmAction.setToolTip("FLANN, HNSW and ANNOY compute approximate neighbors.\nExact (brute force) compares all points, which is fast for up to a few hundred thousand low-dimensional points.\nAuto measures the options on a sample of the data and picks the fastest accurate one, the choice is logged.");
     _reinitAction.setToolTip("Instead of recomputing knn, simply re-initialize t-SNE embedding and recompute gradient descent.");
     _saveProbDistAction.setToolTip("When saving the t-SNE analysis with your project, you can compute additional iterations without recomputing similarities from scratch.");
 
     const auto updateKnnAlgorithm = [this]() -> void {
+        if (_knnAlgorithmAction.getCurrentText() == "Exact (brute force)")
+            _tsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::BruteForce);
+        else if (_knnAlgorithmAction.getCurrentText() == "Auto")
+            _tsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::Auto);
+        else
+            _tsneSettingsAction.getKnnParameters().setKnnBackend(KnnBackend::Library);
+
         if (_knnAlgorithmAction.getCurrentText() == "FLANN")
             _tsneSettingsAction.getKnnParameters().setKnnAlgorithm(hdi::dr::knn_library::KNN_FLANN);
 
@@ -76,6 +84,10 @@ GeneralTsneSettingsAction::GeneralTsneSettingsAction(TsneSettingsAction& tsneSet
         _tsneSettingsAction.getTsneParameters().setUpdateCore(_computationAction.getUpdateIterationsAction().getValue());
     };
 
+    const auto updateCoreUpdateInterval = [this]() -> void {
+        _tsneSettingsAction.getTsneParameters().setUpdateInterval(_computationAction.getUpdateIntervalAction().getValue());
+    };
+
     // currently unused
     //const auto isResettable = [this]() -> bool {
     //    if (_knnAlgorithmAction.isResettable())
@@ -104,6 +116,7 @@ GeneralTsneSettingsAction::GeneralTsneSettingsAction(TsneSettingsAction& tsneSet
         _computationAction.getNumIterationsAction().setEnabled(enable);
         _perplexityAction.setEnabled(enable);
         _computationAction.getUpdateIterationsAction().setEnabled(enable);
+        _computationAction.getUpdateIntervalAction().setEnabled(enable);
         _reinitAction.setEnabled(enable);
         _saveProbDistAction.setEnabled(enable);
     };
@@ -128,6 +141,10 @@ GeneralTsneSettingsAction::GeneralTsneSettingsAction(TsneSettingsAction& tsneSet
         updateCoreUpdate();
     });
 
+    connect(&_computationAction.getUpdateIntervalAction(), &IntegralAction::valueChanged, this, [this, updateCoreUpdateInterval](const std::int32_t& value) {
+        updateCoreUpdateInterval();
+    });
+
     connect(&_reinitAction, &ToggleAction::toggled, this, [this, updateCoreUpdate](const bool toggled) {
         QString newText = (toggled) ? "Reinit" : "Start";
         _computationAction.getStartComputationAction().setText(newText);
@@ -142,6 +159,7 @@ GeneralTsneSettingsAction::GeneralTsneSettingsAction(TsneSettingsAction& tsneSet
     updateNumIterations();
     updatePerplexity();
     updateCoreUpdate();
+    updateCoreUpdateInterval();
     updateReadOnly();
 
     _reinitAction.setEnabled(false);    // only enable after first compute
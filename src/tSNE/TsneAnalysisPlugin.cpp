@@ -1,5 +1,6 @@
 #include "TsneAnalysisPlugin.h"
 
+#include "PointsDataProvider.h"
 #include "TsneSettingsAction.h"
 
 #include <PointData/DimensionsPickerAction.h>
@@ -29,9 +30,17 @@ using namespace mv::util;
 TsneAnalysisPlugin::TsneAnalysisPlugin(const PluginFactory* factory) :
     AnalysisPlugin(factory),
     _tsneAnalysis(),
+    _batchAnalysis(),
     _tsneSettingsAction(nullptr),
     _dataPreparationTask(this, "Prepare data"),
-    _probDistMatrix()
+    _probDistMatrix(),
+    _knnGraph(),
+    _knnGraphParameters(),
+    _knnGraphDimensions(),
+    _knnIndex(),
+    _projectedData(),
+    _knnInputDimensions(),
+    _seedVariantDatasets()
 {
     setObjectName("TSNE");
 
@@ -96,7 +105,15 @@ void TsneAnalysisPlugin::init()
 
         computationAction.getStartComputationAction().setEnabled(!isRunning);
         computationAction.getContinueComputationAction().setEnabled(!isRunning && _tsneAnalysis.canContinue());
+        computationAction.getEmbedNewPointsAction().setEnabled(!isRunning && canEmbedNewPoints());
+        computationAction.getComputeSeedVariantsAction().setEnabled(!isRunning && canComputeSeedVariants());
         computationAction.getStopComputationAction().setEnabled(isRunning);
+
+        // Seed variants cannot be paused, they are stopped
+        computationAction.getPauseComputationAction().setEnabled(isRunning && !_batchAnalysis.isRunning());
+
+        if (!isRunning)
+            computationAction.getPauseComputationAction().setChecked(false);
     };
 
     auto changeSettingsReadOnly = [this](bool readonly) -> void {
@@ -137,16 +154,65 @@ void TsneAnalysisPlugin::init()
         continueComputation();
     });
 
+    computationAction.getEmbedNewPointsAction().setVisible(true);
+
+    connect(&computationAction.getEmbedNewPointsAction(), &TriggerAction::triggered, this, [this, changeSettingsReadOnly]() {
+        changeSettingsReadOnly(true);
+
+        embedNewPoints();
+    });
+
+    computationAction.getNumSeedVariantsAction().setVisible(true);
+    computationAction.getComputeSeedVariantsAction().setVisible(true);
+
+    connect(&computationAction.getComputeSeedVariantsAction(), &TriggerAction::triggered, this, [this, changeSettingsReadOnly]() {
+        // Nothing is started without a distribution or with another gradient descent type, the settings stay editable then
+        if (canComputeSeedVariants())
+            changeSettingsReadOnly(true);
+
+        computeSeedVariants();
+    });
+
+    connect(&_batchAnalysis, &TsneBatchAnalysis::embeddingUpdate, this, [this](int run, const TsneData& tsneData) {
+        if (run >= static_cast<int>(_seedVariantDatasets.size()) || !_seedVariantDatasets[run].isValid())
+            return;
+
+        tsneData.publishTo(_seedVariantDatasets[run].get());
+
+        events().notifyDatasetDataChanged(_seedVariantDatasets[run]);
+    });
+
+    connect(&_batchAnalysis, &TsneBatchAnalysis::finished, this, [this, &computationAction, changeSettingsReadOnly]() {
+        computationAction.getRunningAction().setChecked(false);
+
+        changeSettingsReadOnly(false);
+    });
+
+    connect(&_batchAnalysis, &TsneBatchAnalysis::aborted, this, [this, &computationAction, updateComputationAction, changeSettingsReadOnly]() {
+        updateComputationAction();
+
+        computationAction.getRunningAction().setChecked(false);
+
+        changeSettingsReadOnly(false);
+    });
+
+    connect(&computationAction.getPauseComputationAction(), &ToggleAction::toggled, this, [this](bool toggled) {
+        if (toggled)
+            _tsneAnalysis.pauseComputation();
+        else
+            _tsneAnalysis.resumeComputation();
+    });
+
     connect(&computationAction.getStopComputationAction(), &TriggerAction::triggered, this, [this]() {
         qApp->processEvents();
 
         stopComputation();
     });
 
-    connect(&_tsneAnalysis, &TsneAnalysis::embeddingUpdate, this, [this](const TsneData tsneData) {
+    connect(&_tsneAnalysis, &TsneAnalysis::embeddingUpdate, this, [this](const TsneData& tsneData) {
 
         // Update the output points dataset with new data from the TSNE analysis
-        getOutputDataset<Points>()->setData(tsneData.getData().data(), tsneData.getNumPoints(), 2);
+        tsneData.publishTo(getOutputDataset<Points>().get());
 
         _tsneSettingsAction->getGeneralTsneSettingsAction().getNumberOfComputedIterationsAction().setValue(_tsneAnalysis.getNumIterations() - 1);
 
@@ -176,6 +242,23 @@ void TsneAnalysisPlugin::init()
         if (dataset->getDataType() != PointType)
             return;
 
+        // The kNN graph of changed input data has to be recomputed, appended points can be embedded
+        if (dataset->getId() == getInputDataset()->getId())
+        {
+            updateKnnResults();
+
+            _knnGraphDimensions.clear();
+
+            // The index and projection stay valid for appended points, which are projected and searched with them, other changes make them outdated
+            const auto numInputPoints = getInputDataset<Points>()->getNumPoints();
+
+            if ((_knnIndex != nullptr && _knnIndex->getNumPoints() >= numInputPoints) || (_projectedData != nullptr && _projectedData->data->getNumPoints() >= numInputPoints))
+                _knnInputDimensions.clear();
+
+            auto& computationAction = _tsneSettingsAction->getComputationAction();
+            computationAction.getEmbedNewPointsAction().setEnabled(!computationAction.getRunningAction().isChecked() && canEmbedNewPoints());
+        }
+
         _tsneSettingsAction->getInitalEmbeddingSettingsAction().updateDatasetPicker();
 
         }); 
@@ -190,22 +273,21 @@ void TsneAnalysisPlugin::startComputation()
 
     auto inputPoints = getInputDataset<Points>();
 
-    // Create list of data from the enabled dimensions
-    std::vector<float> data;
-    std::vector<unsigned int> indices;
+    std::vector<bool> enabledDimensions = inputPoints->getDimensionsPickerAction().getEnabledDimensions();
 
-    // Extract the enabled dimensions from the data
-    std::vector<bool> enabledDimensions = getInputDataset<Points>()->getDimensionsPickerAction().getEnabledDimensions();
+    const auto tsneParameters   = _tsneSettingsAction->getTsneParameters();
+    const auto knnParameters    = _tsneSettingsAction->getKnnParameters();
 
-    const auto numEnabledDimensions = std::count_if(enabledDimensions.begin(), enabledDimensions.end(), [](bool b) { return b; });
-    const auto numPoints = inputPoints->isFull() ? inputPoints->getNumPoints() : inputPoints->indices.size();
-    data.resize(numPoints * numEnabledDimensions);
+    // The graph of the previous computation serves all perplexities up to the one it was computed for
+    updateKnnResults();
 
-    for (int i = 0; i < inputPoints->getNumDimensions(); i++)
-        if (enabledDimensions[i])
-            indices.push_back(i);
+    const bool reuseKnnGraph = _knnGraph != nullptr &&
+                               !_knnGraphDimensions.empty() && _knnGraphDimensions == enabledDimensions &&
+                               _knnGraphParameters.yieldsSameNeighbors(knnParameters) &&
+                               _knnGraph->getNumPoints() == inputPoints->getNumPoints() &&
+                               _knnGraph->getNumNeighbors() >= static_cast<std::uint32_t>(tsneParameters.getNumNeighbors());
 
-    inputPoints->populateDataForDimensions<std::vector<float>, std::vector<unsigned int>>(data, indices);
+    const auto numPoints = inputPoints->getNumPoints();
 
     _tsneSettingsAction->getGeneralTsneSettingsAction().getNumberOfComputedIterationsAction().setValue(0);
     _tsneSettingsAction->getComputationAction().getRunningAction().setChecked(true);
@@ -215,13 +297,48 @@ void TsneAnalysisPlugin::startComputation()
 
     _dataPreparationTask.setFinished();
 
-    _tsneAnalysis.startComputation(_tsneSettingsAction->getTsneParameters(), _tsneSettingsAction->getKnnParameters(), std::move(data), numEnabledDimensions, &initEmbedding);
+    if (reuseKnnGraph)
+    {
+        qDebug() << "TsneAnalysisPlugin: kNN parameters and data unchanged, only the perplexity calibration is recomputed";
+        _tsneAnalysis.startComputation(tsneParameters, _knnGraph, &initEmbedding);
+        return;
+    }
+
+    _knnGraph.reset();
+    _knnGraphParameters = knnParameters;
+    _knnGraphDimensions = enabledDimensions;
+
+    // An index and projection of the same points are used again, the worker checks that they match the kNN parameters
+    if (_knnInputDimensions != enabledDimensions)
+    {
+        _knnIndex.reset();
+        _projectedData.reset();
+    }
+
+    _knnInputDimensions = enabledDimensions;
+
+    // The enabled dimensions of the data are read block-wise by the worker, a dense copy is only made if the kNN backend needs one
+    auto dataProvider = std::make_shared<const PointsDataProvider>(inputPoints, enabledDimensions);
+
+    _tsneAnalysis.startComputation(tsneParameters, knnParameters, std::move(dataProvider), _projectedData, _knnIndex, &initEmbedding);
+}
+
+void TsneAnalysisPlugin::updateKnnResults()
+{
+    if (auto knnGraph = _tsneAnalysis.getKnnGraph())
+        _knnGraph = std::move(knnGraph);
+
+    if (auto knnIndex = _tsneAnalysis.getKnnIndex())
+        _knnIndex = std::move(knnIndex);
+
+    if (auto projectedData = _tsneAnalysis.getProjectedData())
+        _projectedData = std::move(projectedData);
 }
 
 void TsneAnalysisPlugin::reinitializeComputation()
 {
     if (_tsneAnalysis.canContinue())
-        _probDistMatrix = std::move(*_tsneAnalysis.getProbabilityDistribution().value());
+        _probDistMatrix = _tsneAnalysis.getProbabilityDistribution();
     
     if(_probDistMatrix.size() == 0)
     {
@@ -238,7 +355,7 @@ void TsneAnalysisPlugin::reinitializeComputation()
 
     auto initEmbedding = initSettings.getInitEmbedding(numPoints);
 
-    _tsneAnalysis.startComputation(_tsneSettingsAction->getTsneParameters(), std::move(_probDistMatrix), numPoints, &initEmbedding);
+    _tsneAnalysis.startComputation(_tsneSettingsAction->getTsneParameters(), _probDistMatrix, numPoints, &initEmbedding);
 }
 
 void TsneAnalysisPlugin::continueComputation()
@@ -259,7 +376,7 @@ void TsneAnalysisPlugin::continueComputation()
         currentEmbeddingPositions.resize(2ull * currentEmbedding->getNumPoints());
         currentEmbedding->populateDataForDimensions<std::vector<float>, std::vector<unsigned int>>(currentEmbeddingPositions, { 0, 1 });
 
-        _tsneAnalysis.startComputation(_tsneSettingsAction->getTsneParameters(), std::move(_probDistMatrix), currentEmbedding->getNumPoints(), &currentEmbeddingPositions, _tsneSettingsAction->getGeneralTsneSettingsAction().getNumberOfComputedIterationsAction().getValue());
+        _tsneAnalysis.startComputation(_tsneSettingsAction->getTsneParameters(), _probDistMatrix, currentEmbedding->getNumPoints(), &currentEmbeddingPositions, _tsneSettingsAction->getGeneralTsneSettingsAction().getNumberOfComputedIterationsAction().getValue());
     }
     else
     {
@@ -270,9 +387,138 @@ void TsneAnalysisPlugin::continueComputation()
     }
 }
 
+bool TsneAnalysisPlugin::canEmbedNewPoints() const
+{
+    const auto numEmbeddedPoints = getOutputDataset<Points>()->getNumPoints();
+
+    if (numEmbeddedPoints == 0 || getInputDataset<Points>()->getNumPoints() <= numEmbeddedPoints)
+        return false;
+
+    // The joint distribution of the embedded points is extended by the new ones
+    const auto probDistMatrix = _tsneAnalysis.canContinue() ? _tsneAnalysis.getProbabilityDistribution() : _probDistMatrix;
+
+    return probDistMatrix.size() == numEmbeddedPoints;
+}
+
+void TsneAnalysisPlugin::embedNewPoints()
+{
+    auto inputPoints = getInputDataset<Points>();
+    auto currentEmbedding = getOutputDataset<Points>();
+
+    if (_tsneAnalysis.canContinue())
+        _probDistMatrix = _tsneAnalysis.getProbabilityDistribution();
+
+    const auto numEmbeddedPoints = currentEmbedding->getNumPoints();
+
+    if (!canEmbedNewPoints() || currentEmbedding->getNumDimensions() != 2)
+    {
+        qWarning() << "TsneAnalysisPlugin::embedNewPoints: cannot embed new points - compute a 2D embedding of the points first, then add points to the input";
+        _tsneSettingsAction->getComputationAction().getRunningAction().setChecked(false);
+        return;
+    }
+
+    getOutputDataset()->getTask().setRunning();
+
+    _dataPreparationTask.setEnabled(true);
+    _dataPreparationTask.setRunning();
+
+    _tsneSettingsAction->getComputationAction().getRunningAction().setChecked(true);
+
+    std::vector<float> currentEmbeddingPositions;
+    currentEmbeddingPositions.resize(2ull * numEmbeddedPoints);
+    currentEmbedding->populateDataForDimensions<std::vector<float>, std::vector<unsigned int>>(currentEmbeddingPositions, { 0, 1 });
+
+    const auto enabledDimensions = inputPoints->getDimensionsPickerAction().getEnabledDimensions();
+
+    // All points are read, the embedded ones as references and the appended ones as queries
+    auto dataProvider = std::make_shared<const PointsDataProvider>(inputPoints, enabledDimensions);
+
+    // The index of the embedded points is searched instead of comparing the new points to all of them, if there is one, new points are projected like the embedded ones
+    updateKnnResults();
+
+    auto knnIndex = _knnInputDimensions == enabledDimensions ? _knnIndex : nullptr;
+    auto projectedData = _knnInputDimensions == enabledDimensions ? _projectedData : nullptr;
+
+    _dataPreparationTask.setFinished();
+
+    _tsneAnalysis.embedNewPoints(_tsneSettingsAction->getTsneParameters(), _tsneSettingsAction->getKnnParameters(), _probDistMatrix, currentEmbeddingPositions, std::move(dataProvider), std::move(projectedData), std::move(knnIndex), _tsneSettingsAction->getGeneralTsneSettingsAction().getNumberOfComputedIterationsAction().getValue());
+}
+
+bool TsneAnalysisPlugin::canComputeSeedVariants() const
+{
+    // A stopped batch keeps running until its runs finished their current iteration
+    if (_batchAnalysis.isRunning())
+        return false;
+
+    if (!TsneBatchAnalysis::supportsGradientDescentType(_tsneSettingsAction->getTsneParameters().getGradientDescentType()))
+        return false;
+
+    const auto probDistMatrix = _tsneAnalysis.canContinue() ? _tsneAnalysis.getProbabilityDistribution() : _probDistMatrix;
+
+    return probDistMatrix.size() > 0 && probDistMatrix.size() == getOutputDataset<Points>()->getNumPoints();
+}
+
+void TsneAnalysisPlugin::computeSeedVariants()
+{
+    auto& computationAction = _tsneSettingsAction->getComputationAction();
+
+    if (!canComputeSeedVariants())
+    {
+        qWarning() << "TsneAnalysisPlugin::computeSeedVariants: cannot compute seed variants - compute an embedding first, select the multi-threaded CPU gradient descent (Barnes-Hut or FFT) and wait until a previous batch stopped";
+        return;
+    }
+
+    if (_tsneAnalysis.canContinue())
+        _probDistMatrix = _tsneAnalysis.getProbabilityDistribution();
+
+    const auto numPoints    = getOutputDataset<Points>()->getNumPoints();
+    const auto numVariants  = computationAction.getNumSeedVariantsAction().getValue();
+    const auto firstSeed    = _tsneSettingsAction->getInitalEmbeddingSettingsAction().getRandomSeedAction().getValue() + 1;
+
+    // Every variant starts from its own random initialization, the other settings are the ones of the analysis
+    std::vector<TsneParameters> runParameters(numVariants, _tsneSettingsAction->getTsneParameters());
+
+    for (int run = 0; run < numVariants; run++)
+    {
+        runParameters[run].setSeed(firstSeed + run);
+        runParameters[run].setPresetEmbedding(false);
+    }
+
+    // Datasets of a previous batch are reused, unless they were removed in the meantime
+    std::erase_if(_seedVariantDatasets, [](const Dataset<Points>& dataset) { return !dataset.isValid(); });
+
+    while (static_cast<int>(_seedVariantDatasets.size()) < numVariants)
+    {
+        auto derivedData = mv::data().createDerivedDataset("TSNE Embedding variant", getInputDataset(), getOutputDataset());
+        _seedVariantDatasets.push_back(Dataset<Points>(derivedData.get<Points>()));
+    }
+
+    for (int run = 0; run < numVariants; run++)
+    {
+        auto& variantDataset = _seedVariantDatasets[run];
+
+        variantDataset->setText(QString("TSNE Embedding (seed %1)").arg(firstSeed + run));
+
+        if (variantDataset->getNumPoints() != numPoints || variantDataset->getNumDimensions() != 2)
+        {
+            std::vector<float> initialData(2ull * numPoints);
+            variantDataset->setData(initialData.data(), numPoints, 2);
+            events().notifyDatasetDataChanged(variantDataset);
+        }
+    }
+
+    computationAction.getRunningAction().setChecked(true);
+
+    _batchAnalysis.startComputation(runParameters, _probDistMatrix, numPoints);
+
+    // The running action enabled pausing before the batch was running
+    computationAction.getPauseComputationAction().setEnabled(false);
+}
+
 void TsneAnalysisPlugin::stopComputation()
 {
     _tsneAnalysis.stopComputation();
+    _batchAnalysis.stopComputation();
 }
 
 void TsneAnalysisPlugin::fromVariantMap(const QVariantMap& variantMap)
@@ -293,7 +539,9 @@ void TsneAnalysisPlugin::fromVariantMap(const QVariantMap& variantMap)
 
             if (loadFile.is_open())
             {
-                hdi::data::IO::loadSparseMatrix(_probDistMatrix, loadFile, nullptr);
+                ProbDistMatrix probDistMatrix;
+                hdi::data::IO::loadSparseMatrix(probDistMatrix, loadFile, nullptr);
+                _probDistMatrix = std::move(probDistMatrix);
 
                 _tsneSettingsAction->getComputationAction().getContinueComputationAction().setEnabled(true);
             }
@@ -302,6 +550,32 @@ void TsneAnalysisPlugin::fromVariantMap(const QVariantMap& variantMap)
         }
         else
             qWarning("TsneAnalysisPlugin::fromVariantMap: t-SNE probability distribution cannot be loaded from project since the project file does not seem to contain a corresponding file.");
+
+        // The index was built before, it is loaded (Annoy: mapped) instead of being built again
+        if (variantMap.contains("knnIndex"))
+        {
+            const auto knnIndexMap = variantMap["knnIndex"].toMap();
+            const auto loadPathIndex = QDir::cleanPath(projects().getTemporaryDirPath(AbstractProjectManager::TemporaryDirType::Open) + QDir::separator() + knnIndexMap["file"].toString());
+
+            KnnParameters knnIndexParameters;
+            knnIndexParameters.setKnnAlgorithm(static_cast<hdi::dr::knn_library>(knnIndexMap["library"].toInt()));
+            knnIndexParameters.setKnnDistanceMetric(static_cast<hdi::dr::knn_distance_metric>(knnIndexMap["metric"].toInt()));
+            knnIndexParameters.setAnnoyNumTrees(knnIndexMap["annoyNumTrees"].toInt());
+            knnIndexParameters.setAnnoyNumChecks(knnIndexMap["annoyNumChecks"].toInt());
+            knnIndexParameters.setHNSWm(knnIndexMap["hnswM"].toInt());
+            knnIndexParameters.setHNSWef(knnIndexMap["hnswEf"].toInt());
+
+            const auto enabledDimensions = getInputDataset<Points>()->getDimensionsPickerAction().getEnabledDimensions();
+            const auto numEnabledDimensions = static_cast<std::uint32_t>(std::count(enabledDimensions.begin(), enabledDimensions.end(), true));
+
+            if (knnIndexMap["numDimensions"].toUInt() == numEnabledDimensions)
+                _knnIndex = KnnIndex::load(QDir::toNativeSeparators(loadPathIndex).toStdU16String(), knnIndexMap["numPoints"].toUInt(), numEnabledDimensions, knnIndexParameters);
+
+            if (_knnIndex != nullptr)
+                _knnInputDimensions = enabledDimensions;
+            else
+                qWarning("TsneAnalysisPlugin::fromVariantMap: kNN index was NOT loaded successfully, it is built again when needed");
+        }
     }
 }
 
@@ -313,7 +587,7 @@ QVariantMap TsneAnalysisPlugin::toVariantMap() const
 
     const auto probabilityDistribution = _tsneAnalysis.getProbabilityDistribution();
 
-    if (_tsneSettingsAction->getGeneralTsneSettingsAction().getSaveProbDistAction().isChecked() && probabilityDistribution != std::nullopt)
+    if (_tsneSettingsAction->getGeneralTsneSettingsAction().getSaveProbDistAction().isChecked() && !probabilityDistribution.isNull())
     {
         const auto fileName = QUuid::createUuid().toString(QUuid::WithoutBraces) + ".bin";
         const auto filePath = QDir::cleanPath(projects().getTemporaryDirPath(AbstractProjectManager::TemporaryDirType::Save) + QDir::separator() + fileName).toStdString();
@@ -324,10 +598,44 @@ QVariantMap TsneAnalysisPlugin::toVariantMap() const
             std::cerr << "Caching failed. File could not be opened. " << std::endl;
         else
         {
-            hdi::data::IO::saveSparseMatrix(*probabilityDistribution.value(), saveFile, nullptr);
+            hdi::data::IO::saveSparseMatrix(probabilityDistribution.toMapMemEff(), saveFile, nullptr);
             saveFile.close();
             variantMap["probabilityDistribution"] = fileName;
         }
+
+        // The index of all input points is saved next to the distribution, so that projects never build it again
+        auto knnIndex = _tsneAnalysis.getKnnIndex();
+
+        if (knnIndex == nullptr)
+            knnIndex = _knnIndex;
+
+        const auto inputPoints = getInputDataset<Points>();
+        const auto enabledDimensions = inputPoints->getDimensionsPickerAction().getEnabledDimensions();
+        const auto numEnabledDimensions = static_cast<std::uint32_t>(std::count(enabledDimensions.begin(), enabledDimensions.end(), true));
+
+        // An index of PCA projected points is not saved, the projection itself is computed again
+        if (knnIndex != nullptr && knnIndex->getNumPoints() == inputPoints->getNumPoints() && knnIndex->getNumDimensions() == numEnabledDimensions && _knnInputDimensions == enabledDimensions)
+        {
+            const auto indexFileName = QUuid::createUuid().toString(QUuid::WithoutBraces) + ".knn";
+            const auto indexFilePath = QDir::cleanPath(projects().getTemporaryDirPath(AbstractProjectManager::TemporaryDirType::Save) + QDir::separator() + indexFileName);
+
+            if (knnIndex->save(QDir::toNativeSeparators(indexFilePath).toStdU16String()))
+            {
+                const auto& knnIndexParameters = knnIndex->getKnnParameters();
+
+                variantMap["knnIndex"] = QVariantMap({
+                    { "file", indexFileName },
+                    { "library", static_cast<int>(knnIndexParameters.getKnnAlgorithm()) },
+                    { "metric", static_cast<int>(knnIndexParameters.getKnnDistanceMetric()) },
+                    { "annoyNumTrees", knnIndexParameters.getAnnoyNumTrees() },
+                    { "annoyNumChecks", knnIndexParameters.getAnnoyNumChecks() },
+                    { "hnswM", knnIndexParameters.getHNSWm() },
+                    { "hnswEf", knnIndexParameters.getHNSWef() },
+                    { "numPoints", knnIndex->getNumPoints() },
+                    { "numDimensions", knnIndex->getNumDimensions() }
+                });
+            }
+        }
     }
 
     return variantMap;
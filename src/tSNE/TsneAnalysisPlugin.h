@@ -4,6 +4,9 @@
 #include <Task.h>
 
 #include "TsneAnalysis.h"
+#include "TsneBatchAnalysis.h"
+
+#include <PointData/PointData.h>
 
 #include <QPointer>
 #include <QUrl>
@@ -29,8 +32,21 @@ public:
     void startComputation();
     void reinitializeComputation();
     void continueComputation();
+    void embedNewPoints();
+    /** Compute embeddings with the next seeds concurrently from the current distribution, each into its own derived dataset */
+    void computeSeedVariants();
     void stopComputation();
 
+private:
+    /** Whether the input has more points than the embedding and the distribution of the embedded points is available */
+    bool canEmbedNewPoints() const;
+
+    /** Whether the distribution of the embedded points is available and the gradient descent type can run in a batch */
+    bool canComputeSeedVariants() const;
+
+    /** Take over the kNN graph, index and PCA projection of the last computation, if it produced them */
+    void updateKnnResults();
+
 public: // Serialization
 
     /**
@@ -47,11 +63,19 @@ public: // Serialization
 
 private:
     TsneAnalysis                        _tsneAnalysis;          /** TSNE analysis */
+    TsneBatchAnalysis                   _batchAnalysis;         /** Concurrent seed variants of the embedding */
     TsneSettingsAction*                 _tsneSettingsAction;    /** TSNE settings action */
     mv::Task                            _dataPreparationTask;   /** Task for reporting data preparation progress */
 
 private:
-    ProbDistMatrix                      _probDistMatrix;        /** Probability distribution matrix used for serialization */
+    SharedProbDistMatrix                 _probDistMatrix;        /** Probability distribution matrix used for serialization, shared with the t-SNE worker */
+    std::shared_ptr<const KnnGraph>      _knnGraph;              /** kNN graph of the last similarity computation, reused if only the perplexity changes */
+    KnnParameters                        _knnGraphParameters;    /** Requested kNN parameters of _knnGraph */
+    std::vector<bool>                    _knnGraphDimensions;    /** Enabled input dimensions of _knnGraph, empty if the graph is outdated */
+    std::shared_ptr<const KnnIndex>      _knnIndex;              /** Approximate index of the input (before new points were added), built once and saved with the project */
+    std::shared_ptr<const ProjectedData> _projectedData;         /** PCA projection of the input (before new points were added), if the kNN search asked for one */
+    std::vector<bool>                    _knnInputDimensions;    /** Enabled input dimensions of _knnIndex and _projectedData */
+    std::vector<mv::Dataset<Points>>     _seedVariantDatasets;   /** Derived datasets of the seed variants, reused by the next batch */
 };
 
 class TsneAnalysisPluginFactory : public AnalysisPluginFactory